@@ -8,20 +8,33 @@ void Application::run(){
 void Application::init(){
     rendr::RendererConfig renderConfig;
     renderConfig.deviceConfig.deviceEnableFeatures.setSamplerAnisotropy(true);
+    renderConfig.jobSystem = &jobs;
     renderer.init(renderConfig, window);
     
-    renderer.initMaterial(material);
+    //the pipeline compiles on a worker while the meshes load
+    rendr::MaterialHandle materialHandle = renderer.initMaterialAsync(material);
+    //the mapping only has to outlive loadMesh, staging copies the data out right away
+    rendr::MeshCache roomMeshes;
+    roomMeshes.loadFbx("C:/Dev/cpp-projects/engine/resources/zen-studio/source/room.fbx",
+        "C:/Dev/cpp-projects/engine/resources/zen-studio/source/room.rmesh", {}, &jobs);
+    renderer.waitForMaterial(materialHandle);
+    //compare across runs: the first run after a driver update is cold
+    const rendr::PipelineCache& pipelineCache = renderer.getDevice().pipelineCache_;
+    std::cout << "pipelines: " << pipelineCache.getPipelineCount() << " created in " << pipelineCache.getCreationMilliseconds()
+        << " ms, " << (pipelineCache.isWarm() ? "warm" : "cold") << " cache" << std::endl;
     MeshWithTextureObj walls(material);
     MeshWithTextureObj details(material);
-    rendr::STBImageRaii wallsTex("C:/Dev/cpp-projects/engine/resources/zen-studio/textures/t_walls_baked.png");  
-    rendr::STBImageRaii detailsTex("C:/Dev/cpp-projects/engine/resources/zen-studio/textures/t_details_Baked.png");  
-    walls.loadTexture(std::move(wallsTex), renderer);    
-    details.loadTexture(std::move(detailsTex), renderer);
-    rendr::UfbxSceneRaii fbxScene("C:/Dev/cpp-projects/engine/resources/zen-studio/source/room.fbx");
-    auto meshesAndMatInd = rendr::ufbxLoadMeshesPartsSepByMaterial(fbxScene.get());  
-    auto fbxMatToMesh = rendr::mergeMeshesByMaterial(meshesAndMatInd);
-    walls.loadMesh(fbxMatToMesh[0], renderer);
-    details.loadMesh(fbxMatToMesh[2], renderer);
+    loadTexture(walls, "C:/Dev/cpp-projects/engine/resources/zen-studio/textures/t_walls_baked.png");
+    loadTexture(details, "C:/Dev/cpp-projects/engine/resources/zen-studio/textures/t_details_Baked.png");
+    const rendr::SamplerCache& samplerCache = renderer.getDevice().samplerCache_;
+    std::cout << "samplers: " << samplerCache.getSamplerCount() << " for " << samplerCache.getRequestCount() << " requests" << std::endl;
+    const rendr::MeshView* wallsMesh = roomMeshes.findByMaterial(rendr::MaterialId{0});
+    const rendr::MeshView* detailsMesh = roomMeshes.findByMaterial(rendr::MaterialId{2});
+    if (!wallsMesh || !detailsMesh) {
+        throw std::runtime_error("room.fbx is missing walls or details material!");
+    }
+    walls.loadMesh(*wallsMesh, renderer);
+    details.loadMesh(*detailsMesh, renderer);
 
     objsToDraw.push_back(std::move(walls));
     objsToDraw.push_back(std::move(details));
@@ -31,9 +44,28 @@ void Application::init(){
     camManip.setInputManager(inputManager);
 }
 
+//prefers the texcooker output next to the source image
+void Application::loadTexture(MeshWithTextureObj& obj, const std::string& sourcePath){
+    std::filesystem::path cookedPath = std::filesystem::path(sourcePath).replace_extension(".rtex");
+    bool useCooked = false;
+    if (std::filesystem::exists(cookedPath)) {
+        //devices without BC sampling load the source image instead
+        rendr::CookedTextureHeader header = rendr::loadCookedTextureHeader(cookedPath.string());
+        useCooked = rendr::isCookedFormatSupported(renderer.getDevice().physicalDevice_,
+            static_cast<rendr::CookedTextureFormat>(header.format), header.srgb != 0);
+    }
+    if (useCooked) {
+        obj.loadTexture(rendr::loadCookedTexture(cookedPath.string()), renderer);
+    } else {
+        obj.loadTexture(rendr::STBImageRaii(sourcePath), renderer);
+    }
+}
+
 void Application::mainLoop(){
     while (!window.shouldClose()) {
         window.pollEvents();
+        //GLFW calls queued by jobs on other threads
+        jobs.runMainThreadJobs();
         timer.update();
         
         //TODO вынести 
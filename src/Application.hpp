@@ -13,6 +13,7 @@
 #include <glm/glm.hpp>
 #include <array>
 #include <chrono>
+#include <filesystem>
 #include <tiny_obj_loader.h>
 #include <unordered_map>
 
@@ -46,12 +47,15 @@ public:
     : 
     glwfContext(), 
     window(), 
+    jobs(),
     renderer()
     {}
 
 private:
     rendr::GlfwContext glwfContext;
     rendr::Window window;
+    //created on the main thread, outlives the renderer recording on it
+    rendr::JobSystem jobs;
     rendr::Renderer renderer;
 
     SimpleMaterial material;
@@ -63,5 +67,6 @@ private:
     Timer timer;
     
     void init();
+    void loadTexture(MeshWithTextureObj& obj, const std::string& sourcePath);
     void mainLoop();
 };
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace rendr{
+
+struct BenchSuite{
+    const char* name;
+    std::function<void()> run;
+};
+
+std::vector<BenchSuite>& getBenchSuites();
+
+//adds a suite to getBenchSuites() during static initialization
+struct BenchRegistrar{
+    BenchRegistrar(const char* name, std::function<void()> run){
+        getBenchSuites().push_back({name, std::move(run)});
+    }
+};
+
+//milliseconds of the fastest of repeats calls, the fastest run is the one least disturbed by the rest of the system
+template<typename Body>
+double measureMilliseconds(int repeats, Body&& body){
+    double best = std::numeric_limits<double>::max();
+    for (int i = 0; i < repeats; i++) {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+//keeps the optimizer from dropping work whose result is otherwise unused
+void keepAlive(const void* value);
+
+}
+
+#define RENDR_BENCH(name) \
+    static void name(); \
+    static rendr::BenchRegistrar name##Registrar(#name, name); \
+    static void name()
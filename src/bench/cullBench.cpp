@@ -0,0 +1,74 @@
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "bench.hpp"
+#include "frustum.hpp"
+
+//host frustum culling from 1k to 1M bounding spheres scattered around the camera:
+//the SoA BoundsTable against a scalar isSphereInFrustum loop over the same spheres
+RENDR_BENCH(frustumCull) {
+#if defined(RENDR_FRUSTUM_AVX)
+    printf("BoundsTable path: AVX\n");
+#elif defined(RENDR_FRUSTUM_SSE)
+    printf("BoundsTable path: SSE\n");
+#else
+    printf("BoundsTable path: scalar\n");
+#endif
+
+    glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+    proj[1][1] *= -1;
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    rendr::FrustumPlanes planes = rendr::extractFrustumPlanes(proj * view);
+
+    printf("%10s %10s %12s %12s %12s %12s\n", "spheres", "visible", "table ms", "table ns/obj", "scalar ms", "scalar ns/obj");
+    for (uint32_t count : {1000u, 10000u, 100000u, 1000000u}) {
+        std::mt19937 random(count);
+        std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+        std::uniform_real_distribution<float> radius(0.5f, 5.0f);
+        std::vector<glm::vec4> spheres(count);
+        rendr::BoundsTable table;
+        for (glm::vec4& sphere : spheres) {
+            sphere = glm::vec4(position(random), position(random), position(random), radius(random));
+            table.push(sphere);
+        }
+
+        //enough passes that the small tables run for a measurable time
+        int passes = static_cast<int>(std::max(1u, 1000000u / count));
+        std::vector<uint64_t> visibility;
+        double tableMs = rendr::measureMilliseconds(5, [&]{
+            for (int pass = 0; pass < passes; pass++) {
+                table.cull(planes, visibility);
+            }
+        }) / passes;
+
+        uint32_t scalarVisible = 0;
+        double scalarMs = rendr::measureMilliseconds(5, [&]{
+            for (int pass = 0; pass < passes; pass++) {
+                scalarVisible = 0;
+                for (const glm::vec4& sphere : spheres) {
+                    scalarVisible += rendr::isSphereInFrustum(planes, sphere) ? 1 : 0;
+                }
+            }
+        }) / passes;
+
+        uint32_t visible = 0;
+        for (uint64_t word : visibility) {
+            visible += static_cast<uint32_t>(std::bitset<64>(word).count());
+        }
+        if (visible != scalarVisible) {
+            throw std::runtime_error("BoundsTable and isSphereInFrustum disagree!");
+        }
+        printf("%10u %10u %12.4f %12.2f %12.4f %12.2f\n", count, visible,
+            tableMs, tableMs * 1e6 / count, scalarMs, scalarMs * 1e6 / count);
+    }
+}
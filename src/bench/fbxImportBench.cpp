@@ -0,0 +1,141 @@
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "bench.hpp"
+#include "utility.hpp"
+
+namespace{
+
+const uint32_t slotsPerMesh = 8;
+
+//ASCII FBX with meshCount meshes of one quad per material slot. Slots point at materials spread over the whole
+//scene, and material names repeat every materialCount / 2 so name lookups merge materials that are distinct
+void writeSyntheticScene(const std::string& path, uint32_t meshCount, uint32_t materialCount){
+    std::ofstream file(path);
+    if (!file) {
+        throw std::runtime_error("failed to write " + path);
+    }
+    file << "; FBX 7.4.0 project file\n";
+    file << "FBXHeaderExtension:  {\n\tFBXHeaderVersion: 1003\n\tFBXVersion: 7400\n}\n";
+    file << "Definitions:  {\n\tVersion: 100\n\tCount: " << meshCount * 2 + materialCount << "\n";
+    file << "\tObjectType: \"Model\" {\n\t\tCount: " << meshCount << "\n\t}\n";
+    file << "\tObjectType: \"Geometry\" {\n\t\tCount: " << meshCount << "\n\t}\n";
+    file << "\tObjectType: \"Material\" {\n\t\tCount: " << materialCount << "\n\t}\n}\n";
+
+    file << "Objects:  {\n";
+    for (uint32_t i = 0; i < meshCount; i++) {
+        file << "\tGeometry: " << 1000000 + i << ", \"Geometry::part" << i << "\", \"Mesh\" {\n";
+        file << "\t\tVertices: *" << slotsPerMesh * 12 << " {\n\t\t\ta: ";
+        for (uint32_t j = 0; j < slotsPerMesh; j++) {
+            float x = static_cast<float>(j);
+            file << (j ? "," : "") << x << ",0,0," << x + 1 << ",0,0," << x + 1 << ",1,0," << x << ",1,0";
+        }
+        file << "\n\t\t}\n\t\tPolygonVertexIndex: *" << slotsPerMesh * 4 << " {\n\t\t\ta: ";
+        for (uint32_t j = 0; j < slotsPerMesh; j++) {
+            uint32_t first = j * 4;
+            file << (j ? "," : "") << first << "," << first + 1 << "," << first + 2 << "," << -int32_t(first + 3) - 1;
+        }
+        file << "\n\t\t}\n\t\tGeometryVersion: 124\n";
+        file << "\t\tLayerElementMaterial: 0 {\n\t\t\tVersion: 101\n\t\t\tName: \"\"\n";
+        file << "\t\t\tMappingInformationType: \"ByPolygon\"\n\t\t\tReferenceInformationType: \"IndexToDirect\"\n";
+        file << "\t\t\tMaterials: *" << slotsPerMesh << " {\n\t\t\t\ta: ";
+        for (uint32_t j = 0; j < slotsPerMesh; j++) {
+            file << (j ? "," : "") << j;
+        }
+        file << "\n\t\t\t}\n\t\t}\n";
+        file << "\t\tLayer: 0 {\n\t\t\tVersion: 100\n\t\t\tLayerElement:  {\n\t\t\t\tType: \"LayerElementMaterial\"\n\t\t\t\tTypedIndex: 0\n\t\t\t}\n\t\t}\n\t}\n";
+        file << "\tModel: " << 2000000 + i << ", \"Model::part" << i << "\", \"Mesh\" {\n\t\tVersion: 232\n\t}\n";
+    }
+    for (uint32_t k = 0; k < materialCount; k++) {
+        file << "\tMaterial: " << 3000000 + k << ", \"Material::mat" << k % (materialCount / 2) << "\", \"\" {\n";
+        file << "\t\tVersion: 102\n\t\tShadingModel: \"phong\"\n\t}\n";
+    }
+    file << "}\n";
+
+    file << "Connections:  {\n";
+    for (uint32_t i = 0; i < meshCount; i++) {
+        file << "\tC: \"OO\"," << 1000000 + i << "," << 2000000 + i << "\n";
+        file << "\tC: \"OO\"," << 2000000 + i << ",0\n";
+        //connection order is the slot order
+        for (uint32_t j = 0; j < slotsPerMesh; j++) {
+            file << "\tC: \"OO\"," << 3000000 + (i * 7 + j * 13) % materialCount << "," << 2000000 + i << "\n";
+        }
+    }
+    file << "}\n";
+}
+
+//the importer's lookup before the typed ids: every part compares its material name against every scene material
+std::vector<uint32_t> resolveByNameScan(ufbx_scene* scene){
+    std::vector<uint32_t> partMaterials;
+    for (size_t i = 0; i < scene->nodes.count; i++) {
+        const ufbx_mesh* mesh = scene->nodes[i]->mesh;
+        if (!mesh) {
+            continue;
+        }
+        for (size_t j = 0; j < mesh->material_parts.count; j++) {
+            uint32_t sceneMatIndex = rendr::noMaterialId.value;
+            if (j < mesh->materials.count && mesh->materials[j]) {
+                for (size_t k = 0; k < scene->materials.count; k++) {
+                    if (strcmp(mesh->materials[j]->name.data, scene->materials[k]->name.data) == 0) {
+                        sceneMatIndex = static_cast<uint32_t>(k);
+                    }
+                }
+            }
+            partMaterials.push_back(sceneMatIndex);
+        }
+    }
+    return partMaterials;
+}
+
+std::vector<uint32_t> resolveByTypedId(ufbx_scene* scene){
+    std::vector<uint32_t> partMaterials;
+    for (size_t i = 0; i < scene->nodes.count; i++) {
+        const ufbx_mesh* mesh = scene->nodes[i]->mesh;
+        if (!mesh) {
+            continue;
+        }
+        for (size_t j = 0; j < mesh->material_parts.count; j++) {
+            partMaterials.push_back(rendr::ufbxGetMaterialId(mesh, j).value);
+        }
+    }
+    return partMaterials;
+}
+
+}
+
+//material resolution of the fbx importer on scenes with many materials and parts,
+//the name scan it replaced against ufbx typed ids, and the whole part conversion for scale
+RENDR_BENCH(fbxImport) {
+    const uint32_t meshCount = 1000;
+    std::string path = (std::filesystem::temp_directory_path() / "rendrBenchMaterials.fbx").string();
+
+    printf("%10s %8s %14s %14s %12s %12s %12s\n", "materials", "parts", "name scan ms", "typed id ms", "convert ms", "name ids", "typed ids");
+    for (uint32_t materialCount : {100u, 1000u, 4000u}) {
+        writeSyntheticScene(path, meshCount, materialCount);
+        rendr::UfbxSceneRaii scene(path);
+
+        std::vector<uint32_t> byName;
+        std::vector<uint32_t> byTypedId;
+        double nameMs = rendr::measureMilliseconds(3, [&]{
+            byName = resolveByNameScan(scene.get());
+        });
+        double typedIdMs = rendr::measureMilliseconds(3, [&]{
+            byTypedId = resolveByTypedId(scene.get());
+        });
+        double convertMs = rendr::measureMilliseconds(3, [&]{
+            std::vector<rendr::Mesh<rendr::VertexPTN>> parts = rendr::ufbxLoadMeshesPartsSepByMaterial(scene.get());
+            rendr::keepAlive(parts.data());
+        });
+
+        //names repeat, so the name scan sees half of the materials
+        size_t nameIds = std::set<uint32_t>(byName.begin(), byName.end()).size();
+        size_t typedIds = std::set<uint32_t>(byTypedId.begin(), byTypedId.end()).size();
+        printf("%10u %8zu %14.3f %14.3f %12.3f %12zu %12zu\n", materialCount, byTypedId.size(), nameMs, typedIdMs, convertMs, nameIds, typedIds);
+    }
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "bench.hpp"
+#include "jobSystem.hpp"
+
+namespace{
+
+const uint32_t jobCount = 100000;
+
+//jobs per second of empty jobs pushed by a non worker thread into the shared queue
+double measureSpawnRate(rendr::JobSystem& jobs){
+    std::atomic<uint32_t> done{0};
+    double ms = rendr::measureMilliseconds(5, [&]{
+        rendr::JobCounter counter;
+        for (uint32_t i = 0; i < jobCount; i++) {
+            jobs.run([&done]{
+                done.fetch_add(1, std::memory_order_relaxed);
+            }, &counter);
+        }
+        jobs.wait(counter);
+    });
+    return jobCount / (ms / 1000.0);
+}
+
+//jobs per second when one worker spawns every job into its own deque and the others have to steal them
+double measureStealRate(rendr::JobSystem& jobs){
+    std::atomic<uint32_t> done{0};
+    double ms = rendr::measureMilliseconds(5, [&]{
+        rendr::JobCounter counter;
+        jobs.run([&]{
+            rendr::JobCounter children;
+            for (uint32_t i = 0; i < jobCount; i++) {
+                jobs.run([&done]{
+                    //a little work so thieves have something to take before the owner drains its deque
+                    for (volatile int spin = 0; spin < 200; spin++) {}
+                    done.fetch_add(1, std::memory_order_relaxed);
+                }, &children);
+            }
+            jobs.wait(children);
+        }, &counter);
+        //waiting with help could run the spawning job here, where its children would go to the shared queue
+        while (!counter.isDone()) {
+            std::this_thread::yield();
+        }
+        //returns at once, but only after the finishing worker let go of the counter
+        jobs.wait(counter);
+    });
+    return jobCount / (ms / 1000.0);
+}
+
+struct Latency{
+    double medianUs;
+    double p99Us;
+};
+
+//time from run() on the main thread until the job starts on a worker, one job at a time so workers are asleep between them
+Latency measureWakeLatency(rendr::JobSystem& jobs){
+    const int samples = 2000;
+    std::vector<double> latencies;
+    latencies.reserve(samples);
+    for (int i = 0; i < samples; i++) {
+        std::atomic<bool> started{false};
+        std::chrono::steady_clock::time_point startTime;
+        auto runTime = std::chrono::steady_clock::now();
+        jobs.run([&]{
+            startTime = std::chrono::steady_clock::now();
+            started.store(true, std::memory_order_release);
+        });
+        //spinning instead of wait keeps the main thread from running the job itself
+        while (!started.load(std::memory_order_acquire)) {
+            std::this_thread::yield();
+        }
+        latencies.push_back(std::chrono::duration<double, std::micro>(startTime - runTime).count());
+    }
+    std::sort(latencies.begin(), latencies.end());
+    return Latency{latencies[samples / 2], latencies[samples * 99 / 100]};
+}
+
+}
+
+//spawn and steal throughput of empty and near empty jobs, and the latency of waking a sleeping worker,
+//for job systems of 1 worker up to one per hardware thread
+RENDR_BENCH(jobSystem) {
+    unsigned hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> workerCounts;
+    for (unsigned workers = 1; workers < hardwareThreads; workers *= 2) {
+        workerCounts.push_back(workers);
+    }
+    workerCounts.push_back(hardwareThreads);
+
+    printf("%8s %14s %14s %14s %14s\n", "workers", "spawn jobs/s", "steal jobs/s", "wake med us", "wake p99 us");
+    for (unsigned workers : workerCounts) {
+        rendr::JobSystem jobs(workers);
+        double spawnRate = measureSpawnRate(jobs);
+        double stealRate = measureStealRate(jobs);
+        Latency latency = measureWakeLatency(jobs);
+        printf("%8u %14.0f %14.0f %14.2f %14.2f\n", workers, spawnRate, stealRate, latency.medianUs, latency.p99Us);
+    }
+}
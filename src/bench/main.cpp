@@ -0,0 +1,48 @@
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+
+#include "bench.hpp"
+
+//Engine microbenchmarks, numbers go to stdout
+//usage: bench [suite name...], every suite runs when none is given
+
+namespace rendr{
+
+namespace{
+const void* volatile keepAliveSink = nullptr;
+}
+
+std::vector<BenchSuite>& getBenchSuites(){
+    static std::vector<BenchSuite> suites;
+    return suites;
+}
+
+void keepAlive(const void* value){
+    keepAliveSink = value;
+}
+
+}
+
+int main(int argc, char** argv){
+    int failed = 0;
+    for (const rendr::BenchSuite& suite : rendr::getBenchSuites()) {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; i++) {
+            selected = selected || strcmp(argv[i], suite.name) == 0;
+        }
+        if (!selected) {
+            continue;
+        }
+
+        std::cout << "== " << suite.name << std::endl;
+        try {
+            suite.run();
+        } catch (const std::exception& e) {
+            std::cerr << suite.name << " failed: " << e.what() << std::endl;
+            failed++;
+        }
+    }
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "bench.hpp"
+#include "mipChain.hpp"
+
+namespace{
+
+std::vector<uint8_t> makeNoiseImage(uint32_t size){
+    std::vector<uint8_t> pixels(size_t(size) * size * 4);
+    uint32_t state = 2463534242u;
+    for (uint8_t& channel : pixels) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        channel = static_cast<uint8_t>(state);
+    }
+    return pixels;
+}
+
+//reads one texel per pixel of a footprint x footprint screen area that covers the whole level,
+//what a minified draw fetches from the level it samples. Sizes are powers of two
+uint64_t gatherFootprint(const uint8_t* level, uint32_t levelSize, uint32_t footprint){
+    uint32_t step = levelSize / footprint;
+    uint64_t sum = 0;
+    for (uint32_t y = 0; y < footprint; y++) {
+        const uint8_t* row = level + size_t(y) * step * levelSize * 4;
+        for (uint32_t x = 0; x < footprint; x++) {
+            sum += row[size_t(x) * step * 4];
+        }
+    }
+    return sum;
+}
+
+//bytes of the 64 byte lines gatherFootprint touches
+uint64_t footprintWorkingSet(uint32_t levelSize, uint32_t footprint){
+    return uint64_t(footprint) * std::min<uint64_t>(footprint, levelSize * 4 / 64) * 64;
+}
+
+}
+
+//CPU chain build speed, memory of the full chain, and how much a minified draw reads
+//with and without mips (level 0 against the level whose texels match the screen footprint)
+RENDR_BENCH(mipChain) {
+    printf("%8s %10s %10s %12s\n", "size", "build ms", "MB/s", "chain/base");
+    for (uint32_t size : {512u, 1024u, 2048u, 4096u}) {
+        std::vector<uint8_t> pixels = makeNoiseImage(size);
+        std::vector<rendr::MipLevel> levels;
+        std::vector<uint8_t> chain;
+        double ms = rendr::measureMilliseconds(5, [&]{
+            chain = rendr::buildMipChainRGBA8(pixels.data(), size, size, true, levels);
+        });
+        double megabytes = pixels.size() / (1024.0 * 1024.0);
+        printf("%8u %10.2f %10.1f %12.3f\n", size, ms, megabytes / (ms / 1000.0), double(chain.size()) / pixels.size());
+    }
+
+    const uint32_t size = 4096;
+    std::vector<uint8_t> pixels = makeNoiseImage(size);
+    std::vector<rendr::MipLevel> levels;
+    std::vector<uint8_t> chain = rendr::buildMipChainRGBA8(pixels.data(), size, size, true, levels);
+
+    printf("\n%10s %14s %14s %12s %12s\n", "footprint", "base set KB", "mip set KB", "base ms", "mip ms");
+    for (uint32_t footprint : {2048u, 512u, 128u, 32u}) {
+        //the level trilinear filtering settles on, one texel per pixel
+        size_t levelIndex = 0;
+        while (levelIndex + 1 < levels.size() && levels[levelIndex].width > footprint) {
+            levelIndex++;
+        }
+        const rendr::MipLevel& level = levels[levelIndex];
+
+        uint64_t sum = 0;
+        double baseMs = rendr::measureMilliseconds(5, [&]{
+            sum += gatherFootprint(chain.data(), size, footprint);
+        });
+        double mipMs = rendr::measureMilliseconds(5, [&]{
+            sum += gatherFootprint(chain.data() + level.offset, level.width, footprint);
+        });
+        rendr::keepAlive(&sum);
+
+        printf("%10u %14.0f %14.0f %12.3f %12.3f\n", footprint,
+            footprintWorkingSet(size, footprint) / 1024.0, footprintWorkingSet(level.width, footprint) / 1024.0, baseMs, mipMs);
+    }
+}
@@ -0,0 +1,177 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+#include <tiny_obj_loader.h>
+
+#include "bench.hpp"
+#include "utility.hpp"
+
+//set by CMake to the repository's resources directory
+#ifndef ENGINE_RESOURCE_DIR
+#define ENGINE_RESOURCE_DIR "resources"
+#endif
+
+namespace{
+
+//the model Application loads, tiled to reach multi-million triangle counts
+const std::string vikingRoomPath = ENGINE_RESOURCE_DIR "/vikingRoom/models/vikingRoom.obj";
+
+//the hash loadModel used before the index triple table
+struct ValueHash{
+    size_t operator()(const rendr::VertexPCT& vertex) const{
+        return ((std::hash<glm::vec3>()(vertex.pos) ^
+               (std::hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^
+               (std::hash<glm::vec2>()(vertex.texCoord) << 1);
+    }
+};
+
+//loadModel before the index triple table: unordered_map over vertex values, a count and two lookups per index
+rendr::Mesh<rendr::VertexPCT> loadModelByValue(const std::string& filepath){
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filepath.c_str())) {
+        throw std::runtime_error(warn + err);
+    }
+
+    rendr::Mesh<rendr::VertexPCT> mesh;
+    std::unordered_map<rendr::VertexPCT, uint32_t, ValueHash> uniqueVertices;
+    for (const auto& shape : shapes) {
+        for (const auto& index : shape.mesh.indices) {
+            rendr::VertexPCT vertex{};
+            vertex.pos = {
+                attrib.vertices[3 * index.vertex_index + 0],
+                attrib.vertices[3 * index.vertex_index + 1],
+                attrib.vertices[3 * index.vertex_index + 2]
+            };
+            if (index.texcoord_index >= 0) {
+                vertex.texCoord = {
+                    attrib.texcoords[2 * index.texcoord_index + 0],
+                    1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
+                };
+            }
+            vertex.color = {1.0f, 1.0f, 1.0f};
+
+            if (uniqueVertices.count(vertex) == 0) {
+                uniqueVertices[vertex] = static_cast<uint32_t>(mesh.vertices.size());
+                mesh.vertices.push_back(vertex);
+            }
+            mesh.indices.push_back(uniqueVertices[vertex]);
+        }
+    }
+    return mesh;
+}
+
+//offsets one face corner "v/vt/vn", empty components stay empty
+std::string offsetCorner(const std::string& corner, const long offsets[3]){
+    std::string result;
+    size_t start = 0;
+    for (int component = 0; component < 3 && start <= corner.size(); component++) {
+        size_t end = corner.find('/', start);
+        std::string number = corner.substr(start, end == std::string::npos ? std::string::npos : end - start);
+        if (component > 0) {
+            result += '/';
+        }
+        if (!number.empty()) {
+            result += std::to_string(std::stol(number) + offsets[component]);
+        }
+        if (end == std::string::npos) {
+            break;
+        }
+        start = end + 1;
+    }
+    return result;
+}
+
+//copies side by side, every copy has its own positions, uvs and normals so none of them dedupe against another
+void writeTiledObj(const std::string& sourcePath, const std::string& path, uint32_t copies){
+    std::ifstream source(sourcePath);
+    if (!source) {
+        throw std::runtime_error("failed to open " + sourcePath);
+    }
+    std::vector<std::string> lines;
+    long counts[3] = {0, 0, 0};
+    for (std::string line; std::getline(source, line);) {
+        if (line.rfind("v ", 0) == 0) {
+            counts[0]++;
+        } else if (line.rfind("vt ", 0) == 0) {
+            counts[1]++;
+        } else if (line.rfind("vn ", 0) == 0) {
+            counts[2]++;
+        } else if (line.rfind("f ", 0) != 0) {
+            continue;
+        }
+        lines.push_back(line);
+    }
+
+    std::ofstream file(path);
+    for (uint32_t copy = 0; copy < copies; copy++) {
+        long offsets[3] = {counts[0] * long(copy), counts[1] * long(copy), counts[2] * long(copy)};
+        for (const std::string& line : lines) {
+            std::istringstream tokens(line);
+            std::string type;
+            tokens >> type;
+            file << type;
+            if (type == "v") {
+                float x, y, z;
+                tokens >> x >> y >> z;
+                file << ' ' << x + 2.5f * copy << ' ' << y << ' ' << z;
+            } else if (type == "f") {
+                for (std::string corner; tokens >> corner;) {
+                    file << ' ' << offsetCorner(corner, offsets);
+                }
+            } else {
+                file << tokens.rdbuf();
+            }
+            file << '\n';
+        }
+    }
+}
+
+}
+
+//OBJ import of the viking room tiled up to millions of indices: tinyobj parsing alone,
+//loadModel with the index triple table, and the previous unordered_map over vertex values
+RENDR_BENCH(objDedupe) {
+    if (!std::filesystem::exists(vikingRoomPath)) {
+        printf("skipped, %s not found\n", vikingRoomPath.c_str());
+        return;
+    }
+    std::string path = (std::filesystem::temp_directory_path() / "rendrBenchVikingRoom.obj").string();
+
+    printf("%8s %10s %10s %10s %12s %12s\n", "copies", "indices", "vertices", "parse ms", "triple ms", "value ms");
+    for (uint32_t copies : {1u, 8u, 32u, 128u}) {
+        writeTiledObj(vikingRoomPath, path, copies);
+
+        double parseMs = rendr::measureMilliseconds(3, [&]{
+            tinyobj::attrib_t attrib;
+            std::vector<tinyobj::shape_t> shapes;
+            std::vector<tinyobj::material_t> materials;
+            std::string warn, err;
+            tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str());
+            rendr::keepAlive(attrib.vertices.data());
+        });
+        rendr::Mesh<rendr::VertexPCT> byTriple;
+        double tripleMs = rendr::measureMilliseconds(3, [&]{
+            byTriple = rendr::loadModel(path);
+        });
+        rendr::Mesh<rendr::VertexPCT> byValue;
+        double valueMs = rendr::measureMilliseconds(3, [&]{
+            byValue = loadModelByValue(path);
+        });
+
+        if (byTriple.indices.size() != byValue.indices.size()) {
+            throw std::runtime_error("dedupe paths disagree on the index count!");
+        }
+        printf("%8u %10zu %10zu %10.1f %12.1f %12.1f\n", copies, byTriple.indices.size(), byTriple.vertices.size(), parseMs, tripleMs, valueMs);
+    }
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,168 @@
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "bench.hpp"
+#include "utility.hpp"
+#include "simpleMaterial.hpp"
+
+namespace{
+
+const uint32_t gridSide = 250;
+const uint32_t drawCount = gridSide * gridSide;
+
+//one cube drawn drawCount times on a grid in front of the camera, every draw visible
+class CubeGridObj : public rendr::IDrawableObj{
+    rendr::GeometryAllocation geometry;
+    const rendr::GeometryPool* geometryPool = nullptr;
+    rendr::Image texture;
+    rendr::TextureSlot textureSlot;
+    vk::DescriptorSet textureTableSet;
+    std::vector<glm::mat4> models;
+public:
+    CubeGridObj(rendr::Material& mat, rendr::Renderer& renderer)
+    : IDrawableObj(mat) {
+        std::vector<rendr::VertexPTN> vertices(8);
+        for (uint32_t i = 0; i < 8; i++) {
+            vertices[i].pos = glm::vec3(i & 1 ? 0.5f : -0.5f, i & 2 ? 0.5f : -0.5f, i & 4 ? 0.5f : -0.5f);
+            vertices[i].texCoord = glm::vec2(i & 1 ? 1.0f : 0.0f, i & 2 ? 1.0f : 0.0f);
+            vertices[i].normal = vertices[i].pos;
+        }
+        std::vector<uint32_t> indices = {
+            0, 2, 1, 1, 2, 3,  4, 5, 6, 5, 7, 6,  0, 1, 4, 1, 5, 4,
+            2, 6, 3, 3, 6, 7,  0, 4, 2, 2, 4, 6,  1, 3, 5, 3, 7, 5
+        };
+        rendr::GeometryPool& pool = renderer.getGeometryPool();
+        rendr::UploadContext& uploads = renderer.getUploadContext();
+        geometry = pool.allocate(static_cast<uint32_t>(vertices.size()), static_cast<uint32_t>(indices.size()));
+        pool.upload(uploads, *geometry, vertices.data(), indices.data());
+        geometryPool = &pool;
+
+        //2x2 white, uploaded as is without a chain
+        rendr::CookedTexture white;
+        white.format = rendr::CookedTextureFormat::RGBA8;
+        white.width = 2;
+        white.height = 2;
+        white.levels.push_back(rendr::CookedMip{2, 2, 0, 16});
+        white.data.assign(16, 255);
+        const rendr::Device& device = renderer.getDevice();
+        texture = rendr::create2DTextureImage(device.physicalDevice_, device.allocator_, device.device_, uploads, white);
+        textureSlot = renderer.getTextureTable().add(*texture.imageView, rendr::getTextureSampler(device));
+        textureTableSet = renderer.getTextureTable().getSet();
+        uploadTicket = uploads.getRecordingTicket();
+
+        models.reserve(drawCount);
+        for (uint32_t y = 0; y < gridSide; y++) {
+            for (uint32_t x = 0; x < gridSide; x++) {
+                glm::vec3 position((x - gridSide / 2.0f) * 0.5f, (y - gridSide / 2.0f) * 0.5f, -200.0f);
+                models.push_back(glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(0.25f)));
+            }
+        }
+    }
+
+    void writeDrawPackets(rendr::DrawList& drawList, const rendr::RendererSetup& setup, int curFrame) const override{
+        rendr::DrawPacket packet;
+        packet.pipeline = *setup.graphicsPipeline_;
+        packet.pipelineLayout = *setup.pipelineLayout_;
+        packet.materialSet = textureTableSet;
+        packet.textureIndex = textureSlot.getIndex();
+        packet.vertexBuffer = *geometryPool->getVertexBuffer();
+        packet.indexBuffer = *geometryPool->getIndexBuffer();
+        packet.indexCount = geometry->indexCount;
+        packet.firstIndex = geometry->firstIndex;
+        packet.vertexOffset = static_cast<int32_t>(geometry->firstVertex);
+        packet.boundingSphere = glm::vec4(0.0f, 0.0f, 0.0f, 0.87f);
+        for (const glm::mat4& model : models) {
+            packet.model = model;
+            packet.depth = rendr::computeDrawDepth(drawList.getViewProj(), model, packet.boundingSphere);
+            drawList.add(packet);
+        }
+    }
+};
+
+}
+
+//frame pass recording of 62500 draws on a headless renderer, per recording job, for 1 thread up to all of them.
+//multiDrawIndirect is left off so every draw is its own command and recording cost grows with the draw count
+RENDR_BENCH(recording) {
+    for (const char* shader : {"/fvertex.spv", "/ffragment.spv"}) {
+        std::string path = rendr::RendererConfig().shaderDirectory + shader;
+        if (!std::filesystem::exists(path)) {
+            printf("skipped, %s not found\n", path.c_str());
+            return;
+        }
+    }
+
+    unsigned hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> threadCounts;
+    for (unsigned threads = 1; threads < hardwareThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(hardwareThreads);
+
+    printf("%8s %8s %10s %12s %12s %12s\n", "threads", "jobs", "calls", "frame ms", "mean job ms", "max job ms");
+    for (unsigned threads : threadCounts) {
+        rendr::RendererConfig config;
+        config.deviceConfig = rendr::DeviceConfig::headless();
+        config.deviceConfig.deviceEnableFeatures.setSamplerAnisotropy(true);
+        config.deviceConfig.optionalDeviceFeatures.setMultiDrawIndirect(false);
+        config.cullingMode = rendr::CullingMode::eCpu;
+        config.occlusionCulling = false;
+        //the calling thread records too, so threads - 1 workers. One thread records inline into the primary
+        if (threads > 1) {
+            config.recordingThreads = threads - 1;
+        } else {
+            config.parallelRecordingMinDraws = UINT32_MAX;
+        }
+
+        SimpleMaterial material;
+        rendr::Renderer renderer;
+        renderer.initHeadless(config);
+        renderer.initMaterial(material);
+        CubeGridObj grid(material, renderer);
+
+        rendr::MVPUniformBufferObject ubo;
+        ubo.model = glm::mat4(1.0f);
+        ubo.view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        ubo.proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+        ubo.proj[1][1] *= -1;
+        renderer.updateUniformBuffer(ubo);
+        renderer.setDrawableObjects({&grid});
+
+        //the grid is skipped until its upload finished
+        for (int frame = 0; frame < 10; frame++) {
+            renderer.drawFrame();
+        }
+
+        const int frames = 30;
+        double frameMs = 0.0;
+        double meanJobMs = 0.0;
+        double maxJobMs = 0.0;
+        size_t jobs = 0;
+        for (int frame = 0; frame < frames; frame++) {
+            frameMs += rendr::measureMilliseconds(1, [&]{
+                renderer.drawFrame();
+            });
+            //inline recording reports no jobs, frame ms is the single thread's recording time then
+            const std::vector<float>& times = renderer.getRecordingTimes();
+            jobs = times.size();
+            for (float time : times) {
+                meanJobMs += time / times.size();
+                maxJobMs = std::max(maxJobMs, static_cast<double>(time));
+            }
+        }
+        printf("%8u %8zu %10u %12.3f %12.3f %12.3f\n", threads, jobs, renderer.getDrawStats().drawCalls,
+            frameMs / frames, meanJobMs / frames, maxJobMs);
+
+        renderer.waitIdle();
+    }
+}
@@ -0,0 +1,190 @@
+#define VMA_IMPLEMENTATION
+#include "allocator.hpp"
+
+namespace rendr{
+
+Allocation::Allocation(Allocation&& other) noexcept
+: allocator_(other.allocator_), allocation_(other.allocation_){
+    other.allocator_ = VK_NULL_HANDLE;
+    other.allocation_ = VK_NULL_HANDLE;
+}
+
+Allocation& Allocation::operator=(Allocation&& other) noexcept{
+    if (this != &other) {
+        clear();
+        std::swap(allocator_, other.allocator_);
+        std::swap(allocation_, other.allocation_);
+    }
+    return *this;
+}
+
+Allocation::~Allocation(){
+    clear();
+}
+
+void* Allocation::getMappedData() const{
+    VmaAllocationInfo info;
+    vmaGetAllocationInfo(allocator_, allocation_, &info);
+    return info.pMappedData;
+}
+
+vk::DeviceMemory Allocation::getDeviceMemory() const{
+    VmaAllocationInfo info;
+    vmaGetAllocationInfo(allocator_, allocation_, &info);
+    return info.deviceMemory;
+}
+
+vk::DeviceSize Allocation::getOffset() const{
+    VmaAllocationInfo info;
+    vmaGetAllocationInfo(allocator_, allocation_, &info);
+    return info.offset;
+}
+
+vk::DeviceSize Allocation::getSize() const{
+    VmaAllocationInfo info;
+    vmaGetAllocationInfo(allocator_, allocation_, &info);
+    return info.size;
+}
+
+void Allocation::clear(){
+    if (allocation_ != VK_NULL_HANDLE) {
+        vmaFreeMemory(allocator_, allocation_);
+    }
+    allocator_ = VK_NULL_HANDLE;
+    allocation_ = VK_NULL_HANDLE;
+}
+
+
+Allocator::Allocator(const vk::raii::Instance& instance, const vk::raii::PhysicalDevice& physicalDevice, const vk::raii::Device& device, uint32_t vulkanApiVersion){
+    VmaAllocatorCreateInfo createInfo{};
+    createInfo.instance = static_cast<VkInstance>(*instance);
+    createInfo.physicalDevice = static_cast<VkPhysicalDevice>(*physicalDevice);
+    createInfo.device = static_cast<VkDevice>(*device);
+    createInfo.vulkanApiVersion = vulkanApiVersion;
+
+    if (vmaCreateAllocator(&createInfo, &allocator_) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create memory allocator!");
+    }
+}
+
+Allocator::Allocator(Allocator&& other) noexcept
+: allocator_(other.allocator_){
+    other.allocator_ = VK_NULL_HANDLE;
+}
+
+Allocator& Allocator::operator=(Allocator&& other) noexcept{
+    if (this != &other) {
+        clear();
+        std::swap(allocator_, other.allocator_);
+    }
+    return *this;
+}
+
+Allocator::~Allocator(){
+    clear();
+}
+
+void Allocator::clear(){
+    if (allocator_ != VK_NULL_HANDLE) {
+        vmaDestroyAllocator(allocator_);
+    }
+    allocator_ = VK_NULL_HANDLE;
+}
+
+Allocation Allocator::allocateForBuffer(const vk::raii::Buffer& buffer, vk::MemoryPropertyFlags properties) const{
+    VmaAllocationCreateInfo allocCreateInfo{};
+    allocCreateInfo.requiredFlags = static_cast<VkMemoryPropertyFlags>(properties);
+    if (properties & vk::MemoryPropertyFlagBits::eHostVisible) {
+        allocCreateInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+    }
+
+    VmaAllocation allocation;
+    if (vmaAllocateMemoryForBuffer(allocator_, static_cast<VkBuffer>(*buffer), &allocCreateInfo, &allocation, nullptr) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate buffer memory!");
+    }
+    Allocation result(allocator_, allocation);
+
+    if (vmaBindBufferMemory(allocator_, allocation, static_cast<VkBuffer>(*buffer)) != VK_SUCCESS) {
+        throw std::runtime_error("failed to bind buffer memory!");
+    }
+    return result;
+}
+
+Allocation Allocator::allocateForImage(const vk::raii::Image& image, vk::MemoryPropertyFlags properties) const{
+    VmaAllocationCreateInfo allocCreateInfo{};
+    allocCreateInfo.requiredFlags = static_cast<VkMemoryPropertyFlags>(properties);
+    if (properties & vk::MemoryPropertyFlagBits::eHostVisible) {
+        allocCreateInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+    }
+
+    VmaAllocation allocation;
+    if (vmaAllocateMemoryForImage(allocator_, static_cast<VkImage>(*image), &allocCreateInfo, &allocation, nullptr) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate image memory!");
+    }
+    Allocation result(allocator_, allocation);
+
+    if (vmaBindImageMemory(allocator_, allocation, static_cast<VkImage>(*image)) != VK_SUCCESS) {
+        throw std::runtime_error("failed to bind image memory!");
+    }
+    return result;
+}
+
+std::vector<HeapUsage> Allocator::getHeapUsage() const{
+    const VkPhysicalDeviceMemoryProperties* memProperties = nullptr;
+    vmaGetMemoryProperties(allocator_, &memProperties);
+
+    std::vector<VmaBudget> budgets(memProperties->memoryHeapCount);
+    vmaGetHeapBudgets(allocator_, budgets.data());
+
+    std::vector<HeapUsage> heaps(memProperties->memoryHeapCount);
+    for (uint32_t i = 0; i < memProperties->memoryHeapCount; i++) {
+        heaps[i].flags = vk::MemoryHeapFlags(memProperties->memoryHeaps[i].flags);
+        heaps[i].heapSize = memProperties->memoryHeaps[i].size;
+        heaps[i].blockCount = budgets[i].statistics.blockCount;
+        heaps[i].blockBytes = budgets[i].statistics.blockBytes;
+        heaps[i].allocationCount = budgets[i].statistics.allocationCount;
+        heaps[i].allocationBytes = budgets[i].statistics.allocationBytes;
+        heaps[i].usage = budgets[i].usage;
+        heaps[i].budget = budgets[i].budget;
+    }
+    return heaps;
+}
+
+
+rendr::Image createImage(
+    const rendr::Allocator& allocator,
+    const vk::raii::Device& device,
+    vk::MemoryPropertyFlags properties,
+    vk::ImageCreateInfo imageInfo,
+    vk::ImageViewCreateInfo imageViewInfo) {
+
+    rendr::Image image;
+    image.image = device.createImage(imageInfo);
+    image.allocation = allocator.allocateForImage(image.image, properties);
+    image.mipLevels = imageInfo.mipLevels;
+
+    imageViewInfo.image = *image.image;
+    image.imageView = device.createImageView(imageViewInfo);
+
+    return image;
+}
+
+rendr::Buffer createBuffer(const rendr::Allocator &allocator, const vk::raii::Device &device, vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties, const std::vector<uint32_t> &queueFamilies)
+{
+    vk::BufferCreateInfo bufferInfo(
+    {},
+    size,
+    usage,
+    vk::SharingMode::eExclusive);
+    if (queueFamilies.size() > 1) {
+        bufferInfo.setSharingMode(vk::SharingMode::eConcurrent);
+        bufferInfo.setQueueFamilyIndices(queueFamilies);
+    }
+    rendr::Buffer buffer;
+    buffer.buffer = vk::raii::Buffer(device, bufferInfo);
+    buffer.allocation = allocator.allocateForBuffer(buffer.buffer, properties);
+
+    return buffer;
+}
+
+}
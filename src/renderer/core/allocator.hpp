@@ -0,0 +1,114 @@
+#pragma once
+
+#include <vector>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "vk_mem_alloc.h"
+
+namespace rendr{
+
+//Owning handle of a sub-allocation carved out of one of the allocator's memory blocks
+class Allocation {
+private:
+    VmaAllocator allocator_ = VK_NULL_HANDLE;
+    VmaAllocation allocation_ = VK_NULL_HANDLE;
+
+public:
+    Allocation() = default;
+    Allocation(std::nullptr_t) {}
+    Allocation(VmaAllocator allocator, VmaAllocation allocation)
+        : allocator_(allocator), allocation_(allocation) {}
+
+    Allocation(const Allocation&) = delete;
+    Allocation& operator=(const Allocation&) = delete;
+
+    Allocation(Allocation&& other) noexcept;
+    Allocation& operator=(Allocation&& other) noexcept;
+
+    ~Allocation();
+
+    //host visible allocations stay persistently mapped, returns pointer to the beginning of the allocation
+    //or nullptr for device local memory
+    void* getMappedData() const;
+
+    vk::DeviceMemory getDeviceMemory() const;
+    vk::DeviceSize getOffset() const;
+    vk::DeviceSize getSize() const;
+
+    void clear();
+
+    VmaAllocation operator*() const{
+        return allocation_;
+    }
+};
+
+struct HeapUsage{
+    vk::MemoryHeapFlags flags;
+    vk::DeviceSize heapSize = 0;
+    //memory blocks allocated from the driver with vkAllocateMemory
+    uint32_t blockCount = 0;
+    vk::DeviceSize blockBytes = 0;
+    //resources placed inside those blocks
+    uint32_t allocationCount = 0;
+    vk::DeviceSize allocationBytes = 0;
+    //estimated usage of the whole process and the budget available to it
+    vk::DeviceSize usage = 0;
+    vk::DeviceSize budget = 0;
+};
+
+//Device level allocator, places buffers and images into big memory blocks
+//instead of calling vkAllocateMemory per resource. Alignment and bufferImageGranularity are handled by VMA
+class Allocator {
+private:
+    VmaAllocator allocator_ = VK_NULL_HANDLE;
+
+public:
+    Allocator() = default;
+    Allocator(std::nullptr_t) {}
+    Allocator(const vk::raii::Instance& instance, const vk::raii::PhysicalDevice& physicalDevice, const vk::raii::Device& device, uint32_t vulkanApiVersion);
+
+    Allocator(const Allocator&) = delete;
+    Allocator& operator=(const Allocator&) = delete;
+
+    Allocator(Allocator&& other) noexcept;
+    Allocator& operator=(Allocator&& other) noexcept;
+
+    ~Allocator();
+
+    //allocates memory for the buffer and binds it, host visible memory is mapped for the allocation lifetime
+    Allocation allocateForBuffer(const vk::raii::Buffer& buffer, vk::MemoryPropertyFlags properties) const;
+
+    //allocates memory for the image and binds it
+    Allocation allocateForImage(const vk::raii::Image& image, vk::MemoryPropertyFlags properties) const;
+
+    //one entry per memory heap of the physical device
+    std::vector<HeapUsage> getHeapUsage() const;
+
+    void clear();
+
+    VmaAllocator operator*() const{
+        return allocator_;
+    }
+};
+
+struct Image{
+    vk::raii::ImageView imageView;
+    rendr::Allocation allocation;
+    vk::raii::Image image;
+    uint32_t mipLevels = 1;
+
+    Image() : image(nullptr), allocation(nullptr), imageView(nullptr){}
+};
+
+struct Buffer{
+    rendr::Allocation allocation;
+    vk::raii::Buffer buffer;
+    Buffer() : buffer(nullptr), allocation(nullptr){}
+};
+
+rendr::Image createImage(const rendr::Allocator &allocator, const vk::raii::Device &device, vk::MemoryPropertyFlags properties, vk::ImageCreateInfo imageInfo, vk::ImageViewCreateInfo imageViewInfo);
+
+//buffer is shared between queueFamilies in concurrent mode if more than one family is passed
+rendr::Buffer createBuffer(const rendr::Allocator &allocator, const vk::raii::Device &device, vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties, const std::vector<uint32_t> &queueFamilies = {});
+
+}
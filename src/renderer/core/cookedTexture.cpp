@@ -0,0 +1,128 @@
+#include "cookedTexture.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace rendr{
+
+static const char cookedTextureMagic[4] = {'R', 'T', 'E', 'X'};
+
+uint32_t getCookedFormatBlockSize(CookedTextureFormat format){
+    switch (format) {
+    case CookedTextureFormat::RGBA8: return 4;
+    case CookedTextureFormat::BC1: return 8;
+    case CookedTextureFormat::BC5: return 16;
+    case CookedTextureFormat::BC7: return 16;
+    }
+    throw std::invalid_argument("unknown cooked texture format!");
+}
+
+bool isBlockCompressed(CookedTextureFormat format){
+    return format != CookedTextureFormat::RGBA8;
+}
+
+uint64_t calcCookedLevelSize(CookedTextureFormat format, uint32_t width, uint32_t height){
+    uint64_t blockSize = getCookedFormatBlockSize(format);
+    if (!isBlockCompressed(format)) {
+        return uint64_t(width) * height * blockSize;
+    }
+    return uint64_t((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+}
+
+static CookedTextureHeader readCookedTextureHeader(std::ifstream& file, uint64_t fileSize, const std::string& filePath){
+    CookedTextureHeader header;
+    if (fileSize < sizeof(header) || !file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        memcmp(header.magic, cookedTextureMagic, sizeof(header.magic)) != 0) {
+        throw std::runtime_error("not a cooked texture: " + filePath);
+    }
+    if (header.version != cookedTextureVersion) {
+        throw std::runtime_error("unsupported cooked texture version: " + filePath);
+    }
+    //a full chain ends at 1x1, longer ones can't be valid
+    uint32_t maxMipLevels = 1;
+    for (uint32_t size = std::max(header.width, header.height); size > 1; size /= 2) {
+        maxMipLevels++;
+    }
+    if (header.format > static_cast<uint32_t>(CookedTextureFormat::BC7) || header.width == 0 || header.height == 0 ||
+        header.mipLevels == 0 || header.mipLevels > maxMipLevels) {
+        throw std::runtime_error("corrupted cooked texture header: " + filePath);
+    }
+    return header;
+}
+
+CookedTextureHeader loadCookedTextureHeader(const std::string& filePath){
+    std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open cooked texture " + filePath);
+    }
+    uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+    return readCookedTextureHeader(file, fileSize, filePath);
+}
+
+CookedTexture loadCookedTexture(const std::string& filePath){
+    std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open cooked texture " + filePath);
+    }
+    uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+
+    CookedTextureHeader header = readCookedTextureHeader(file, fileSize, filePath);
+
+    CookedTexture texture;
+    texture.format = static_cast<CookedTextureFormat>(header.format);
+    texture.srgb = header.srgb != 0;
+    texture.width = header.width;
+    texture.height = header.height;
+    texture.levels.resize(header.mipLevels);
+
+    uint64_t levelTableSize = sizeof(CookedMip) * header.mipLevels;
+    if (fileSize < sizeof(header) + levelTableSize ||
+        !file.read(reinterpret_cast<char*>(texture.levels.data()), levelTableSize)) {
+        throw std::runtime_error("truncated cooked texture: " + filePath);
+    }
+
+    uint64_t dataSize = fileSize - sizeof(header) - levelTableSize;
+    for (uint32_t i = 0; i < header.mipLevels; i++) {
+        //level i halves the extent i times, its size has to match that extent
+        const CookedMip& level = texture.levels[i];
+        bool extentMatches = level.width == std::max(1u, header.width >> i) && level.height == std::max(1u, header.height >> i);
+        if (!extentMatches || level.size != calcCookedLevelSize(texture.format, level.width, level.height) ||
+            level.offset > dataSize || level.size > dataSize - level.offset) {
+            throw std::runtime_error("corrupted cooked texture level table: " + filePath);
+        }
+    }
+
+    texture.data.resize(dataSize);
+    if (!file.read(reinterpret_cast<char*>(texture.data.data()), dataSize)) {
+        throw std::runtime_error("truncated cooked texture: " + filePath);
+    }
+    return texture;
+}
+
+void saveCookedTexture(const std::string& filePath, const CookedTexture& texture){
+    CookedTextureHeader header{};
+    memcpy(header.magic, cookedTextureMagic, sizeof(header.magic));
+    header.version = cookedTextureVersion;
+    header.format = static_cast<uint32_t>(texture.format);
+    header.srgb = texture.srgb ? 1 : 0;
+    header.width = texture.width;
+    header.height = texture.height;
+    header.mipLevels = static_cast<uint32_t>(texture.levels.size());
+
+    std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to create " + filePath);
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(texture.levels.data()), sizeof(CookedMip) * texture.levels.size());
+    file.write(reinterpret_cast<const char*>(texture.data.data()), texture.data.size());
+    if (!file) {
+        throw std::runtime_error("failed to write " + filePath);
+    }
+}
+
+}
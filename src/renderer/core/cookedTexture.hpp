@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace rendr{
+
+enum class CookedTextureFormat : uint32_t{
+    RGBA8 = 0,
+    BC1 = 1,
+    BC5 = 2,
+    BC7 = 3
+};
+
+struct CookedMip{
+    uint32_t width;
+    uint32_t height;
+    //byte offset inside CookedTexture::data
+    uint64_t offset;
+    uint64_t size;
+};
+
+//Texture produced by texcooker: every mip level already encoded, ready to be copied into an image as is.
+//File layout: CookedTextureHeader, mipLevels * CookedMip, level data
+struct CookedTexture{
+    CookedTextureFormat format = CookedTextureFormat::RGBA8;
+    bool srgb = true;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<CookedMip> levels;
+    std::vector<uint8_t> data;
+};
+
+struct CookedTextureHeader{
+    char magic[4];
+    uint32_t version;
+    uint32_t format;
+    uint32_t srgb;
+    uint32_t width;
+    uint32_t height;
+    uint32_t mipLevels;
+    uint32_t reserved;
+};
+
+const uint32_t cookedTextureVersion = 1;
+
+//bytes per 4x4 block, or per pixel for RGBA8
+uint32_t getCookedFormatBlockSize(CookedTextureFormat format);
+bool isBlockCompressed(CookedTextureFormat format);
+//size of one level, block compressed levels are rounded up to whole blocks
+uint64_t calcCookedLevelSize(CookedTextureFormat format, uint32_t width, uint32_t height);
+
+//reads and validates the header only, to pick between a cooked file and its source before loading the data
+CookedTextureHeader loadCookedTextureHeader(const std::string& filePath);
+CookedTexture loadCookedTexture(const std::string& filePath);
+void saveCookedTexture(const std::string& filePath, const CookedTexture& texture);
+
+}
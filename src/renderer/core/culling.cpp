@@ -0,0 +1,470 @@
+#include "culling.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "utility.hpp"
+
+namespace rendr{
+
+static const uint32_t cullGroupSize = 64;
+static const uint32_t hizGroupSize = 8;
+
+//mirrors isSphereOccluded of cull.comp, both paths have to agree on the visibility set
+bool isSphereOccluded(const HiZLevels& hiz, const glm::mat4& viewProj, const glm::vec4& sphere){
+    if (!hiz.data || hiz.levelCount == 0) {
+        return false;
+    }
+
+    glm::vec3 minNdc(1e30f);
+    glm::vec3 maxNdc(-1e30f);
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 corner = glm::vec3(sphere) + sphere.w * glm::vec3((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f);
+        glm::vec4 clip = viewProj * glm::vec4(corner, 1.0f);
+        //the box crosses the camera plane, its projection is unbounded
+        if (clip.w <= 1e-5f) {
+            return false;
+        }
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        minNdc = glm::min(minNdc, ndc);
+        maxNdc = glm::max(maxNdc, ndc);
+    }
+    if (minNdc.z <= 0.0f) {
+        return false;
+    }
+
+    glm::ivec2 size(static_cast<int>(hiz.width), static_cast<int>(hiz.height));
+    glm::vec2 sizeF(size);
+    glm::ivec2 minPixel = glm::clamp(glm::ivec2(glm::floor(glm::clamp(glm::vec2(minNdc) * 0.5f + 0.5f, 0.0f, 1.0f) * sizeF)), glm::ivec2(0), size - 1);
+    glm::ivec2 maxPixel = glm::clamp(glm::ivec2(glm::floor(glm::clamp(glm::vec2(maxNdc) * 0.5f + 0.5f, 0.0f, 1.0f) * sizeF)), glm::ivec2(0), size - 1);
+    int rectSize = std::max(maxPixel.x - minPixel.x, maxPixel.y - minPixel.y) + 1;
+    int level = 0;
+    while ((1 << level) < rectSize) {
+        level++;
+    }
+    level = std::min(level, static_cast<int>(hiz.levelCount) - 1);
+
+    const float* levelData = hiz.data;
+    for (int i = 0; i < level; i++) {
+        levelData += static_cast<size_t>(std::max(size.x >> i, 1)) * std::max(size.y >> i, 1);
+    }
+    glm::ivec2 levelSize = glm::max(glm::ivec2(size.x >> level, size.y >> level), glm::ivec2(1));
+    glm::ivec2 minTexel = glm::min(glm::ivec2(minPixel.x >> level, minPixel.y >> level), levelSize - 1);
+    glm::ivec2 maxTexel = glm::min(glm::ivec2(maxPixel.x >> level, maxPixel.y >> level), levelSize - 1);
+    float farthest = 0.0f;
+    for (int y = minTexel.y; y <= maxTexel.y; y++) {
+        for (int x = minTexel.x; x <= maxTexel.x; x++) {
+            farthest = std::max(farthest, levelData[static_cast<size_t>(y) * levelSize.x + x]);
+        }
+    }
+    return minNdc.z > farthest;
+}
+
+static vk::raii::Pipeline createComputePipeline(const rendr::Device& device, const vk::raii::PipelineLayout& layout, const std::string& shaderPath){
+    std::vector<char> code = rendr::readFile(shaderPath);
+    vk::raii::ShaderModule shaderModule = rendr::createShaderModule(device.device_, code);
+    vk::PipelineShaderStageCreateInfo stageInfo({}, vk::ShaderStageFlagBits::eCompute, *shaderModule, "main");
+    vk::ComputePipelineCreateInfo pipelineInfo({}, stageInfo, *layout);
+    return device.pipelineCache_.createComputePipeline(device.device_, pipelineInfo);
+}
+
+static rendr::Buffer createHostReadBuffer(const rendr::Allocator& allocator, const vk::raii::Device& device, vk::DeviceSize size){
+    vk::MemoryPropertyFlags coherent = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+    try {
+        return rendr::createBuffer(allocator, device, size, vk::BufferUsageFlagBits::eTransferDst, coherent | vk::MemoryPropertyFlagBits::eHostCached);
+    } catch (const std::runtime_error&) {
+        return rendr::createBuffer(allocator, device, size, vk::BufferUsageFlagBits::eTransferDst, coherent);
+    }
+}
+
+static uint32_t levelExtent(uint32_t extent, uint32_t level){
+    return std::max(extent >> level, 1u);
+}
+
+CullingPass::CullingPass()
+: cullSetLayout_(nullptr), hizSetLayout_(nullptr), cullPipelineLayout_(nullptr), hizPipelineLayout_(nullptr),
+cullPipeline_(nullptr), hizPipeline_(nullptr), cullDescriptorPool_(nullptr), hizDescriptorPool_(nullptr){}
+
+void CullingPass::create(const rendr::Device& device, CullingMode mode, bool occlusion, uint32_t framesInFlight, uint32_t maxDraws,
+    const std::string& shaderDirectory, const std::vector<rendr::Buffer>& drawDataBuffers, const std::vector<rendr::Buffer>& sourceCommandBuffers){
+
+    clear();
+    mode_ = mode;
+    occlusion_ = mode != CullingMode::eNone && occlusion;
+    compact_ = mode == CullingMode::eGpu && device.enabledVulkan12Features_.drawIndirectCount;
+    if (mode_ == CullingMode::eNone) {
+        return;
+    }
+    const vk::raii::Device& vkDevice = device.device_;
+    device_ = &vkDevice;
+
+    //pyramid texels are fetched, never filtered
+    vk::SamplerCreateInfo samplerInfo(
+        {}, // flags
+        vk::Filter::eNearest, // magFilter
+        vk::Filter::eNearest, // minFilter
+        vk::SamplerMipmapMode::eNearest, // mipmapMode
+        vk::SamplerAddressMode::eClampToEdge, // addressModeU
+        vk::SamplerAddressMode::eClampToEdge, // addressModeV
+        vk::SamplerAddressMode::eClampToEdge, // addressModeW
+        0.0f, // mipLodBias
+        VK_FALSE, // anisotropyEnable
+        1.0f, // maxAnisotropy
+        VK_FALSE, // compareEnable
+        vk::CompareOp::eAlways, // compareOp
+        0.0f, // minLod
+        VK_LOD_CLAMP_NONE // maxLod
+    );
+    sampler_ = device.samplerCache_.get(samplerInfo);
+
+    if (occlusion_) {
+        hizSetLayout_ = rendr::createDescriptorSetLayout(vkDevice, {
+            vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eCompute),
+            vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageImage, 1, vk::ShaderStageFlagBits::eCompute)
+        });
+        vk::PushConstantRange hizPushConstants(vk::ShaderStageFlagBits::eCompute, 0, sizeof(HiZPushConstants));
+        hizPipelineLayout_ = rendr::createPipelineLayout(vkDevice, {*hizSetLayout_}, {hizPushConstants});
+        hizPipeline_ = createComputePipeline(device, hizPipelineLayout_, shaderDirectory + "/hiz.spv");
+    }
+
+    if (mode_ == CullingMode::eCpu) {
+        slotHizViewProjs_.assign(framesInFlight, glm::mat4(1.0f));
+        slotHizValid_.assign(framesInFlight, false);
+        return;
+    }
+
+    //the pyramid binding is always present, cull.comp skips it when occlusion is off
+    cullSetLayout_ = rendr::createDescriptorSetLayout(vkDevice, {
+        vk::DescriptorSetLayoutBinding(0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+        vk::DescriptorSetLayoutBinding(1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+        vk::DescriptorSetLayoutBinding(2, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+        vk::DescriptorSetLayoutBinding(3, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+        vk::DescriptorSetLayoutBinding(4, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute),
+        vk::DescriptorSetLayoutBinding(5, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eCompute)
+    });
+    cullPipelineLayout_ = rendr::createPipelineLayout(vkDevice, {*cullSetLayout_}, {});
+    cullPipeline_ = createComputePipeline(device, cullPipelineLayout_, shaderDirectory + "/cull.spv");
+
+    std::array<vk::DescriptorPoolSize, 3> poolSizes = {
+        vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, framesInFlight),
+        vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, 4 * framesInFlight),
+        vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, framesInFlight)
+    };
+    vk::DescriptorPoolCreateInfo poolInfo(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet, framesInFlight, poolSizes);
+    cullDescriptorPool_ = vk::raii::DescriptorPool(vkDevice, poolInfo);
+    cullSets_ = rendr::createDescriptorSets(vkDevice, cullDescriptorPool_, cullSetLayout_, framesInFlight);
+    cullSetsStale_.assign(framesInFlight, false);
+
+    vk::DeviceSize commandsSize = sizeof(vk::DrawIndexedIndirectCommand) * static_cast<vk::DeviceSize>(maxDraws);
+    for (uint32_t i = 0; i < framesInFlight; i++) {
+        paramBuffers_.push_back(rendr::createBuffer(device.allocator_, vkDevice, sizeof(CullParams),
+            vk::BufferUsageFlagBits::eUniformBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent));
+        culledCommands_.push_back(rendr::createBuffer(device.allocator_, vkDevice, commandsSize,
+            vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal));
+        //one count per run, every run holds at least one draw so there are never more runs than maxDraws
+        drawCounts_.push_back(rendr::createBuffer(device.allocator_, vkDevice, sizeof(uint32_t) * static_cast<vk::DeviceSize>(maxDraws),
+            vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst,
+            vk::MemoryPropertyFlagBits::eDeviceLocal));
+
+        vk::DescriptorBufferInfo paramsInfo(*paramBuffers_[i].buffer, 0, sizeof(CullParams));
+        vk::DescriptorBufferInfo drawDataInfo(*drawDataBuffers[i].buffer, 0, VK_WHOLE_SIZE);
+        vk::DescriptorBufferInfo sourceInfo(*sourceCommandBuffers[i].buffer, 0, VK_WHOLE_SIZE);
+        vk::DescriptorBufferInfo culledInfo(*culledCommands_[i].buffer, 0, VK_WHOLE_SIZE);
+        vk::DescriptorBufferInfo countsInfo(*drawCounts_[i].buffer, 0, VK_WHOLE_SIZE);
+        std::array<vk::WriteDescriptorSet, 5> descriptorWrites = {
+            vk::WriteDescriptorSet(*cullSets_[i], 0, 0, 1, vk::DescriptorType::eUniformBuffer, nullptr, &paramsInfo, nullptr),
+            vk::WriteDescriptorSet(*cullSets_[i], 1, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &drawDataInfo, nullptr),
+            vk::WriteDescriptorSet(*cullSets_[i], 2, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &sourceInfo, nullptr),
+            vk::WriteDescriptorSet(*cullSets_[i], 3, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &culledInfo, nullptr),
+            vk::WriteDescriptorSet(*cullSets_[i], 4, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &countsInfo, nullptr)
+        };
+        vkDevice.updateDescriptorSets(descriptorWrites, nullptr);
+    }
+}
+
+RetiredHiZ CullingPass::setDepthImage(const rendr::Device& device, const rendr::Image& depthImage, vk::Format depthFormat, vk::Extent2D extent){
+    RetiredHiZ retired;
+    if (mode_ == CullingMode::eNone) {
+        return retired;
+    }
+    const vk::raii::Device& vkDevice = device.device_;
+
+    retired.image = std::move(hiz_);
+    retired.levelViews = std::move(hizLevelViews_);
+    retired.descriptorPool = std::move(hizDescriptorPool_);
+    retired.sets = std::move(hizSets_);
+    retired.readbacks = std::move(hizReadbacks_);
+    hiz_ = rendr::Image();
+    hizLevelViews_.clear();
+    hizSets_.clear();
+    hizReadbacks_.clear();
+    hizValid_ = false;
+    hizInGeneralLayout_ = false;
+    std::fill(slotHizValid_.begin(), slotHizValid_.end(), false);
+    if (mode_ == CullingMode::eCpu && !occlusion_) {
+        return retired;
+    }
+
+    //without occlusion the cull set still needs a pyramid to bind, a 1x1 one that is never read
+    hizExtent_ = occlusion_ ? extent : vk::Extent2D(1, 1);
+    hizLevelCount_ = 1;
+    while (levelExtent(hizExtent_.width, hizLevelCount_ - 1) > 1 || levelExtent(hizExtent_.height, hizLevelCount_ - 1) > 1) {
+        hizLevelCount_++;
+    }
+    depthImage_ = *depthImage.image;
+    depthAspect_ = vk::ImageAspectFlagBits::eDepth;
+    if (depthFormat == vk::Format::eD32SfloatS8Uint || depthFormat == vk::Format::eD24UnormS8Uint || depthFormat == vk::Format::eD16UnormS8Uint) {
+        depthAspect_ |= vk::ImageAspectFlagBits::eStencil;
+    }
+
+    vk::ImageCreateInfo imageInfo(
+        {}, // flags
+        vk::ImageType::e2D, // imageType
+        vk::Format::eR32Sfloat, // format
+        vk::Extent3D(hizExtent_.width, hizExtent_.height, 1), // extent
+        hizLevelCount_, // mipLevels
+        1, // arrayLayers
+        vk::SampleCountFlagBits::e1, // samples
+        vk::ImageTiling::eOptimal, // tiling
+        vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferSrc, // usage
+        vk::SharingMode::eExclusive, // sharingMode
+        0, // queueFamilyIndexCount
+        nullptr, // pQueueFamilyIndices
+        vk::ImageLayout::eUndefined // initialLayout
+    );
+    vk::ImageViewCreateInfo viewInfo(
+        {}, // flags
+        {}, // image
+        vk::ImageViewType::e2D, // viewType
+        vk::Format::eR32Sfloat, // format
+        {}, // components
+        vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, hizLevelCount_, 0, 1) // subresourceRange
+    );
+    hiz_ = rendr::createImage(device.allocator_, vkDevice, vk::MemoryPropertyFlagBits::eDeviceLocal, imageInfo, viewInfo);
+    hiz_.mipLevels = hizLevelCount_;
+
+    if (occlusion_) {
+        for (uint32_t level = 0; level < hizLevelCount_; level++) {
+            viewInfo.image = *hiz_.image;
+            viewInfo.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, level, 1, 0, 1);
+            hizLevelViews_.push_back(vk::raii::ImageView(vkDevice, viewInfo));
+        }
+
+        std::array<vk::DescriptorPoolSize, 2> poolSizes = {
+            vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, hizLevelCount_),
+            vk::DescriptorPoolSize(vk::DescriptorType::eStorageImage, hizLevelCount_)
+        };
+        vk::DescriptorPoolCreateInfo poolInfo(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet, hizLevelCount_, poolSizes);
+        hizDescriptorPool_ = vk::raii::DescriptorPool(vkDevice, poolInfo);
+        hizSets_ = rendr::createDescriptorSets(vkDevice, hizDescriptorPool_, hizSetLayout_, static_cast<int>(hizLevelCount_));
+        for (uint32_t level = 0; level < hizLevelCount_; level++) {
+            vk::DescriptorImageInfo sourceInfo = level == 0
+                ? vk::DescriptorImageInfo(sampler_, *depthImage.imageView, vk::ImageLayout::eDepthStencilReadOnlyOptimal)
+                : vk::DescriptorImageInfo(sampler_, *hizLevelViews_[level - 1], vk::ImageLayout::eGeneral);
+            vk::DescriptorImageInfo destinationInfo(nullptr, *hizLevelViews_[level], vk::ImageLayout::eGeneral);
+            std::array<vk::WriteDescriptorSet, 2> descriptorWrites = {
+                vk::WriteDescriptorSet(*hizSets_[level], 0, 0, 1, vk::DescriptorType::eCombinedImageSampler, &sourceInfo, nullptr, nullptr),
+                vk::WriteDescriptorSet(*hizSets_[level], 1, 0, 1, vk::DescriptorType::eStorageImage, &destinationInfo, nullptr, nullptr)
+            };
+            vkDevice.updateDescriptorSets(descriptorWrites, nullptr);
+        }
+    }
+
+    if (mode_ == CullingMode::eCpu) {
+        vk::DeviceSize pyramidSize = 0;
+        for (uint32_t level = 0; level < hizLevelCount_; level++) {
+            pyramidSize += sizeof(float) * static_cast<vk::DeviceSize>(levelExtent(hizExtent_.width, level)) * levelExtent(hizExtent_.height, level);
+        }
+        for (size_t i = 0; i < slotHizValid_.size(); i++) {
+            hizReadbacks_.push_back(createHostReadBuffer(device.allocator_, vkDevice, pyramidSize));
+        }
+        return retired;
+    }
+
+    //sets bound by frames in flight can't be updated, each one is rewritten by writeCullCommands
+    std::fill(cullSetsStale_.begin(), cullSetsStale_.end(), true);
+    return retired;
+}
+
+void CullingPass::cullOnHost(rendr::DrawList& drawList, int frame) const{
+    if (!occlusion_ || !slotHizValid_[frame]) {
+        return;
+    }
+    HiZLevels levels;
+    levels.data = static_cast<const float*>(hizReadbacks_[frame].allocation.getMappedData());
+    levels.width = hizExtent_.width;
+    levels.height = hizExtent_.height;
+    levels.levelCount = hizLevelCount_;
+    const glm::mat4& hizViewProj = slotHizViewProjs_[frame];
+
+    drawList.removeIf([&](const rendr::DrawPacket& packet){
+        if (packet.boundingSphere.w < 0.0f) {
+            return false;
+        }
+        return isSphereOccluded(levels, hizViewProj, transformBoundingSphere(packet.model, packet.boundingSphere));
+    });
+}
+
+rendr::CulledDrawTarget CullingPass::writeCullCommands(const vk::raii::CommandBuffer& commandBuffer, int frame, uint32_t drawCount, const glm::mat4& viewProj){
+    if (cullSetsStale_[frame]) {
+        //the pyramid is read in eGeneral only, a never built pyramid is never read either
+        vk::DescriptorImageInfo hizInfo(sampler_, *hiz_.imageView, vk::ImageLayout::eGeneral);
+        vk::WriteDescriptorSet write(*cullSets_[frame], 5, 0, 1, vk::DescriptorType::eCombinedImageSampler, &hizInfo, nullptr, nullptr);
+        device_->updateDescriptorSets(write, nullptr);
+        cullSetsStale_[frame] = false;
+    }
+
+    CullParams params{};
+    FrustumPlanes planes = extractFrustumPlanes(viewProj);
+    std::copy(planes.begin(), planes.end(), params.frustumPlanes);
+    params.hizViewProj = hizViewProj_;
+    params.hizSize = glm::vec2(static_cast<float>(hizExtent_.width), static_cast<float>(hizExtent_.height));
+    params.hizLevelCount = hizLevelCount_;
+    params.drawCount = drawCount;
+    params.occlusionEnabled = occlusion_ && hizValid_;
+    params.compact = compact_;
+    memcpy(paramBuffers_[frame].allocation.getMappedData(), &params, sizeof(params));
+
+    if (compact_) {
+        commandBuffer.fillBuffer(*drawCounts_[frame].buffer, 0, VK_WHOLE_SIZE, 0);
+    }
+    //cleared counts and last frame's pyramid writes
+    vk::MemoryBarrier beforeCull(
+        vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eShaderWrite,
+        vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite
+    );
+    std::vector<vk::ImageMemoryBarrier> hizLayout;
+    if (!hizInGeneralLayout_) {
+        hizLayout.push_back(vk::ImageMemoryBarrier(
+            {}, vk::AccessFlagBits::eShaderRead, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral,
+            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, *hiz_.image,
+            vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, hizLevelCount_, 0, 1)));
+        hizInGeneralLayout_ = true;
+    }
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader,
+        vk::PipelineStageFlagBits::eComputeShader, {}, beforeCull, nullptr, hizLayout);
+
+    if (drawCount > 0) {
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, *cullPipeline_);
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, *cullPipelineLayout_, 0, *cullSets_[frame], nullptr);
+        commandBuffer.dispatch((drawCount + cullGroupSize - 1) / cullGroupSize, 1, 1);
+    }
+
+    vk::MemoryBarrier afterCull(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eIndirectCommandRead);
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eDrawIndirect,
+        {}, afterCull, nullptr, nullptr);
+
+    rendr::CulledDrawTarget target;
+    target.commands = *culledCommands_[frame].buffer;
+    if (compact_) {
+        target.counts = *drawCounts_[frame].buffer;
+    }
+    return target;
+}
+
+void CullingPass::writeBuildHiZCommands(const vk::raii::CommandBuffer& commandBuffer, int frame, const glm::mat4& viewProj){
+    if (!occlusion_) {
+        return;
+    }
+
+    vk::ImageSubresourceRange depthRange(depthAspect_, 0, 1, 0, 1);
+    vk::ImageSubresourceRange hizRange(vk::ImageAspectFlagBits::eColor, 0, hizLevelCount_, 0, 1);
+    std::array<vk::ImageMemoryBarrier, 2> beforeBuild = {
+        vk::ImageMemoryBarrier(
+            vk::AccessFlagBits::eDepthStencilAttachmentWrite, vk::AccessFlagBits::eShaderRead,
+            vk::ImageLayout::eDepthStencilAttachmentOptimal, vk::ImageLayout::eDepthStencilReadOnlyOptimal,
+            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, depthImage_, depthRange),
+        //the cull pass of this frame read the old pyramid
+        vk::ImageMemoryBarrier(
+            {}, vk::AccessFlagBits::eShaderWrite,
+            hizInGeneralLayout_ ? vk::ImageLayout::eGeneral : vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral,
+            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, *hiz_.image, hizRange)
+    };
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eLateFragmentTests | vk::PipelineStageFlagBits::eComputeShader,
+        vk::PipelineStageFlagBits::eComputeShader, {}, nullptr, nullptr, beforeBuild);
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, *hizPipeline_);
+    for (uint32_t level = 0; level < hizLevelCount_; level++) {
+        HiZPushConstants pushConstants;
+        uint32_t sourceLevel = level == 0 ? 0 : level - 1;
+        pushConstants.sourceSize[0] = static_cast<int32_t>(levelExtent(hizExtent_.width, sourceLevel));
+        pushConstants.sourceSize[1] = static_cast<int32_t>(levelExtent(hizExtent_.height, sourceLevel));
+        pushConstants.destinationSize[0] = static_cast<int32_t>(levelExtent(hizExtent_.width, level));
+        pushConstants.destinationSize[1] = static_cast<int32_t>(levelExtent(hizExtent_.height, level));
+        pushConstants.copyDepth = level == 0;
+
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, *hizPipelineLayout_, 0, *hizSets_[level], nullptr);
+        commandBuffer.pushConstants<HiZPushConstants>(*hizPipelineLayout_, vk::ShaderStageFlagBits::eCompute, 0, pushConstants);
+        commandBuffer.dispatch((pushConstants.destinationSize[0] + hizGroupSize - 1) / hizGroupSize,
+            (pushConstants.destinationSize[1] + hizGroupSize - 1) / hizGroupSize, 1);
+
+        vk::ImageMemoryBarrier levelWritten(
+            vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eTransferRead,
+            vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral,
+            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, *hiz_.image,
+            vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, level, 1, 0, 1));
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+            vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr, levelWritten);
+    }
+
+    //next frame's pass clears depth only after the pyramid build is done reading it
+    vk::ImageMemoryBarrier afterBuild(
+        {}, vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+        vk::ImageLayout::eDepthStencilReadOnlyOptimal, vk::ImageLayout::eDepthStencilAttachmentOptimal,
+        VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, depthImage_, depthRange);
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+        vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests, {}, nullptr, nullptr, afterBuild);
+
+    hizValid_ = true;
+    hizInGeneralLayout_ = true;
+    hizViewProj_ = viewProj;
+
+    if (mode_ == CullingMode::eCpu) {
+        std::vector<vk::BufferImageCopy> regions;
+        vk::DeviceSize offset = 0;
+        for (uint32_t level = 0; level < hizLevelCount_; level++) {
+            uint32_t width = levelExtent(hizExtent_.width, level);
+            uint32_t height = levelExtent(hizExtent_.height, level);
+            regions.push_back(vk::BufferImageCopy(offset, 0, 0, vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level, 0, 1),
+                vk::Offset3D(0, 0, 0), vk::Extent3D(width, height, 1)));
+            offset += sizeof(float) * static_cast<vk::DeviceSize>(width) * height;
+        }
+        commandBuffer.copyImageToBuffer(*hiz_.image, vk::ImageLayout::eGeneral, *hizReadbacks_[frame].buffer, regions);
+
+        vk::BufferMemoryBarrier hostRead(
+            vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead,
+            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, *hizReadbacks_[frame].buffer, 0, VK_WHOLE_SIZE);
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {}, nullptr, hostRead, nullptr);
+
+        slotHizViewProjs_[frame] = viewProj;
+        slotHizValid_[frame] = true;
+    }
+}
+
+void CullingPass::clear(){
+    cullSets_.clear();
+    hizSets_.clear();
+    cullDescriptorPool_.clear();
+    hizDescriptorPool_.clear();
+    hizLevelViews_.clear();
+    hiz_ = rendr::Image();
+    hizReadbacks_.clear();
+    paramBuffers_.clear();
+    culledCommands_.clear();
+    drawCounts_.clear();
+    cullPipeline_.clear();
+    hizPipeline_.clear();
+    cullPipelineLayout_.clear();
+    hizPipelineLayout_.clear();
+    cullSetLayout_.clear();
+    hizSetLayout_.clear();
+    sampler_ = nullptr;
+    slotHizViewProjs_.clear();
+    slotHizValid_.clear();
+    hizValid_ = false;
+    hizInGeneralLayout_ = false;
+    mode_ = CullingMode::eNone;
+}
+
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan_raii.hpp>
+#include <glm/glm.hpp>
+
+#include "allocator.hpp"
+#include "drawList.hpp"
+
+namespace rendr{
+
+struct Device;
+
+enum class CullingMode{
+    //every draw is submitted
+    eNone,
+    //a compute pass writes the indirect commands, needs multiDrawIndirect and drawIndirectFirstInstance
+    eGpu,
+    //same tests on the host against the read back pyramid, for devices without indirect draw support and for checking eGpu
+    eCpu
+};
+
+//host copy of the HiZ pyramid, level i is max(1, width >> i) x max(1, height >> i) floats right after level i - 1
+struct HiZLevels{
+    const float* data = nullptr;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t levelCount = 0;
+};
+
+//true if the sphere is behind the farthest depth of every pyramid texel it covers,
+//viewProj is the matrix the pyramid's depth was rendered with
+bool isSphereOccluded(const HiZLevels& hiz, const glm::mat4& viewProj, const glm::vec4& sphere);
+
+//uniform block of cull.comp, std140
+struct CullParams{
+    glm::vec4 frustumPlanes[6];
+    glm::mat4 hizViewProj;
+    glm::vec2 hizSize;
+    uint32_t hizLevelCount;
+    uint32_t drawCount;
+    uint32_t occlusionEnabled;
+    uint32_t compact;
+    uint32_t padding[2];
+};
+
+//pyramid resources replaced by CullingPass::setDepthImage, frames still in flight may use them
+struct RetiredHiZ{
+    rendr::Image image;
+    std::vector<vk::raii::ImageView> levelViews;
+    vk::raii::DescriptorPool descriptorPool;
+    //freed before their pool
+    std::vector<vk::raii::DescriptorSet> sets;
+    std::vector<rendr::Buffer> readbacks;
+
+    RetiredHiZ() : descriptorPool(nullptr){}
+};
+
+//Frustum and HiZ occlusion culling of the prepared draw list. The pyramid is built from
+//the depth of the previous frame, draws are tested against last frame's occluders
+class CullingPass{
+private:
+    struct HiZPushConstants{
+        int32_t sourceSize[2];
+        int32_t destinationSize[2];
+        uint32_t copyDepth;
+    };
+
+    CullingMode mode_ = CullingMode::eNone;
+    bool occlusion_ = false;
+    //visible commands are packed per run and drawn with vkCmdDrawIndexedIndirectCount
+    bool compact_ = false;
+
+    vk::raii::DescriptorSetLayout cullSetLayout_;
+    vk::raii::DescriptorSetLayout hizSetLayout_;
+    vk::raii::PipelineLayout cullPipelineLayout_;
+    vk::raii::PipelineLayout hizPipelineLayout_;
+    vk::raii::Pipeline cullPipeline_;
+    vk::raii::Pipeline hizPipeline_;
+    //from the device's sampler cache
+    vk::Sampler sampler_;
+    vk::raii::DescriptorPool cullDescriptorPool_;
+    vk::raii::DescriptorPool hizDescriptorPool_;
+    std::vector<vk::raii::DescriptorSet> cullSets_;
+    //the set of a frame slot still points at a replaced pyramid, rewritten once the slot is recorded again
+    std::vector<bool> cullSetsStale_;
+    const vk::raii::Device* device_ = nullptr;
+    //set i reads level i - 1, or the depth attachment for level 0, and writes level i
+    std::vector<vk::raii::DescriptorSet> hizSets_;
+    std::vector<rendr::Buffer> paramBuffers_;
+    std::vector<rendr::Buffer> culledCommands_;
+    std::vector<rendr::Buffer> drawCounts_;
+
+    rendr::Image hiz_;
+    std::vector<vk::raii::ImageView> hizLevelViews_;
+    vk::Extent2D hizExtent_;
+    uint32_t hizLevelCount_ = 0;
+    vk::Image depthImage_;
+    vk::ImageAspectFlags depthAspect_;
+    //the pyramid holds the depth rendered with hizViewProj_
+    bool hizValid_ = false;
+    //the pyramid is only ever used in eGeneral, the first use moves it out of eUndefined
+    bool hizInGeneralLayout_ = false;
+    glm::mat4 hizViewProj_{1.0f};
+
+    //eCpu only: pyramid of the last frame recorded in each slot, read once the slot's fence signaled
+    std::vector<rendr::Buffer> hizReadbacks_;
+    std::vector<glm::mat4> slotHizViewProjs_;
+    std::vector<bool> slotHizValid_;
+
+public:
+    CullingPass();
+
+    CullingPass(const CullingPass&) = delete;
+    CullingPass& operator=(const CullingPass&) = delete;
+
+    //drawDataBuffers and sourceCommandBuffers are the per frame buffers the draw list is prepared into,
+    //hiz.spv and cull.spv are loaded from shaderDirectory
+    void create(const rendr::Device& device, CullingMode mode, bool occlusion, uint32_t framesInFlight, uint32_t maxDraws,
+        const std::string& shaderDirectory, const std::vector<rendr::Buffer>& drawDataBuffers, const std::vector<rendr::Buffer>& sourceCommandBuffers);
+
+    //rebuilds the pyramid for a new depth attachment. Frames may still be in flight, the old
+    //pyramid is handed back to be freed once they finished
+    RetiredHiZ setDepthImage(const rendr::Device& device, const rendr::Image& depthImage, vk::Format depthFormat, vk::Extent2D extent);
+
+    CullingMode getMode() const{
+        return mode_;
+    }
+
+    //eCpu: drops the draws the pyramid occludes, before DrawList::prepare. The frustum test is DrawList::cullFrustum
+    void cullOnHost(rendr::DrawList& drawList, int frame) const;
+
+    //eGpu: writes the culled commands of the prepared draw list, outside the frame pass
+    rendr::CulledDrawTarget writeCullCommands(const vk::raii::CommandBuffer& commandBuffer, int frame, uint32_t drawCount, const glm::mat4& viewProj);
+
+    //after the frame pass: builds the pyramid from the depth attachment and leaves it in attachment layout.
+    //In eCpu mode the pyramid is also copied for the host
+    void writeBuildHiZCommands(const vk::raii::CommandBuffer& commandBuffer, int frame, const glm::mat4& viewProj);
+
+    void clear();
+};
+
+}
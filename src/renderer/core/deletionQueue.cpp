@@ -0,0 +1,21 @@
+#include "deletionQueue.hpp"
+
+namespace rendr{
+
+DeletionQueue::~DeletionQueue(){
+    flush();
+}
+
+void DeletionQueue::collect(const std::function<bool(uint64_t frameNumber, rendr::UploadTicket uploadTicket)>& isComplete){
+    while (!entries_.empty() && isComplete(entries_.front().frameNumber, entries_.front().uploadTicket)) {
+        entries_.pop_front();
+    }
+}
+
+void DeletionQueue::flush(){
+    while (!entries_.empty()) {
+        entries_.pop_front();
+    }
+}
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "uploadContext.hpp"
+
+namespace rendr{
+
+//Takes ownership of resources the GPU may still be using and destroys them once the frames
+//and uploads that could reference them finished. Entries are destroyed in the order they were pushed
+class DeletionQueue{
+private:
+    struct Entry{
+        //every frame numbered below it has to be complete
+        uint64_t frameNumber;
+        rendr::UploadTicket uploadTicket;
+        //type erased owner, destroying it runs the resource's destructor
+        std::shared_ptr<void> resource;
+    };
+
+    std::deque<Entry> entries_;
+
+public:
+    DeletionQueue() = default;
+    ~DeletionQueue();
+
+    DeletionQueue(const DeletionQueue&) = delete;
+    DeletionQueue& operator=(const DeletionQueue&) = delete;
+
+    //frame numbers and tickets have to be pushed in non decreasing order
+    template<typename T>
+    void push(uint64_t frameNumber, rendr::UploadTicket uploadTicket, T&& resource){
+        static_assert(!std::is_lvalue_reference<T>::value, "resources are moved into the queue");
+        entries_.push_back({frameNumber, uploadTicket, std::make_shared<std::decay_t<T>>(std::move(resource))});
+    }
+
+    //destroys the oldest entries while isComplete returns true for them
+    void collect(const std::function<bool(uint64_t frameNumber, rendr::UploadTicket uploadTicket)>& isComplete);
+
+    //destroys every entry, nothing may be in flight
+    void flush();
+
+    size_t size() const{
+        return entries_.size();
+    }
+};
+
+}
@@ -0,0 +1,118 @@
+#include "descriptorAllocator.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace rendr{
+
+void DescriptorAllocator::create(const vk::raii::Device& device, uint32_t setsPerPool, std::vector<DescriptorPoolRatio> ratios, uint32_t frameCount){
+    clear();
+    if (setsPerPool == 0 || ratios.empty()) {
+        throw std::runtime_error("descriptor allocator needs sets and pool ratios!");
+    }
+    device_ = &device;
+    ratios_ = std::move(ratios);
+
+    lists_.reset(setsPerPool, frameCount);
+    pools_.resize(frameCount + 1);
+    for (uint32_t list = 0; list < pools_.size(); list++) {
+        addPool(list);
+    }
+}
+
+vk::raii::DescriptorPool DescriptorAllocator::createPool(uint32_t setCount, vk::DescriptorPoolCreateFlags flags) const{
+    std::vector<vk::DescriptorPoolSize> poolSizes;
+    poolSizes.reserve(ratios_.size());
+    for (const DescriptorPoolRatio& ratio : ratios_) {
+        uint32_t descriptorCount = std::max(1u, static_cast<uint32_t>(ratio.ratio * setCount));
+        poolSizes.push_back(vk::DescriptorPoolSize(ratio.type, descriptorCount));
+    }
+
+    vk::DescriptorPoolCreateInfo poolInfo(
+        flags, // flags
+        setCount, // maxSets
+        static_cast<uint32_t>(poolSizes.size()), // poolSizeCount
+        poolSizes.data() // pPoolSizes
+    );
+    return vk::raii::DescriptorPool(*device_, poolInfo);
+}
+
+void DescriptorAllocator::addPool(uint32_t list){
+    //persistent sets are freed through their handles, transient pools are only reset as a whole
+    vk::DescriptorPoolCreateFlags flags;
+    if (list == DescriptorPoolLists::persistentList) {
+        flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet;
+    }
+    lists_.addPool(list);
+    pools_[list].push_back(createPool(lists_.getSetsPerPool(list), flags));
+}
+
+vk::raii::DescriptorSet DescriptorAllocator::allocateFrom(uint32_t list, vk::DescriptorSetLayout layout){
+    while (true) {
+        std::optional<uint32_t> pool = lists_.getPool(list);
+        bool freshPool = !pool;
+        if (freshPool) {
+            addPool(list);
+            pool = lists_.getPool(list);
+        }
+        vk::DescriptorSetAllocateInfo allocInfo(*pools_[list][*pool], 1, &layout);
+        try {
+            vk::raii::DescriptorSets sets(*device_, allocInfo);
+            lists_.markAllocated(list);
+            return std::move(sets.front());
+        } catch (const vk::OutOfPoolMemoryError&) {
+            //an empty pool that fails means the layout doesn't fit the ratios
+            if (freshPool) {
+                throw;
+            }
+        } catch (const vk::FragmentedPoolError&) {
+            if (freshPool) {
+                throw;
+            }
+        }
+        lists_.markFull(list);
+    }
+}
+
+vk::raii::DescriptorSet DescriptorAllocator::allocate(vk::DescriptorSetLayout layout){
+    std::lock_guard<std::mutex> lock(mutex_);
+    return allocateFrom(DescriptorPoolLists::persistentList, layout);
+}
+
+std::vector<vk::raii::DescriptorSet> DescriptorAllocator::allocate(vk::DescriptorSetLayout layout, uint32_t count){
+    std::vector<vk::raii::DescriptorSet> sets;
+    sets.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        sets.push_back(allocate(layout));
+    }
+    return sets;
+}
+
+vk::DescriptorSet DescriptorAllocator::allocateTransient(uint32_t frame, vk::DescriptorSetLayout layout){
+    std::lock_guard<std::mutex> lock(mutex_);
+    //the pool has no free flag, the whole pool is reset instead
+    return vk::DescriptorSet(allocateFrom(DescriptorPoolLists::getFrameList(frame), layout).release());
+}
+
+void DescriptorAllocator::resetFrame(uint32_t frame){
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (vk::raii::DescriptorPool& pool : pools_.at(DescriptorPoolLists::getFrameList(frame))) {
+        pool.reset();
+    }
+    lists_.resetFrame(frame);
+}
+
+DescriptorAllocatorStats DescriptorAllocator::getStats() const{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lists_.getStats();
+}
+
+void DescriptorAllocator::clear(){
+    std::lock_guard<std::mutex> lock(mutex_);
+    pools_.clear();
+    lists_ = DescriptorPoolLists();
+    ratios_.clear();
+    device_ = nullptr;
+}
+
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "descriptorPoolLists.hpp"
+
+namespace rendr{
+
+//descriptors of a type per set in a pool, a pool of n sets gets ratio * n of them
+struct DescriptorPoolRatio{
+    vk::DescriptorType type;
+    float ratio = 1.0f;
+};
+
+//Grows a list of descriptor pools instead of sizing one pool for everything up front. A pool that reports
+//eErrorOutOfPoolMemory or eErrorFragmentedPool is set aside and the next one, half again as large, is tried.
+//Persistent sets are freed one by one through their raii handles, so before every growth the persistent pools set aside
+//are tried once more and the space of freed sets is reused. Transient sets come from one pool list per frame
+//slot and are all returned by resetFrame with vkResetDescriptorPool once the slot's fence signaled. Which pool is
+//tried next is decided by DescriptorPoolLists, the allocator only creates, allocates from and resets the pools
+class DescriptorAllocator{
+private:
+    const vk::raii::Device* device_ = nullptr;
+    std::vector<DescriptorPoolRatio> ratios_;
+    DescriptorPoolLists lists_;
+    //indexed by the list, then by the pool index lists_ hands out
+    std::vector<std::vector<vk::raii::DescriptorPool>> pools_;
+    //recording jobs allocate transient sets in parallel
+    mutable std::mutex mutex_;
+
+    vk::raii::DescriptorPool createPool(uint32_t setCount, vk::DescriptorPoolCreateFlags flags) const;
+    void addPool(uint32_t list);
+    vk::raii::DescriptorSet allocateFrom(uint32_t list, vk::DescriptorSetLayout layout);
+
+public:
+    DescriptorAllocator() = default;
+
+    DescriptorAllocator(const DescriptorAllocator&) = delete;
+    DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+    //sets of the pool added after a pool of setsPerPool ran out
+    static uint32_t getGrownPoolSize(uint32_t setsPerPool){
+        return DescriptorPoolLists::getGrownPoolSize(setsPerPool);
+    }
+
+    //frameCount transient pool lists, every list starts with one pool of setsPerPool sets
+    void create(const vk::raii::Device& device, uint32_t setsPerPool, std::vector<DescriptorPoolRatio> ratios, uint32_t frameCount);
+
+    //freed when the handle is destroyed, the allocator has to outlive it
+    vk::raii::DescriptorSet allocate(vk::DescriptorSetLayout layout);
+    std::vector<vk::raii::DescriptorSet> allocate(vk::DescriptorSetLayout layout, uint32_t count);
+
+    //valid until resetFrame(frame), not freed on its own
+    vk::DescriptorSet allocateTransient(uint32_t frame, vk::DescriptorSetLayout layout);
+
+    //the GPU is done with the frame slot, its transient sets go back all at once
+    void resetFrame(uint32_t frame);
+
+    DescriptorAllocatorStats getStats() const;
+
+    void clear();
+};
+
+}
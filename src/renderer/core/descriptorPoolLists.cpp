@@ -0,0 +1,87 @@
+#include "descriptorPoolLists.hpp"
+
+#include <algorithm>
+
+namespace rendr{
+
+uint32_t DescriptorPoolLists::getGrownPoolSize(uint32_t setsPerPool){
+    if (setsPerPool >= maxDescriptorSetsPerPool) {
+        return setsPerPool;
+    }
+    //half again as large, at least one more set so pools of one set grow too
+    return std::min(std::max(setsPerPool + setsPerPool / 2, setsPerPool + 1), maxDescriptorSetsPerPool);
+}
+
+void DescriptorPoolLists::reset(uint32_t setsPerPool, uint32_t frameCount){
+    lists_.assign(frameCount + 1, PoolList());
+    for (PoolList& list : lists_) {
+        list.setsPerPool = setsPerPool;
+    }
+    poolGrowths_ = 0;
+}
+
+std::optional<uint32_t> DescriptorPoolLists::getPool(uint32_t list){
+    PoolList& pools = lists_.at(list);
+    //sets freed through their handles left room in the full pools, try them once before growing
+    if (pools.ready.empty() && list == persistentList && !pools.fullRetried && !pools.full.empty()) {
+        pools.ready = std::move(pools.full);
+        pools.full.clear();
+        pools.fullRetried = true;
+    }
+    if (pools.ready.empty()) {
+        return std::nullopt;
+    }
+    return pools.ready.back();
+}
+
+uint32_t DescriptorPoolLists::addPool(uint32_t list){
+    PoolList& pools = lists_.at(list);
+    if (pools.poolCount > 0) {
+        pools.setsPerPool = getGrownPoolSize(pools.setsPerPool);
+        poolGrowths_++;
+    }
+    pools.ready.push_back(pools.poolCount);
+    pools.fullRetried = false;
+    return pools.poolCount++;
+}
+
+void DescriptorPoolLists::markAllocated(uint32_t list){
+    lists_.at(list).allocatedSets++;
+}
+
+void DescriptorPoolLists::markFull(uint32_t list){
+    PoolList& pools = lists_.at(list);
+    pools.full.push_back(pools.ready.back());
+    pools.ready.pop_back();
+}
+
+void DescriptorPoolLists::resetFrame(uint32_t frame){
+    PoolList& pools = lists_.at(getFrameList(frame));
+    pools.ready.insert(pools.ready.end(), pools.full.begin(), pools.full.end());
+    pools.full.clear();
+    pools.allocatedSets = 0;
+}
+
+uint32_t DescriptorPoolLists::getSetsPerPool(uint32_t list) const{
+    return lists_.at(list).setsPerPool;
+}
+
+uint32_t DescriptorPoolLists::getPoolCount(uint32_t list) const{
+    return lists_.at(list).poolCount;
+}
+
+DescriptorAllocatorStats DescriptorPoolLists::getStats() const{
+    DescriptorAllocatorStats stats;
+    for (uint32_t list = 0; list < lists_.size(); list++) {
+        if (list == persistentList) {
+            stats.persistentSets = lists_[list].allocatedSets;
+        } else {
+            stats.transientSets += lists_[list].allocatedSets;
+        }
+        stats.pools += lists_[list].poolCount;
+    }
+    stats.poolGrowths = poolGrowths_;
+    return stats;
+}
+
+}
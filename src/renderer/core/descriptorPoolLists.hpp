@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace rendr{
+
+//pools stop growing there, larger pools only waste memory on rarely used types
+const uint32_t maxDescriptorSetsPerPool = 4096;
+
+struct DescriptorAllocatorStats{
+    //sets handed out by allocate since create
+    uint64_t persistentSets = 0;
+    //sets handed out by allocateTransient since the frames were last reset
+    uint64_t transientSets = 0;
+    uint32_t pools = 0;
+    //pools added because the existing ones ran out
+    uint32_t poolGrowths = 0;
+};
+
+//Device-free bookkeeping of the DescriptorAllocator's pools. List persistentList holds pools whose sets are freed one
+//by one, every frame slot has a transient list reset as a whole. Pools are named by their index in their list, the owner
+//keeps the actual pools in the same order and creates one whenever addPool hands out a new index. Not thread safe, the owner locks
+class DescriptorPoolLists{
+private:
+    struct PoolList{
+        std::vector<uint32_t> full;
+        //the last one is allocated from
+        std::vector<uint32_t> ready;
+        uint32_t poolCount = 0;
+        uint32_t setsPerPool = 0;
+        uint64_t allocatedSets = 0;
+        //full pools went back to ready since the last growth
+        bool fullRetried = false;
+    };
+
+    std::vector<PoolList> lists_;
+    uint32_t poolGrowths_ = 0;
+
+public:
+    static const uint32_t persistentList = 0;
+
+    static uint32_t getFrameList(uint32_t frame){
+        return frame + 1;
+    }
+
+    //sets of the pool added after a pool of setsPerPool ran out
+    static uint32_t getGrownPoolSize(uint32_t setsPerPool);
+
+    //the persistent list and frameCount transient lists, none of them has a pool yet
+    void reset(uint32_t setsPerPool, uint32_t frameCount);
+
+    //pool to allocate the next set of the list from, empty when every pool failed since the last growth or reset
+    std::optional<uint32_t> getPool(uint32_t list);
+
+    //index of the pool the owner has to create with getSetsPerPool(list) sets, pools after the list's first one are growths
+    uint32_t addPool(uint32_t list);
+
+    //the set came from the pool getPool last handed out
+    void markAllocated(uint32_t list);
+
+    //the pool getPool last handed out is out of memory or fragmented, the next one is tried
+    void markFull(uint32_t list);
+
+    //the owner reset every pool of the frame's list, they are all ready again
+    void resetFrame(uint32_t frame);
+
+    uint32_t getSetsPerPool(uint32_t list) const;
+
+    uint32_t getPoolCount(uint32_t list) const;
+
+    DescriptorAllocatorStats getStats() const;
+};
+
+}
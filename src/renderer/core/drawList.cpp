@@ -0,0 +1,242 @@
+#include "drawList.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace rendr{
+
+//key layout from the most significant bit: pipeline 12 | descriptor set 14 | vertex buffer 12 | index buffer 12 | depth 14
+//ids past a field's range wrap, that only costs extra binds since recording compares the real handles
+static const uint32_t pipelineBits = 12;
+static const uint32_t descriptorSetBits = 14;
+static const uint32_t vertexBufferBits = 12;
+static const uint32_t indexBufferBits = 12;
+static const uint32_t depthBits = 14;
+
+template<typename Handle>
+static uint64_t handleBits(Handle handle){
+    typename Handle::CType raw = static_cast<typename Handle::CType>(handle);
+    uint64_t bits = 0;
+    memcpy(&bits, &raw, sizeof(raw));
+    return bits;
+}
+
+static uint64_t field(uint64_t value, uint32_t bits){
+    return value & ((uint64_t(1) << bits) - 1);
+}
+
+float computeDrawDepth(const glm::mat4& viewProj, const glm::mat4& model, const glm::vec4& boundingSphere){
+    glm::vec4 clip = viewProj * model * glm::vec4(glm::vec3(boundingSphere), 1.0f);
+    //behind the camera, the draw is culled or crosses the near plane
+    if (clip.w <= 0.0f) {
+        return 0.0f;
+    }
+    return std::min(std::max(clip.z / clip.w, 0.0f), 1.0f);
+}
+
+uint32_t DrawList::HandleIds::get(uint64_t handle){
+    auto it = ids.find(handle);
+    if (it != ids.end()) {
+        return it->second;
+    }
+    uint32_t id = static_cast<uint32_t>(ids.size());
+    ids.emplace(handle, id);
+    return id;
+}
+
+void DrawList::clear(){
+    packets_.clear();
+    items_.clear();
+    pipelineIds_.ids.clear();
+    descriptorSetIds_.ids.clear();
+    vertexBufferIds_.ids.clear();
+    indexBufferIds_.ids.clear();
+    bounds_.clear();
+}
+
+void DrawList::add(const DrawPacket& packet){
+    float depth = std::min(std::max(packet.depth, 0.0f), 1.0f);
+    uint64_t depthQuantized = static_cast<uint64_t>(depth * ((1 << depthBits) - 1));
+
+    uint64_t key = field(pipelineIds_.get(handleBits(packet.pipeline)), pipelineBits);
+    key = (key << descriptorSetBits) | field(descriptorSetIds_.get(handleBits(packet.materialSet)), descriptorSetBits);
+    key = (key << vertexBufferBits) | field(vertexBufferIds_.get(handleBits(packet.vertexBuffer)), vertexBufferBits);
+    key = (key << indexBufferBits) | field(indexBufferIds_.get(handleBits(packet.indexBuffer)), indexBufferBits);
+    key = (key << depthBits) | depthQuantized;
+
+    items_.push_back(SortItem{key, static_cast<uint32_t>(packets_.size())});
+    packets_.push_back(packet);
+    bounds_.push(packet.boundingSphere.w < 0.0f ? packet.boundingSphere : transformBoundingSphere(packet.model, packet.boundingSphere));
+}
+
+void DrawList::sort(){
+    size_t count = items_.size();
+    if (count < 2) {
+        return;
+    }
+    scratch_.resize(count);
+
+    for (uint32_t shift = 0; shift < 64; shift += 8) {
+        size_t offsets[256] = {};
+        for (const SortItem& item : items_) {
+            offsets[(item.key >> shift) & 0xFF]++;
+        }
+        if (offsets[(items_[0].key >> shift) & 0xFF] == count) {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (size_t& bucket : offsets) {
+            size_t bucketSize = bucket;
+            bucket = offset;
+            offset += bucketSize;
+        }
+        for (const SortItem& item : items_) {
+            scratch_[offsets[(item.key >> shift) & 0xFF]++] = item;
+        }
+        items_.swap(scratch_);
+    }
+}
+
+static bool sameState(const DrawPacket& a, const DrawPacket& b){
+    return a.pipeline == b.pipeline && a.pipelineLayout == b.pipelineLayout
+        && (!b.materialSet || a.materialSet == b.materialSet)
+        && a.vertexBuffer == b.vertexBuffer && a.vertexBufferOffset == b.vertexBufferOffset
+        && a.indexBuffer == b.indexBuffer && a.indexBufferOffset == b.indexBufferOffset && a.indexType == b.indexType;
+}
+
+void DrawList::cullFrustum(const FrustumPlanes& planes){
+    bounds_.cull(planes, visibility_);
+    items_.erase(std::remove_if(items_.begin(), items_.end(), [&](const SortItem& item){
+        return ((visibility_[item.packet / 64] >> (item.packet % 64)) & 1) == 0;
+    }), items_.end());
+}
+
+void DrawList::removeIf(const std::function<bool(const DrawPacket&)>& culled){
+    items_.erase(std::remove_if(items_.begin(), items_.end(), [&](const SortItem& item){
+        return culled(packets_[item.packet]);
+    }), items_.end());
+}
+
+void DrawList::prepare(const IndirectDrawTarget& target){
+    if (items_.size() > target.capacity) {
+        throw std::runtime_error("too many draws for the indirect buffer!");
+    }
+
+    runs_.clear();
+    for (uint32_t drawIndex = 0; drawIndex < items_.size(); drawIndex++) {
+        const DrawPacket& packet = packets_[items_[drawIndex].packet];
+
+        bool newRun = runs_.empty() || runs_.back().count == target.maxDrawIndirectCount
+            || !sameState(packets_[items_[runs_.back().first].packet], packet);
+        if (newRun) {
+            runs_.push_back(DrawRun{drawIndex, 0});
+        }
+        DrawRun& run = runs_.back();
+        run.count++;
+
+        DrawData& data = target.drawData[drawIndex];
+        data.model = packet.model;
+        data.boundingSphere = packet.boundingSphere;
+        data.runIndex = static_cast<uint32_t>(runs_.size() - 1);
+        data.runFirst = run.first;
+        data.textureIndex = packet.textureIndex;
+        if (target.multiDrawIndirect) {
+            target.commands[drawIndex] = vk::DrawIndexedIndirectCommand(packet.indexCount, 1, packet.firstIndex, packet.vertexOffset, drawIndex);
+        }
+    }
+}
+
+DrawStats DrawList::record(const vk::raii::CommandBuffer& commandBuffer, vk::DescriptorSet frameSet, uint32_t frameSetDynamicOffset,
+    const IndirectDrawTarget& target, const CulledDrawTarget* culled, uint32_t firstRun, uint32_t endRun) const{
+
+    DrawStats stats;
+    vk::Pipeline boundPipeline;
+    vk::PipelineLayout boundLayout;
+    vk::DescriptorSet boundMaterialSet;
+    vk::Buffer boundVertexBuffer;
+    vk::DeviceSize boundVertexOffset = 0;
+    vk::Buffer boundIndexBuffer;
+    vk::DeviceSize boundIndexOffset = 0;
+    vk::IndexType boundIndexType = vk::IndexType::eUint32;
+
+    const vk::DeviceSize stride = sizeof(vk::DrawIndexedIndirectCommand);
+    endRun = std::min(endRun, static_cast<uint32_t>(runs_.size()));
+    for (uint32_t runIndex = firstRun; runIndex < endRun; runIndex++) {
+        const DrawRun& run = runs_[runIndex];
+        const DrawPacket& packet = packets_[items_[run.first].packet];
+
+        if (packet.pipeline != boundPipeline) {
+            commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, packet.pipeline);
+            boundPipeline = packet.pipeline;
+            stats.pipelineBinds++;
+        }
+        if (packet.pipelineLayout != boundLayout) {
+            //sets are bound again on a layout switch rather than relying on layout compatibility
+            commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, packet.pipelineLayout, 0, frameSet, frameSetDynamicOffset);
+            boundLayout = packet.pipelineLayout;
+            boundMaterialSet = nullptr;
+            stats.descriptorSetBinds++;
+        }
+        if (packet.materialSet && packet.materialSet != boundMaterialSet) {
+            commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, packet.pipelineLayout, 1, packet.materialSet, nullptr);
+            boundMaterialSet = packet.materialSet;
+            stats.descriptorSetBinds++;
+        }
+        if (packet.vertexBuffer != boundVertexBuffer || packet.vertexBufferOffset != boundVertexOffset) {
+            commandBuffer.bindVertexBuffers(0, packet.vertexBuffer, packet.vertexBufferOffset);
+            boundVertexBuffer = packet.vertexBuffer;
+            boundVertexOffset = packet.vertexBufferOffset;
+            stats.vertexBufferBinds++;
+        }
+        if (packet.indexBuffer != boundIndexBuffer || packet.indexBufferOffset != boundIndexOffset || packet.indexType != boundIndexType) {
+            commandBuffer.bindIndexBuffer(packet.indexBuffer, packet.indexBufferOffset, packet.indexType);
+            boundIndexBuffer = packet.indexBuffer;
+            boundIndexOffset = packet.indexBufferOffset;
+            boundIndexType = packet.indexType;
+            stats.indexBufferBinds++;
+        }
+
+        if (!target.multiDrawIndirect) {
+            for (uint32_t drawIndex = run.first; drawIndex < run.first + run.count; drawIndex++) {
+                const DrawPacket& draw = packets_[items_[drawIndex].packet];
+                commandBuffer.drawIndexed(draw.indexCount, 1, draw.firstIndex, draw.vertexOffset, drawIndex);
+                stats.drawCalls++;
+            }
+        } else if (culled && culled->counts) {
+            commandBuffer.drawIndexedIndirectCount(culled->commands, stride * run.first,
+                culled->counts, sizeof(uint32_t) * runIndex, run.count, stride);
+            stats.drawCalls++;
+        } else {
+            commandBuffer.drawIndexedIndirect(culled ? culled->commands : target.indirectBuffer, stride * run.first, run.count, stride);
+            stats.drawCalls++;
+        }
+        stats.draws += run.count;
+    }
+    return stats;
+}
+
+std::vector<uint32_t> DrawList::splitRuns(uint32_t maxParts, bool multiDrawIndirect) const{
+    const uint32_t runCount = static_cast<uint32_t>(runs_.size());
+    uint64_t totalCost = 0;
+    for (const DrawRun& run : runs_) {
+        totalCost += multiDrawIndirect ? 1 : run.count;
+    }
+
+    std::vector<uint32_t> bounds = {0};
+    uint32_t parts = std::max(1u, maxParts);
+    uint64_t cost = 0;
+    for (uint32_t runIndex = 0; runIndex < runCount; runIndex++) {
+        cost += multiDrawIndirect ? 1 : runs_[runIndex].count;
+        //part k ends once the cost reached k / parts of the total
+        uint64_t partEnd = (totalCost * bounds.size() + parts - 1) / parts;
+        if (cost >= partEnd && runIndex + 1 < runCount && bounds.size() < parts) {
+            bounds.push_back(runIndex + 1);
+        }
+    }
+    bounds.push_back(runCount);
+    return bounds;
+}
+
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan_raii.hpp>
+#include <glm/glm.hpp>
+
+#include "frustum.hpp"
+
+namespace rendr{
+
+//Everything needed to record one indexed draw, filled by drawable objects instead of recording commands themselves
+struct DrawPacket{
+    vk::Pipeline pipeline;
+    vk::PipelineLayout pipelineLayout;
+    //set 1 of the pipeline layout, set 0 is the renderer's frame set
+    vk::DescriptorSet materialSet;
+    //slot in the renderer's texture table, read from the draw data so it doesn't split runs
+    uint32_t textureIndex = 0;
+    vk::Buffer vertexBuffer;
+    vk::DeviceSize vertexBufferOffset = 0;
+    vk::Buffer indexBuffer;
+    vk::DeviceSize indexBufferOffset = 0;
+    vk::IndexType indexType = vk::IndexType::eUint32;
+    uint32_t indexCount = 0;
+    uint32_t firstIndex = 0;
+    int32_t vertexOffset = 0;
+    //normalized view depth, 0 is near, see computeDrawDepth. Sorts draws front to back within the same state
+    float depth = 0.0f;
+    glm::mat4 model{1.0f};
+    //xyz center, w radius in mesh space, a negative radius is never culled
+    glm::vec4 boundingSphere{0.0f, 0.0f, 0.0f, -1.0f};
+};
+
+//per draw data read by the vertex shader with gl_InstanceIndex and by the culling pass, std430 layout
+struct DrawData{
+    alignas(16) glm::mat4 model;
+    glm::vec4 boundingSphere;
+    //run of the draw and the first command of that run, visible draws are compacted to the front of the run
+    uint32_t runIndex;
+    uint32_t runFirst;
+    uint32_t textureIndex;
+    uint32_t padding;
+};
+
+//consecutive sorted draws sharing all bound state, issued as one indirect draw
+struct DrawRun{
+    uint32_t first = 0;
+    uint32_t count = 0;
+};
+
+//commands written by the GPU culling pass, drawn instead of the draw list's own commands
+struct CulledDrawTarget{
+    vk::Buffer commands;
+    //one visible command count per run. Without it culled commands stay in place with instanceCount 0
+    vk::Buffer counts;
+};
+
+//persistently mapped buffers of one frame the draw list writes its commands and draw data into
+struct IndirectDrawTarget{
+    vk::Buffer indirectBuffer;
+    vk::DrawIndexedIndirectCommand* commands = nullptr;
+    rendr::DrawData* drawData = nullptr;
+    uint32_t capacity = 0;
+    //devices without multiDrawIndirect or drawIndirectFirstInstance get one drawIndexed per draw instead
+    bool multiDrawIndirect = false;
+    uint32_t maxDrawIndirectCount = 1;
+};
+
+//per frame counters of the commands the draw list actually recorded
+struct DrawStats{
+    uint32_t draws = 0;
+    //vkCmdDrawIndexedIndirect or vkCmdDrawIndexed calls the draws were issued with
+    uint32_t drawCalls = 0;
+    uint32_t pipelineBinds = 0;
+    uint32_t descriptorSetBinds = 0;
+    uint32_t vertexBufferBinds = 0;
+    uint32_t indexBufferBinds = 0;
+};
+
+//DrawPacket::depth of a draw: NDC depth of its bounding sphere center, clamped to [0, 1]
+float computeDrawDepth(const glm::mat4& viewProj, const glm::mat4& model, const glm::vec4& boundingSphere);
+
+//Draws of one frame sorted by a 64 bit state key so that draws sharing
+//pipeline, descriptor set and buffers end up next to each other
+class DrawList{
+private:
+    struct SortItem{
+        uint64_t key;
+        uint32_t packet;
+    };
+
+    //dense per frame ids of handles, they fit into the key fields
+    struct HandleIds{
+        std::unordered_map<uint64_t, uint32_t> ids;
+        uint32_t get(uint64_t handle);
+    };
+
+    std::vector<DrawPacket> packets_;
+    std::vector<SortItem> items_;
+    std::vector<SortItem> scratch_;
+    HandleIds pipelineIds_;
+    HandleIds descriptorSetIds_;
+    HandleIds vertexBufferIds_;
+    HandleIds indexBufferIds_;
+    std::vector<DrawRun> runs_;
+    //draw space bounds of packets_, same indices
+    BoundsTable bounds_;
+    std::vector<uint64_t> visibility_;
+    glm::mat4 viewProj_{1.0f};
+
+public:
+    void clear();
+
+    //camera of the frame, set before the draws are added so producers can compute DrawPacket::depth
+    void setViewProj(const glm::mat4& viewProj){
+        viewProj_ = viewProj;
+    }
+
+    const glm::mat4& getViewProj() const{
+        return viewProj_;
+    }
+
+    void add(const DrawPacket& packet);
+
+    //LSD radix sort of the keys, passes where every key has the same digit are skipped
+    void sort();
+
+    //drops draws whose bounds are outside the frustum, the remaining draws keep their order
+    void cullFrustum(const FrustumPlanes& planes);
+
+    //drops draws the predicate returns true for, the remaining draws keep their order
+    void removeIf(const std::function<bool(const DrawPacket&)>& culled);
+
+    //writes the commands and draw data of the sorted draws and splits them into runs.
+    //Draw i reads target.drawData[i]. Throws if the target is too small
+    void prepare(const IndirectDrawTarget& target);
+
+    //records the prepared runs [firstRun, endRun), a bind is emitted only when the state differs from the previous run.
+    //Every run is one indirect draw, from culled when it is given. State is bound from scratch, so a range
+    //can be recorded into its own secondary command buffer
+    DrawStats record(const vk::raii::CommandBuffer& commandBuffer, vk::DescriptorSet frameSet, uint32_t frameSetDynamicOffset,
+        const IndirectDrawTarget& target, const CulledDrawTarget* culled = nullptr,
+        uint32_t firstRun = 0, uint32_t endRun = UINT32_MAX) const;
+
+    //splits the prepared runs into at most maxParts ranges of about the same recording cost, a run costs
+    //one call with multiDrawIndirect and one per draw without. Returns the range bounds, part i is [bounds[i], bounds[i + 1])
+    std::vector<uint32_t> splitRuns(uint32_t maxParts, bool multiDrawIndirect) const;
+
+    size_t size() const{
+        return items_.size();
+    }
+
+    const std::vector<DrawRun>& getRuns() const{
+        return runs_;
+    }
+};
+
+}
@@ -0,0 +1,132 @@
+#include "frustum.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(RENDR_FRUSTUM_AVX)
+#include <immintrin.h>
+#elif defined(RENDR_FRUSTUM_SSE)
+#include <emmintrin.h>
+#endif
+
+namespace rendr{
+
+FrustumPlanes extractFrustumPlanes(const glm::mat4& viewProj){
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++) {
+        rows[i] = glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);
+    }
+
+    FrustumPlanes planes = {
+        rows[3] + rows[0],
+        rows[3] - rows[0],
+        rows[3] + rows[1],
+        rows[3] - rows[1],
+        rows[2],
+        rows[3] - rows[2]
+    };
+    for (glm::vec4& plane : planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return planes;
+}
+
+glm::vec4 transformBoundingSphere(const glm::mat4& model, const glm::vec4& sphere){
+    glm::vec3 center = glm::vec3(model * glm::vec4(glm::vec3(sphere), 1.0f));
+    float scaleSq = std::max(std::max(glm::dot(glm::vec3(model[0]), glm::vec3(model[0])), glm::dot(glm::vec3(model[1]), glm::vec3(model[1]))),
+        glm::dot(glm::vec3(model[2]), glm::vec3(model[2])));
+    return glm::vec4(center, sphere.w * std::sqrt(scaleSq));
+}
+
+bool isSphereInFrustum(const FrustumPlanes& planes, const glm::vec4& sphere){
+    for (const glm::vec4& plane : planes) {
+        if (glm::dot(glm::vec3(plane), glm::vec3(sphere)) + plane.w < -sphere.w) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void BoundsTable::clear(){
+    centerX_.clear();
+    centerY_.clear();
+    centerZ_.clear();
+    radius_.clear();
+    size_ = 0;
+}
+
+void BoundsTable::push(const glm::vec4& sphere){
+    size_t slot = size_ % 8;
+    if (slot == 0) {
+        //padding spheres have a -inf radius and are never visible
+        Lane zeros = {};
+        Lane padding;
+        std::fill(std::begin(padding.values), std::end(padding.values), -std::numeric_limits<float>::infinity());
+        centerX_.push_back(zeros);
+        centerY_.push_back(zeros);
+        centerZ_.push_back(zeros);
+        radius_.push_back(padding);
+    }
+    centerX_.back().values[slot] = sphere.x;
+    centerY_.back().values[slot] = sphere.y;
+    centerZ_.back().values[slot] = sphere.z;
+    //an infinite radius passes every plane
+    radius_.back().values[slot] = sphere.w < 0.0f ? std::numeric_limits<float>::infinity() : sphere.w;
+    size_++;
+}
+
+void BoundsTable::cull(const FrustumPlanes& planes, std::vector<uint64_t>& visibility) const{
+    visibility.assign((size_ + 63) / 64, 0);
+
+    for (size_t lane = 0; lane < radius_.size(); lane++) {
+        const float* x = centerX_[lane].values;
+        const float* y = centerY_[lane].values;
+        const float* z = centerZ_[lane].values;
+        const float* r = radius_[lane].values;
+        uint32_t mask = 0;
+
+#if defined(RENDR_FRUSTUM_AVX)
+        __m256 cx = _mm256_load_ps(x);
+        __m256 cy = _mm256_load_ps(y);
+        __m256 cz = _mm256_load_ps(z);
+        __m256 radius = _mm256_load_ps(r);
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (const glm::vec4& plane : planes) {
+            __m256 distance = _mm256_add_ps(_mm256_mul_ps(cx, _mm256_set1_ps(plane.x)), _mm256_mul_ps(cy, _mm256_set1_ps(plane.y)));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(cz, _mm256_set1_ps(plane.z)));
+            distance = _mm256_add_ps(distance, _mm256_add_ps(radius, _mm256_set1_ps(plane.w)));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_GE_OQ));
+        }
+        mask = static_cast<uint32_t>(_mm256_movemask_ps(inside));
+#elif defined(RENDR_FRUSTUM_SSE)
+        for (int half = 0; half < 2; half++) {
+            __m128 cx = _mm_load_ps(x + half * 4);
+            __m128 cy = _mm_load_ps(y + half * 4);
+            __m128 cz = _mm_load_ps(z + half * 4);
+            __m128 radius = _mm_load_ps(r + half * 4);
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (const glm::vec4& plane : planes) {
+                __m128 distance = _mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane.x)), _mm_mul_ps(cy, _mm_set1_ps(plane.y)));
+                distance = _mm_add_ps(distance, _mm_mul_ps(cz, _mm_set1_ps(plane.z)));
+                distance = _mm_add_ps(distance, _mm_add_ps(radius, _mm_set1_ps(plane.w)));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_setzero_ps()));
+            }
+            mask |= static_cast<uint32_t>(_mm_movemask_ps(inside)) << (half * 4);
+        }
+#else
+        for (int i = 0; i < 8; i++) {
+            bool inside = true;
+            for (const glm::vec4& plane : planes) {
+                inside = inside && x[i] * plane.x + y[i] * plane.y + z[i] * plane.z + (r[i] + plane.w) >= 0.0f;
+            }
+            mask |= static_cast<uint32_t>(inside) << i;
+        }
+#endif
+
+        size_t first = lane * 8;
+        visibility[first / 64] |= static_cast<uint64_t>(mask) << (first % 64);
+    }
+}
+
+}
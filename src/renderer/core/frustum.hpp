@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+//SIMD path of BoundsTable::cull, picked from the target flags of the build
+#if defined(__AVX__)
+#define RENDR_FRUSTUM_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RENDR_FRUSTUM_SSE
+#endif
+
+namespace rendr{
+
+//left, right, bottom, top, near, far. xyz is the normal pointing inside, w the distance
+using FrustumPlanes = std::array<glm::vec4, 6>;
+
+//planes in the input space of viewProj, near is z = 0 of the Vulkan clip volume
+FrustumPlanes extractFrustumPlanes(const glm::mat4& viewProj);
+
+//center moved by model, radius scaled by its largest axis scale. A negative radius stays negative
+glm::vec4 transformBoundingSphere(const glm::mat4& model, const glm::vec4& sphere);
+
+bool isSphereInFrustum(const FrustumPlanes& planes, const glm::vec4& sphere);
+
+//Bounding spheres kept as separate center x/y/z and radius arrays, padded to whole 8 wide lanes,
+//so the frustum test runs over 8 (AVX) or 4 (SSE) spheres per instruction
+class BoundsTable{
+private:
+    struct alignas(32) Lane{
+        float values[8];
+    };
+
+    std::vector<Lane> centerX_;
+    std::vector<Lane> centerY_;
+    std::vector<Lane> centerZ_;
+    std::vector<Lane> radius_;
+    size_t size_ = 0;
+
+public:
+    void clear();
+
+    //a negative radius marks an unbounded sphere, it is always visible
+    void push(const glm::vec4& sphere);
+
+    //bit i of the mask is set when sphere i touches the frustum
+    void cull(const FrustumPlanes& planes, std::vector<uint64_t>& visibility) const;
+
+    size_t size() const{
+        return size_;
+    }
+};
+
+}
@@ -0,0 +1,133 @@
+#include "geometryPool.hpp"
+
+#include <iterator>
+#include <stdexcept>
+
+namespace rendr{
+
+void FreeRanges::reset(uint32_t capacity){
+    free_.clear();
+    if (capacity > 0) {
+        free_[0] = capacity;
+    }
+}
+
+bool FreeRanges::allocate(uint32_t count, uint32_t& offset){
+    for (auto it = free_.begin(); it != free_.end(); ++it) {
+        if (it->second < count) {
+            continue;
+        }
+        offset = it->first;
+        uint32_t remaining = it->second - count;
+        free_.erase(it);
+        if (remaining > 0) {
+            free_[offset + count] = remaining;
+        }
+        return true;
+    }
+    return false;
+}
+
+void FreeRanges::free(uint32_t offset, uint32_t count){
+    if (count == 0) {
+        return;
+    }
+    auto next = free_.lower_bound(offset);
+    if (next != free_.end() && offset + count == next->first) {
+        count += next->second;
+        next = free_.erase(next);
+    }
+    if (next != free_.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            prev->second += count;
+            return;
+        }
+    }
+    free_[offset] = count;
+}
+
+GeometryAllocation::GeometryAllocation(GeometryAllocation&& other) noexcept
+    : pool_(other.pool_), range_(other.range_){
+    other.pool_ = nullptr;
+}
+
+GeometryAllocation& GeometryAllocation::operator=(GeometryAllocation&& other) noexcept{
+    if (this != &other) {
+        clear();
+        pool_ = other.pool_;
+        range_ = other.range_;
+        other.pool_ = nullptr;
+    }
+    return *this;
+}
+
+GeometryAllocation::~GeometryAllocation(){
+    clear();
+}
+
+void GeometryAllocation::clear(){
+    if (pool_) {
+        pool_->free(range_);
+        pool_ = nullptr;
+    }
+    range_ = GeometryRange();
+}
+
+void GeometryPool::create(const rendr::Allocator& allocator, const vk::raii::Device& device, uint32_t vertexStride,
+    uint32_t vertexCapacity, uint32_t indexCapacity, const std::vector<uint32_t>& queueFamilies){
+
+    vertexStride_ = vertexStride;
+    vertexBuffer_ = rendr::createBuffer(allocator, device, static_cast<vk::DeviceSize>(vertexStride) * vertexCapacity,
+        vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, queueFamilies);
+    indexBuffer_ = rendr::createBuffer(allocator, device, static_cast<vk::DeviceSize>(sizeof(uint32_t)) * indexCapacity,
+        vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer, vk::MemoryPropertyFlagBits::eDeviceLocal, queueFamilies);
+    vertexRanges_.reset(vertexCapacity);
+    indexRanges_.reset(indexCapacity);
+}
+
+GeometryAllocation GeometryPool::allocate(uint32_t vertexCount, uint32_t indexCount){
+    GeometryRange range;
+    range.vertexCount = vertexCount;
+    range.indexCount = indexCount;
+    if (!vertexRanges_.allocate(vertexCount, range.firstVertex)) {
+        throw std::runtime_error("geometry pool is out of vertex space!");
+    }
+    if (!indexRanges_.allocate(indexCount, range.firstIndex)) {
+        vertexRanges_.free(range.firstVertex, vertexCount);
+        throw std::runtime_error("geometry pool is out of index space!");
+    }
+    return GeometryAllocation(this, range);
+}
+
+void GeometryPool::free(const GeometryRange& range){
+    vertexRanges_.free(range.firstVertex, range.vertexCount);
+    indexRanges_.free(range.firstIndex, range.indexCount);
+}
+
+void GeometryPool::upload(rendr::UploadContext& uploadContext, const GeometryRange& range, const void* vertices, const uint32_t* indices){
+    vk::DeviceSize vertexBytes = static_cast<vk::DeviceSize>(vertexStride_) * range.vertexCount;
+    vk::DeviceSize indexBytes = sizeof(uint32_t) * static_cast<vk::DeviceSize>(range.indexCount);
+
+    if (vertexBytes > 0) {
+        rendr::StagingSpan staging = uploadContext.stage(vertices, vertexBytes);
+        vk::BufferCopy region(staging.offset, static_cast<vk::DeviceSize>(vertexStride_) * range.firstVertex, vertexBytes);
+        uploadContext.getCommandBuffer().copyBuffer(**staging.buffer, *vertexBuffer_.buffer, region);
+    }
+    if (indexBytes > 0) {
+        rendr::StagingSpan staging = uploadContext.stage(indices, indexBytes);
+        vk::BufferCopy region(staging.offset, sizeof(uint32_t) * static_cast<vk::DeviceSize>(range.firstIndex), indexBytes);
+        uploadContext.getCommandBuffer().copyBuffer(**staging.buffer, *indexBuffer_.buffer, region);
+    }
+}
+
+void GeometryPool::clear(){
+    vertexBuffer_.buffer.clear();
+    vertexBuffer_.allocation.clear();
+    indexBuffer_.buffer.clear();
+    indexBuffer_.allocation.clear();
+    vertexRanges_.reset(0);
+    indexRanges_.reset(0);
+}
+
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <map>
+#include <vector>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "allocator.hpp"
+#include "uploadContext.hpp"
+
+namespace rendr{
+
+//element ranges of one mesh inside the pool buffers, indices are relative to firstVertex
+struct GeometryRange{
+    uint32_t firstVertex = 0;
+    uint32_t vertexCount = 0;
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+};
+
+//first fit allocator of element ranges, neighbouring free ranges are merged
+class FreeRanges{
+private:
+    //offset -> size
+    std::map<uint32_t, uint32_t> free_;
+
+public:
+    void reset(uint32_t capacity);
+    bool allocate(uint32_t count, uint32_t& offset);
+    void free(uint32_t offset, uint32_t count);
+};
+
+class GeometryPool;
+
+//Owning handle of a pool range, the range goes back to the pool on destruction.
+//The GPU has to be done with the range by then
+class GeometryAllocation{
+private:
+    GeometryPool* pool_ = nullptr;
+    GeometryRange range_;
+
+public:
+    GeometryAllocation() = default;
+    GeometryAllocation(GeometryPool* pool, GeometryRange range)
+        : pool_(pool), range_(range) {}
+
+    GeometryAllocation(const GeometryAllocation&) = delete;
+    GeometryAllocation& operator=(const GeometryAllocation&) = delete;
+
+    GeometryAllocation(GeometryAllocation&& other) noexcept;
+    GeometryAllocation& operator=(GeometryAllocation&& other) noexcept;
+
+    ~GeometryAllocation();
+
+    void clear();
+
+    const GeometryRange& operator*() const{
+        return range_;
+    }
+
+    const GeometryRange* operator->() const{
+        return &range_;
+    }
+};
+
+//One vertex and one index buffer every mesh of a vertex layout is sub-allocated from,
+//so draws of different meshes share buffer bindings and can be merged into indirect draws
+class GeometryPool{
+private:
+    rendr::Buffer vertexBuffer_;
+    rendr::Buffer indexBuffer_;
+    uint32_t vertexStride_ = 0;
+    FreeRanges vertexRanges_;
+    FreeRanges indexRanges_;
+
+public:
+    GeometryPool() = default;
+
+    GeometryPool(const GeometryPool&) = delete;
+    GeometryPool& operator=(const GeometryPool&) = delete;
+
+    //buffers are shared between queueFamilies like any other upload destination
+    void create(const rendr::Allocator& allocator, const vk::raii::Device& device, uint32_t vertexStride,
+        uint32_t vertexCapacity, uint32_t indexCapacity, const std::vector<uint32_t>& queueFamilies = {});
+
+    //throws if either buffer has no free range large enough
+    GeometryAllocation allocate(uint32_t vertexCount, uint32_t indexCount);
+
+    void free(const GeometryRange& range);
+
+    //copies are recorded into the current upload batch, vertices are vertexStride bytes each
+    void upload(rendr::UploadContext& uploadContext, const GeometryRange& range, const void* vertices, const uint32_t* indices);
+
+    const vk::raii::Buffer& getVertexBuffer() const{
+        return vertexBuffer_.buffer;
+    }
+
+    const vk::raii::Buffer& getIndexBuffer() const{
+        return indexBuffer_.buffer;
+    }
+
+    uint32_t getVertexStride() const{
+        return vertexStride_;
+    }
+
+    void clear();
+};
+
+}
@@ -0,0 +1,264 @@
+#include "jobSystem.hpp"
+
+#include <algorithm>
+
+namespace rendr{
+
+namespace{
+//set on worker threads, tells run which deque is the calling thread's own
+thread_local const JobSystem* currentSystem = nullptr;
+thread_local size_t currentWorker = 0;
+}
+
+JobSystem::JobSystem(unsigned workerCount)
+: mainThread_(std::this_thread::get_id()){
+    if (workerCount == 0) {
+        workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+    for (unsigned i = 0; i < workerCount + 1; i++) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    workers_.reserve(workerCount);
+    for (unsigned i = 0; i < workerCount; i++) {
+        workers_.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem(){
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        stopping_ = true;
+    }
+    jobAvailable_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+size_t JobSystem::getQueueIndex() const{
+    return currentSystem == this ? currentWorker : workers_.size();
+}
+
+void JobSystem::workerLoop(size_t workerIndex){
+    currentSystem = this;
+    currentWorker = workerIndex;
+    while (true) {
+        if (tryRunJob(workerIndex)) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        jobAvailable_.wait(lock, [this]{ return stopping_ || queuedJobs_.load() > 0; });
+        //queued jobs are finished before the workers exit
+        if (stopping_ && queuedJobs_.load() == 0) {
+            return;
+        }
+    }
+}
+
+void JobSystem::schedule(Job job){
+    Queue& queue = *queues_[getQueueIndex()];
+    //counted before it is visible, a thief's decrement can't go below zero
+    queuedJobs_.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(std::move(job));
+    }
+    {
+        //a worker between its check and its wait would miss the notify otherwise
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+    }
+    jobAvailable_.notify_one();
+}
+
+bool JobSystem::tryPop(size_t queueIndex, Job& job){
+    //the own deque LIFO while its jobs are still in cache, others FIFO from the opposite end
+    bool own = queueIndex == getQueueIndex();
+    for (size_t i = 0; i < queues_.size(); i++) {
+        Queue& queue = *queues_[(queueIndex + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty()) {
+            continue;
+        }
+        if (own && i == 0) {
+            job = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+        } else {
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+        }
+        queuedJobs_.fetch_sub(1);
+        return true;
+    }
+    return false;
+}
+
+bool JobSystem::tryRunJob(size_t queueIndex){
+    Job job;
+    if (!tryPop(queueIndex, job)) {
+        return false;
+    }
+    execute(job);
+    return true;
+}
+
+bool JobSystem::hasMainThreadJobs(){
+    std::lock_guard<std::mutex> lock(mainThreadMutex_);
+    return !mainThreadJobs_.empty();
+}
+
+bool JobSystem::tryRunMainThreadJob(){
+    Job job;
+    {
+        std::lock_guard<std::mutex> lock(mainThreadMutex_);
+        if (mainThreadJobs_.empty()) {
+            return false;
+        }
+        job = std::move(mainThreadJobs_.front());
+        mainThreadJobs_.pop_front();
+    }
+    execute(job);
+    return true;
+}
+
+void JobSystem::execute(Job& job){
+    if (!job.counter) {
+        job.function();
+        return;
+    }
+    std::exception_ptr error;
+    try {
+        job.function();
+    } catch (...) {
+        error = std::current_exception();
+    }
+    finish(*job.counter, error);
+}
+
+void JobSystem::finish(JobCounter& counter, std::exception_ptr error){
+    std::vector<Job> continuations;
+    bool done = false;
+    {
+        //a waiter seeing zero takes the lock before returning, so the counter stays alive until this scope ends
+        std::lock_guard<std::mutex> lock(counter.mutex_);
+        if (error && !counter.error_) {
+            counter.error_ = error;
+        }
+        if (counter.pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            continuations.swap(counter.continuations_);
+            done = true;
+        }
+    }
+    if (done) {
+        //the counter may be gone already. Waiters sleep on the same condition as idle workers, all of them are woken to find theirs
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex_);
+        }
+        jobAvailable_.notify_all();
+    }
+    for (Job& continuation : continuations) {
+        schedule(std::move(continuation));
+    }
+}
+
+void JobSystem::run(std::function<void()> job, JobCounter* counter, JobCounter* dependency){
+    if (counter) {
+        counter->pending_.fetch_add(1, std::memory_order_relaxed);
+    }
+    Job entry{std::move(job), counter};
+    if (dependency) {
+        std::lock_guard<std::mutex> lock(dependency->mutex_);
+        if (dependency->pending_.load(std::memory_order_acquire) != 0) {
+            dependency->continuations_.push_back(std::move(entry));
+            return;
+        }
+    }
+    schedule(std::move(entry));
+}
+
+void JobSystem::runOnMainThread(std::function<void()> job, JobCounter* counter){
+    if (counter) {
+        counter->pending_.fetch_add(1, std::memory_order_relaxed);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mainThreadMutex_);
+        mainThreadJobs_.push_back(Job{std::move(job), counter});
+    }
+    //the main thread may be asleep in a wait
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+    }
+    jobAvailable_.notify_all();
+}
+
+size_t JobSystem::runMainThreadJobs(){
+    size_t count = 0;
+    while (tryRunMainThreadJob()) {
+        count++;
+    }
+    return count;
+}
+
+void JobSystem::wait(JobCounter& counter){
+    bool mainThread = isMainThread();
+    size_t queueIndex = getQueueIndex();
+    while (!counter.isDone()) {
+        if (mainThread && tryRunMainThreadJob()) {
+            continue;
+        }
+        if (tryRunJob(queueIndex)) {
+            continue;
+        }
+        //the remaining jobs are running on other threads, sleep until one finishes the counter or new work shows up
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        jobAvailable_.wait(lock, [this, &counter, mainThread]{
+            return counter.isDone() || queuedJobs_.load() > 0 || (mainThread && hasMainThreadJobs());
+        });
+    }
+
+    std::lock_guard<std::mutex> lock(counter.mutex_);
+    //the counter can be reused, the error belongs to this wait only
+    std::exception_ptr error = std::move(counter.error_);
+    counter.error_ = nullptr;
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void JobSystem::parallelFor(size_t count, const std::function<void(size_t)>& body){
+    if (count == 0) {
+        return;
+    }
+
+    //lives on this stack, wait returns only after every job finished with it
+    std::atomic<size_t> nextIndex{0};
+    auto takeIndices = [&nextIndex, count, &body]{
+        size_t index;
+        while ((index = nextIndex.fetch_add(1)) < count) {
+            try {
+                body(index);
+            } catch (...) {
+                //the remaining indices are skipped
+                nextIndex = count;
+                throw;
+            }
+        }
+    };
+
+    JobCounter counter;
+    size_t helperCount = std::min(workers_.size(), count - 1);
+    for (size_t i = 0; i < helperCount; i++) {
+        run(takeIndices, &counter);
+    }
+    std::exception_ptr error;
+    try {
+        takeIndices();
+    } catch (...) {
+        error = std::current_exception();
+    }
+    wait(counter);
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+}
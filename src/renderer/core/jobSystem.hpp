@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rendr{
+
+class JobSystem;
+
+//Number of unfinished jobs of a group. Jobs given the counter increment it when they are run
+//and decrement it when they are done, JobSystem::wait returns once it is back to zero.
+//Has to outlive the jobs counting on it and the jobs depending on it
+class JobCounter{
+private:
+    friend class JobSystem;
+
+    struct Job{
+        std::function<void()> function;
+        JobCounter* counter = nullptr;
+    };
+
+    std::atomic<uint32_t> pending_{0};
+    //guards the continuations and the error, the last decrement happens under it
+    std::mutex mutex_;
+    //jobs run with this counter as dependency, scheduled when it reaches zero
+    std::vector<Job> continuations_;
+    std::exception_ptr error_;
+
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool isDone() const{
+        return pending_.load(std::memory_order_acquire) == 0;
+    }
+};
+
+//Work stealing scheduler. Every worker owns a deque, it pushes and pops its own jobs at the back
+//and idle workers steal from the front of the others. Threads that are not workers push into a
+//shared queue. Waiting runs other jobs and only sleeps when there are none, so jobs can wait on jobs they spawned.
+//Jobs that have to run on the thread that created the system, GLFW calls for example,
+//go to a separate queue drained by runMainThreadJobs and by waits on that thread
+class JobSystem{
+private:
+    using Job = JobCounter::Job;
+
+    struct alignas(64) Queue{
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    std::vector<std::thread> workers_;
+    //one per worker, then the queue of non worker threads
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::atomic<size_t> queuedJobs_{0};
+    std::mutex sleepMutex_;
+    std::condition_variable jobAvailable_;
+    bool stopping_ = false;
+
+    std::thread::id mainThread_;
+    std::mutex mainThreadMutex_;
+    std::deque<Job> mainThreadJobs_;
+
+    void workerLoop(size_t workerIndex);
+    //queue of the calling thread, the shared queue for non workers
+    size_t getQueueIndex() const;
+    void schedule(Job job);
+    bool tryPop(size_t queueIndex, Job& job);
+    bool tryRunJob(size_t queueIndex);
+    bool hasMainThreadJobs();
+    bool tryRunMainThreadJob();
+    void execute(Job& job);
+    void finish(JobCounter& counter, std::exception_ptr error);
+public:
+    //0 workers means one less than the hardware threads, the thread calling wait works too.
+    //The constructing thread becomes the main thread
+    explicit JobSystem(unsigned workerCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    //runs job on any thread. With a dependency the job is held back until that counter reaches zero.
+    //An exception thrown by a job is rethrown by wait on its counter, jobs without counter must not throw
+    void run(std::function<void()> job, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+
+    //runs job on the main thread, from runMainThreadJobs or from a wait on the main thread
+    void runOnMainThread(std::function<void()> job, JobCounter* counter = nullptr);
+
+    //called by the main loop, returns the number of jobs run
+    size_t runMainThreadJobs();
+
+    //runs queued jobs until the counter is zero, then rethrows the first exception of its jobs
+    void wait(JobCounter& counter);
+
+    //runs body(i) for every i in [0, count) and returns when all of them are done.
+    //At most getThreadCount() + 1 jobs take indices, the first exception thrown by body is rethrown here
+    void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+    size_t getThreadCount() const{
+        return workers_.size();
+    }
+
+    bool isMainThread() const{
+        return std::this_thread::get_id() == mainThread_;
+    }
+};
+
+}
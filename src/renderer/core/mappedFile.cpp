@@ -0,0 +1,146 @@
+#include "mappedFile.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace rendr{
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& filePath){
+    HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("failed to open " + filePath);
+    }
+    fileHandle_ = file;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        clear();
+        throw std::runtime_error("failed to get size of " + filePath);
+    }
+    size_ = static_cast<size_t>(fileSize.QuadPart);
+    if (size_ == 0) {
+        return;
+    }
+
+    mappingHandle_ = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle_ == nullptr) {
+        clear();
+        throw std::runtime_error("failed to map " + filePath);
+    }
+    data_ = static_cast<const uint8_t*>(MapViewOfFile(mappingHandle_, FILE_MAP_READ, 0, 0, 0));
+    if (data_ == nullptr) {
+        clear();
+        throw std::runtime_error("failed to map " + filePath);
+    }
+}
+
+void MappedFile::clear(){
+    if (data_ != nullptr) {
+        UnmapViewOfFile(data_);
+    }
+    if (mappingHandle_ != nullptr) {
+        CloseHandle(mappingHandle_);
+    }
+    if (fileHandle_ != nullptr) {
+        CloseHandle(fileHandle_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    mappingHandle_ = nullptr;
+    fileHandle_ = nullptr;
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+: data_(other.data_), size_(other.size_), fileHandle_(other.fileHandle_), mappingHandle_(other.mappingHandle_){
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.fileHandle_ = nullptr;
+    other.mappingHandle_ = nullptr;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept{
+    if (this != &other) {
+        clear();
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        std::swap(fileHandle_, other.fileHandle_);
+        std::swap(mappingHandle_, other.mappingHandle_);
+    }
+    return *this;
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& filePath){
+    fd_ = ::open(filePath.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        throw std::runtime_error("failed to open " + filePath);
+    }
+
+    struct stat fileStat;
+    if (fstat(fd_, &fileStat) != 0) {
+        clear();
+        throw std::runtime_error("failed to get size of " + filePath);
+    }
+    size_ = static_cast<size_t>(fileStat.st_size);
+    if (size_ == 0) {
+        return;
+    }
+
+    void* mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (mapping == MAP_FAILED) {
+        clear();
+        throw std::runtime_error("failed to map " + filePath);
+    }
+    data_ = static_cast<const uint8_t*>(mapping);
+}
+
+void MappedFile::clear(){
+    if (data_ != nullptr) {
+        munmap(const_cast<uint8_t*>(data_), size_);
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    fd_ = -1;
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+: data_(other.data_), size_(other.size_), fd_(other.fd_){
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.fd_ = -1;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept{
+    if (this != &other) {
+        clear();
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        std::swap(fd_, other.fd_);
+    }
+    return *this;
+}
+
+#endif
+
+MappedFile::~MappedFile(){
+    clear();
+}
+
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace rendr{
+
+//Read only memory mapping of a whole file
+class MappedFile{
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    void* fileHandle_ = nullptr;
+    void* mappingHandle_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+
+public:
+    MappedFile() = default;
+    //throws if the file can't be opened or mapped
+    explicit MappedFile(const std::string& filePath);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    void clear();
+
+    const uint8_t* data() const{ return data_; }
+    size_t size() const{ return size_; }
+};
+
+}
@@ -0,0 +1,171 @@
+#include "meshCache.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace rendr{
+
+static const char meshCacheMagic[4] = {'R', 'M', 'S', 'H'};
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment){
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed){
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+uint64_t hashMeshImportOptions(const MeshImportOptions& options){
+    uint8_t packed[] = {
+        static_cast<uint8_t>(options.mergeByMaterial)
+    };
+    return hashBytes(packed, sizeof(packed));
+}
+
+void saveMeshCache(const std::string& filePath, uint64_t sourceHash, uint64_t optionsHash,
+    const std::vector<rendr::Mesh<VertexPTN>>& meshes){
+
+    MeshCacheHeader header{};
+    memcpy(header.magic, meshCacheMagic, sizeof(header.magic));
+    header.version = meshCacheVersion;
+    header.sourceHash = sourceHash;
+    header.optionsHash = optionsHash;
+    header.vertexStride = sizeof(VertexPTN);
+    header.meshCount = static_cast<uint32_t>(meshes.size());
+
+    std::vector<MeshCacheEntry> entries;
+    entries.reserve(meshes.size());
+    uint64_t offset = alignUp(sizeof(header) + sizeof(MeshCacheEntry) * meshes.size(), meshCacheBlobAlignment);
+    for (const rendr::Mesh<VertexPTN>& mesh : meshes) {
+        MeshCacheEntry entry{};
+        entry.materialId = mesh.materialId.value;
+        entry.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+        entry.indexCount = static_cast<uint32_t>(mesh.indices.size());
+        memcpy(entry.boundingSphere, &mesh.boundingSphere, sizeof(entry.boundingSphere));
+        entry.vertexOffset = offset;
+        offset = alignUp(offset + sizeof(VertexPTN) * mesh.vertices.size(), meshCacheBlobAlignment);
+        entry.indexOffset = offset;
+        offset = alignUp(offset + sizeof(uint32_t) * mesh.indices.size(), meshCacheBlobAlignment);
+        entries.push_back(entry);
+    }
+
+    //written next to the target and renamed, a crash never leaves a half written cache behind
+    std::string tempPath = filePath + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to create " + tempPath);
+        }
+        const char padding[meshCacheBlobAlignment] = {};
+        auto writePadded = [&](const void* data, uint64_t size, uint64_t nextOffset){
+            file.write(static_cast<const char*>(data), size);
+            uint64_t position = static_cast<uint64_t>(file.tellp());
+            file.write(padding, nextOffset - position);
+        };
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(entries.data()), sizeof(MeshCacheEntry) * entries.size());
+        file.write(padding, (entries.empty() ? offset : entries[0].vertexOffset) - static_cast<uint64_t>(file.tellp()));
+        for (size_t i = 0; i < entries.size(); i++) {
+            const rendr::Mesh<VertexPTN>& mesh = meshes[i];
+            writePadded(mesh.vertices.data(), sizeof(VertexPTN) * mesh.vertices.size(), entries[i].indexOffset);
+            uint64_t nextOffset = i + 1 < entries.size() ? entries[i + 1].vertexOffset : offset;
+            writePadded(mesh.indices.data(), sizeof(uint32_t) * mesh.indices.size(), nextOffset);
+        }
+        if (!file) {
+            throw std::runtime_error("failed to write " + tempPath);
+        }
+    }
+    std::filesystem::rename(tempPath, filePath);
+}
+
+bool MeshCache::tryMap(const std::string& cachePath, uint64_t sourceHash, uint64_t optionsHash){
+    meshes_.clear();
+    file_.clear();
+    if (!std::filesystem::exists(cachePath)) {
+        return false;
+    }
+
+    file_ = rendr::MappedFile(cachePath);
+    const uint8_t* data = file_.data();
+    size_t size = file_.size();
+
+    MeshCacheHeader header;
+    if (size < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, meshCacheMagic, sizeof(header.magic)) != 0 || header.version != meshCacheVersion ||
+        header.sourceHash != sourceHash || header.optionsHash != optionsHash || header.vertexStride != sizeof(VertexPTN) ||
+        size < sizeof(header) + sizeof(MeshCacheEntry) * uint64_t(header.meshCount)) {
+        return false;
+    }
+
+    const MeshCacheEntry* entries = reinterpret_cast<const MeshCacheEntry*>(data + sizeof(header));
+    meshes_.reserve(header.meshCount);
+    for (uint32_t i = 0; i < header.meshCount; i++) {
+        const MeshCacheEntry& entry = entries[i];
+        if (entry.vertexOffset + sizeof(VertexPTN) * uint64_t(entry.vertexCount) > size ||
+            entry.indexOffset + sizeof(uint32_t) * uint64_t(entry.indexCount) > size ||
+            entry.vertexOffset % meshCacheBlobAlignment != 0 || entry.indexOffset % meshCacheBlobAlignment != 0) {
+            meshes_.clear();
+            return false;
+        }
+        glm::vec4 boundingSphere;
+        memcpy(&boundingSphere, entry.boundingSphere, sizeof(boundingSphere));
+        meshes_.push_back(MeshView{
+            MaterialId{entry.materialId},
+            reinterpret_cast<const VertexPTN*>(data + entry.vertexOffset), entry.vertexCount,
+            reinterpret_cast<const uint32_t*>(data + entry.indexOffset), entry.indexCount,
+            boundingSphere
+        });
+    }
+    return true;
+}
+
+void MeshCache::loadFbx(const std::string& sourcePath, const std::string& cachePath, const MeshImportOptions& options, rendr::JobSystem* jobs){
+    uint64_t sourceHash;
+    {
+        rendr::MappedFile source(sourcePath);
+        sourceHash = hashBytes(source.data(), source.size());
+    }
+    uint64_t optionsHash = hashMeshImportOptions(options);
+
+    if (tryMap(cachePath, sourceHash, optionsHash)) {
+        return;
+    }
+    file_.clear();
+
+    rendr::UfbxSceneRaii fbxScene(sourcePath);
+    std::vector<rendr::Mesh<VertexPTN>> meshes = rendr::ufbxLoadMeshesPartsSepByMaterial(fbxScene.get(), jobs);
+    if (options.mergeByMaterial) {
+        std::map<rendr::MaterialId, rendr::Mesh<VertexPTN>> materialToMesh = rendr::mergeMeshesByMaterial(meshes, jobs);
+        meshes.clear();
+        for (auto& entry : materialToMesh) {
+            meshes.push_back(std::move(entry.second));
+        }
+    }
+    saveMeshCache(cachePath, sourceHash, optionsHash, meshes);
+
+    if (!tryMap(cachePath, sourceHash, optionsHash)) {
+        throw std::runtime_error("failed to read back mesh cache " + cachePath);
+    }
+}
+
+const MeshView* MeshCache::findByMaterial(MaterialId materialId) const{
+    for (const MeshView& mesh : meshes_) {
+        if (mesh.materialId == materialId) {
+            return &mesh;
+        }
+    }
+    return nullptr;
+}
+
+}
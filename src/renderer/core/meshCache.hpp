@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mappedFile.hpp"
+#include "utility.hpp"
+
+namespace rendr{
+
+struct MeshImportOptions{
+    //one mesh per scene material instead of one per mesh part
+    bool mergeByMaterial = true;
+};
+
+//Mesh stored in a mapped cache file, pointers stay valid while the MeshCache is alive
+struct MeshView{
+    MaterialId materialId;
+    const VertexPTN* vertices;
+    size_t vertexCount;
+    const uint32_t* indices;
+    size_t indexCount;
+    //xyz center, w radius, computed at import
+    glm::vec4 boundingSphere;
+};
+
+struct MeshCacheHeader{
+    char magic[4];
+    uint32_t version;
+    //FNV-1a of the source file bytes
+    uint64_t sourceHash;
+    uint64_t optionsHash;
+    uint32_t vertexStride;
+    uint32_t meshCount;
+};
+
+struct MeshCacheEntry{
+    //MaterialId::value
+    uint32_t materialId;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t reserved;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    float boundingSphere[4];
+};
+
+const uint32_t meshCacheVersion = 3;
+//vertex and index blobs start at this alignment so they can be staged straight from the mapping
+const uint64_t meshCacheBlobAlignment = 16;
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ull);
+uint64_t hashMeshImportOptions(const MeshImportOptions& options);
+
+void saveMeshCache(const std::string& filePath, uint64_t sourceHash, uint64_t optionsHash,
+    const std::vector<rendr::Mesh<VertexPTN>>& meshes);
+
+//Binary cache of an imported fbx scene, meshes are read from the mapping without parsing or copying
+class MeshCache{
+private:
+    rendr::MappedFile file_;
+    std::vector<MeshView> meshes_;
+
+    //false if the file is not a cache of this source and options
+    bool tryMap(const std::string& cachePath, uint64_t sourceHash, uint64_t optionsHash);
+public:
+    //maps cachePath when it was built from the same source bytes and options,
+    //otherwise imports sourcePath with ufbx and rewrites the cache first, on jobs when it is given
+    void loadFbx(const std::string& sourcePath, const std::string& cachePath, const MeshImportOptions& options = {}, rendr::JobSystem* jobs = nullptr);
+
+    const std::vector<MeshView>& getMeshes() const{
+        return meshes_;
+    }
+
+    //first mesh with the scene material, nullptr if there is none
+    const MeshView* findByMaterial(MaterialId materialId) const;
+};
+
+}
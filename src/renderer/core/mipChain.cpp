@@ -0,0 +1,159 @@
+#include "mipChain.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RENDR_MIP_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace rendr{
+
+namespace{
+
+//one RGBA pixel fits a single SSE register, the filter works on whole pixels
+#ifdef RENDR_MIP_SSE2
+struct Pixel{
+    __m128 v;
+};
+
+inline Pixel loadPixel(const float* p){ return Pixel{_mm_loadu_ps(p)}; }
+inline void storePixel(float* p, Pixel px){ _mm_storeu_ps(p, px.v); }
+inline Pixel average(Pixel a, Pixel b, Pixel c, Pixel d){
+    return Pixel{_mm_mul_ps(_mm_add_ps(_mm_add_ps(a.v, b.v), _mm_add_ps(c.v, d.v)), _mm_set1_ps(0.25f))};
+}
+#else
+struct Pixel{
+    float v[4];
+};
+
+inline Pixel loadPixel(const float* p){ Pixel px; memcpy(px.v, p, sizeof(px.v)); return px; }
+inline void storePixel(float* p, Pixel px){ memcpy(p, px.v, sizeof(px.v)); }
+inline Pixel average(Pixel a, Pixel b, Pixel c, Pixel d){
+    Pixel px;
+    for (int i = 0; i < 4; i++) {
+        px.v[i] = (a.v[i] + b.v[i] + c.v[i] + d.v[i]) * 0.25f;
+    }
+    return px;
+}
+#endif
+
+const int encodeLutSize = 4096;
+
+struct ColorLuts{
+    float decode[256];
+    uint8_t encode[encodeLutSize + 1];
+};
+
+ColorLuts makeLuts(bool srgb){
+    ColorLuts luts;
+    for (int i = 0; i < 256; i++) {
+        float c = i / 255.0f;
+        if (srgb) {
+            c = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        luts.decode[i] = c;
+    }
+    for (int i = 0; i <= encodeLutSize; i++) {
+        float c = static_cast<float>(i) / encodeLutSize;
+        if (srgb) {
+            c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+        }
+        luts.encode[i] = static_cast<uint8_t>(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+    }
+    return luts;
+}
+
+//odd sizes clamp the second tap to the last row/column
+void downsample(const float* src, uint32_t srcWidth, uint32_t srcHeight, float* dst, uint32_t dstWidth, uint32_t dstHeight){
+    for (uint32_t y = 0; y < dstHeight; y++) {
+        const float* row0 = src + size_t(std::min(y * 2, srcHeight - 1)) * srcWidth * 4;
+        const float* row1 = src + size_t(std::min(y * 2 + 1, srcHeight - 1)) * srcWidth * 4;
+        float* out = dst + size_t(y) * dstWidth * 4;
+        for (uint32_t x = 0; x < dstWidth; x++) {
+            size_t x0 = size_t(std::min(x * 2, srcWidth - 1)) * 4;
+            size_t x1 = size_t(std::min(x * 2 + 1, srcWidth - 1)) * 4;
+            storePixel(out + size_t(x) * 4, average(loadPixel(row0 + x0), loadPixel(row0 + x1), loadPixel(row1 + x0), loadPixel(row1 + x1)));
+        }
+    }
+}
+
+void decodeRow(const uint8_t* src, float* dst, uint32_t width, const ColorLuts& luts){
+    for (uint32_t x = 0; x < width; x++) {
+        dst[x * 4 + 0] = luts.decode[src[x * 4 + 0]];
+        dst[x * 4 + 1] = luts.decode[src[x * 4 + 1]];
+        dst[x * 4 + 2] = luts.decode[src[x * 4 + 2]];
+        dst[x * 4 + 3] = src[x * 4 + 3] / 255.0f;
+    }
+}
+
+void encode(const float* src, uint8_t* dst, size_t pixelCount, const ColorLuts& luts){
+    for (size_t i = 0; i < pixelCount * 4; i += 4) {
+        for (size_t c = 0; c < 3; c++) {
+            float v = std::clamp(src[i + c], 0.0f, 1.0f);
+            dst[i + c] = luts.encode[static_cast<int>(v * encodeLutSize + 0.5f)];
+        }
+        dst[i + 3] = static_cast<uint8_t>(std::clamp(src[i + 3], 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+}
+
+}
+
+uint32_t calcMipLevels(uint32_t width, uint32_t height){
+    uint32_t levels = 1;
+    uint32_t size = std::max(width, height);
+    while (size > 1) {
+        size >>= 1;
+        levels++;
+    }
+    return levels;
+}
+
+std::vector<uint8_t> buildMipChainRGBA8(const uint8_t* pixels, uint32_t width, uint32_t height, bool srgb, std::vector<MipLevel>& levels){
+    uint32_t levelCount = calcMipLevels(width, height);
+    levels.clear();
+    levels.reserve(levelCount);
+
+    size_t totalSize = 0;
+    uint32_t w = width;
+    uint32_t h = height;
+    for (uint32_t i = 0; i < levelCount; i++) {
+        levels.push_back(MipLevel{w, h, totalSize});
+        totalSize += size_t(w) * h * 4;
+        w = std::max(w / 2, 1u);
+        h = std::max(h / 2, 1u);
+    }
+
+    std::vector<uint8_t> chain(totalSize);
+    memcpy(chain.data(), pixels, size_t(width) * height * 4);
+    if (levelCount == 1) {
+        return chain;
+    }
+
+    ColorLuts luts = makeLuts(srgb);
+
+    //level 1 is filtered from two decoded rows of level 0 at a time, so the full size image is never held as floats
+    std::vector<float> current(size_t(levels[1].width) * levels[1].height * 4);
+    std::vector<float> srcRows(size_t(width) * 2 * 4);
+    for (uint32_t y = 0; y < levels[1].height; y++) {
+        uint32_t y0 = std::min(y * 2, height - 1);
+        uint32_t y1 = std::min(y * 2 + 1, height - 1);
+        decodeRow(pixels + size_t(y0) * width * 4, srcRows.data(), width, luts);
+        decodeRow(pixels + size_t(y1) * width * 4, srcRows.data() + size_t(width) * 4, width, luts);
+        downsample(srcRows.data(), width, 2, current.data() + size_t(y) * levels[1].width * 4, levels[1].width, 1);
+    }
+    encode(current.data(), chain.data() + levels[1].offset, size_t(levels[1].width) * levels[1].height, luts);
+
+    std::vector<float> next;
+    for (uint32_t i = 2; i < levelCount; i++) {
+        next.resize(size_t(levels[i].width) * levels[i].height * 4);
+        downsample(current.data(), levels[i - 1].width, levels[i - 1].height, next.data(), levels[i].width, levels[i].height);
+        encode(next.data(), chain.data() + levels[i].offset, size_t(levels[i].width) * levels[i].height, luts);
+        std::swap(current, next);
+    }
+    return chain;
+}
+
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace rendr{
+
+struct MipLevel{
+    uint32_t width;
+    uint32_t height;
+    //byte offset of the level inside the chain buffer
+    size_t offset;
+};
+
+uint32_t calcMipLevels(uint32_t width, uint32_t height);
+
+//Builds the full mip chain of an RGBA8 image on the CPU with a 2x2 box filter, level 0 included.
+//Levels are tightly packed one after another, srgb color channels are averaged in linear space
+std::vector<uint8_t> buildMipChainRGBA8(const uint8_t* pixels, uint32_t width, uint32_t height, bool srgb, std::vector<MipLevel>& levels);
+
+}
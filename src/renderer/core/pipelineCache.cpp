@@ -0,0 +1,129 @@
+#include "pipelineCache.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+namespace rendr{
+
+//VkPipelineCacheHeaderVersionOne, spelled out because older headers don't declare it
+struct PipelineCacheHeader{
+    uint32_t headerSize;
+    uint32_t headerVersion;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+};
+
+static bool isCacheCompatible(const std::vector<char>& data, const vk::PhysicalDeviceProperties& properties){
+    PipelineCacheHeader header;
+    if (data.size() < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, data.data(), sizeof(header));
+    return header.headerSize >= sizeof(header) && header.headerSize <= data.size()
+        && header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+        && header.vendorID == properties.vendorID
+        && header.deviceID == properties.deviceID
+        && memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID.data(), VK_UUID_SIZE) == 0;
+}
+
+static std::vector<char> readCacheFile(const std::string& filePath){
+    std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return {};
+    }
+    std::vector<char> data(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(data.data(), data.size());
+    if (!file) {
+        return {};
+    }
+    return data;
+}
+
+PipelineCache::PipelineCache()
+: cache_(nullptr){}
+
+PipelineCache::~PipelineCache(){
+    try {
+        save();
+    } catch (const std::exception& e) {
+        std::cerr << "pipeline cache: " << e.what() << std::endl;
+    }
+}
+
+void PipelineCache::create(const vk::raii::PhysicalDevice& physicalDevice, const vk::raii::Device& device, const std::string& filePath){
+    clear();
+    filePath_ = filePath;
+
+    std::vector<char> data;
+    if (!filePath_.empty()) {
+        data = readCacheFile(filePath_);
+        //blobs of another GPU or driver would be ignored by the driver at best
+        if (!isCacheCompatible(data, physicalDevice.getProperties())) {
+            data.clear();
+        }
+    }
+    warm_ = !data.empty();
+
+    vk::PipelineCacheCreateInfo createInfo(
+        {}, // flags
+        data.size(), // initialDataSize
+        data.empty() ? nullptr : data.data() // pInitialData
+    );
+    cache_ = vk::raii::PipelineCache(device, createInfo);
+}
+
+void PipelineCache::save() const{
+    if (filePath_.empty() || !*cache_) {
+        return;
+    }
+    std::vector<uint8_t> data = cache_.getData();
+
+    std::string tempPath = filePath_ + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to create " + tempPath);
+        }
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+        if (!file) {
+            throw std::runtime_error("failed to write " + tempPath);
+        }
+    }
+    std::filesystem::rename(tempPath, filePath_);
+}
+
+void PipelineCache::clear(){
+    cache_.clear();
+    filePath_.clear();
+    warm_ = false;
+    pipelineCount_ = 0;
+    creationMicroseconds_ = 0;
+}
+
+void PipelineCache::addCreationTime(uint64_t microseconds) const{
+    pipelineCount_.fetch_add(1);
+    creationMicroseconds_.fetch_add(microseconds);
+}
+
+vk::raii::Pipeline PipelineCache::createGraphicsPipeline(const vk::raii::Device& device, const vk::GraphicsPipelineCreateInfo& createInfo) const{
+    auto start = std::chrono::steady_clock::now();
+    vk::raii::Pipeline pipeline(device, cache_, createInfo);
+    addCreationTime(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+    return pipeline;
+}
+
+vk::raii::Pipeline PipelineCache::createComputePipeline(const vk::raii::Device& device, const vk::ComputePipelineCreateInfo& createInfo) const{
+    auto start = std::chrono::steady_clock::now();
+    vk::raii::Pipeline pipeline(device, cache_, createInfo);
+    addCreationTime(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+    return pipeline;
+}
+
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vulkan/vulkan_raii.hpp>
+
+namespace rendr{
+
+//VkPipelineCache kept on disk between runs. The driver's blob is only used when its header matches
+//the vendor, device and pipelineCacheUUID (which changes with the driver), anything else starts empty.
+//Pipeline creation through it is timed, so cold and warm starts can be compared
+class PipelineCache{
+private:
+    vk::raii::PipelineCache cache_;
+    std::string filePath_;
+    //started from a valid file
+    bool warm_ = false;
+    mutable std::atomic<uint32_t> pipelineCount_{0};
+    mutable std::atomic<uint64_t> creationMicroseconds_{0};
+
+    void addCreationTime(uint64_t microseconds) const;
+public:
+    PipelineCache();
+    //saves the cache, errors are reported to std::cerr
+    ~PipelineCache();
+
+    PipelineCache(const PipelineCache&) = delete;
+    PipelineCache& operator=(const PipelineCache&) = delete;
+
+    //an empty filePath keeps the cache in memory only
+    void create(const vk::raii::PhysicalDevice& physicalDevice, const vk::raii::Device& device, const std::string& filePath);
+
+    //written to a temporary file and renamed over filePath, a crash never leaves a partial cache
+    void save() const;
+
+    void clear();
+
+    //safe to call from several threads, the driver synchronizes access to the cache
+    vk::raii::Pipeline createGraphicsPipeline(const vk::raii::Device& device, const vk::GraphicsPipelineCreateInfo& createInfo) const;
+    vk::raii::Pipeline createComputePipeline(const vk::raii::Device& device, const vk::ComputePipelineCreateInfo& createInfo) const;
+
+    const vk::raii::PipelineCache& get() const{
+        return cache_;
+    }
+
+    bool isWarm() const{
+        return warm_;
+    }
+
+    uint32_t getPipelineCount() const{
+        return pipelineCount_.load();
+    }
+
+    //summed over every pipeline created through the cache
+    float getCreationMilliseconds() const{
+        return creationMicroseconds_.load() / 1000.0f;
+    }
+};
+
+}
@@ -0,0 +1,80 @@
+#include "readbackPool.hpp"
+
+#include <stdexcept>
+
+namespace rendr{
+
+void ReadbackPool::create(const rendr::Allocator& allocator, const vk::raii::Device& device, uint32_t bufferCount,
+    vk::Extent2D extent, vk::Format format, uint32_t bytesPerPixel){
+
+    if (bufferCount == 0) {
+        throw std::invalid_argument("readback pool needs at least one buffer!");
+    }
+    extent_ = extent;
+    format_ = format;
+    frameSize_ = static_cast<vk::DeviceSize>(extent.width) * extent.height * bytesPerPixel;
+
+    vk::MemoryPropertyFlags coherent = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+    slots_.clear();
+    slots_.resize(bufferCount);
+    for (Slot& slot : slots_) {
+        //uncached memory is write-combined, reading a whole frame from it is an order of magnitude slower
+        try {
+            slot.buffer = rendr::createBuffer(allocator, device, frameSize_, vk::BufferUsageFlagBits::eTransferDst,
+                coherent | vk::MemoryPropertyFlagBits::eHostCached);
+        } catch (const std::runtime_error&) {
+            slot.buffer = rendr::createBuffer(allocator, device, frameSize_, vk::BufferUsageFlagBits::eTransferDst, coherent);
+        }
+    }
+}
+
+std::optional<uint32_t> ReadbackPool::acquire(uint64_t frameNumber){
+    for (uint32_t i = 0; i < slots_.size(); i++) {
+        if (!slots_[i].pending) {
+            slots_[i].pending = true;
+            slots_[i].frameNumber = frameNumber;
+            return i;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<uint64_t> ReadbackPool::getOldestPending() const{
+    std::optional<uint64_t> oldest;
+    for (const Slot& slot : slots_) {
+        if (slot.pending && (!oldest || slot.frameNumber < *oldest)) {
+            oldest = slot.frameNumber;
+        }
+    }
+    return oldest;
+}
+
+void ReadbackPool::collect(const std::function<bool(uint64_t)>& isFrameComplete, const std::function<void(const ReadbackFrame&)>& onFrame){
+    for (std::optional<uint64_t> frameNumber = getOldestPending(); frameNumber; frameNumber = getOldestPending()) {
+        if (!isFrameComplete(*frameNumber)) {
+            return;
+        }
+        for (Slot& slot : slots_) {
+            if (!slot.pending || slot.frameNumber != *frameNumber) {
+                continue;
+            }
+            if (onFrame) {
+                ReadbackFrame frame;
+                frame.frameNumber = slot.frameNumber;
+                frame.extent = extent_;
+                frame.format = format_;
+                frame.data = slot.buffer.allocation.getMappedData();
+                frame.size = frameSize_;
+                onFrame(frame);
+            }
+            slot.pending = false;
+            break;
+        }
+    }
+}
+
+void ReadbackPool::clear(){
+    slots_.clear();
+}
+
+}
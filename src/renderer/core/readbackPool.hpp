@@ -0,0 +1,70 @@
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <vector>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "allocator.hpp"
+
+namespace rendr{
+
+//Frame copied out of an offscreen target, data is valid only inside the delivery callback
+struct ReadbackFrame{
+    uint64_t frameNumber = 0;
+    vk::Extent2D extent;
+    vk::Format format = vk::Format::eUndefined;
+    //tightly packed rows of extent.width pixels
+    const void* data = nullptr;
+    vk::DeviceSize size = 0;
+};
+
+//Host visible buffers offscreen frames are copied into.
+//A buffer returns to the pool once its frame is delivered, frames are delivered in submission order
+class ReadbackPool{
+private:
+    struct Slot{
+        rendr::Buffer buffer;
+        bool pending = false;
+        uint64_t frameNumber = 0;
+    };
+
+    std::vector<Slot> slots_;
+    vk::Extent2D extent_;
+    vk::Format format_ = vk::Format::eUndefined;
+    vk::DeviceSize frameSize_ = 0;
+
+public:
+    ReadbackPool() = default;
+
+    ReadbackPool(const ReadbackPool&) = delete;
+    ReadbackPool& operator=(const ReadbackPool&) = delete;
+
+    void create(const rendr::Allocator& allocator, const vk::raii::Device& device, uint32_t bufferCount,
+        vk::Extent2D extent, vk::Format format, uint32_t bytesPerPixel);
+
+    //index of a free buffer now owned by the frame, nullopt if every buffer waits for delivery
+    std::optional<uint32_t> acquire(uint64_t frameNumber);
+
+    //oldest frame that is not delivered yet
+    std::optional<uint64_t> getOldestPending() const;
+
+    //delivers pending frames oldest first, stops at the first one isFrameComplete rejects
+    void collect(const std::function<bool(uint64_t)>& isFrameComplete, const std::function<void(const ReadbackFrame&)>& onFrame);
+
+    const vk::raii::Buffer& getBuffer(uint32_t slot) const{
+        return slots_[slot].buffer.buffer;
+    }
+
+    vk::Extent2D getExtent() const{
+        return extent_;
+    }
+
+    vk::DeviceSize getFrameSize() const{
+        return frameSize_;
+    }
+
+    void clear();
+};
+
+}
@@ -0,0 +1,70 @@
+#include "samplerCache.hpp"
+
+#include <functional>
+#include <stdexcept>
+
+namespace rendr{
+
+size_t SamplerCache::InfoHash::operator()(const vk::SamplerCreateInfo& info) const{
+    size_t seed = 0;
+    auto combine = [&seed](size_t value){
+        seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    };
+    combine(std::hash<uint32_t>()(static_cast<uint32_t>(info.flags)));
+    combine(std::hash<uint32_t>()(static_cast<uint32_t>(info.magFilter)));
+    combine(std::hash<uint32_t>()(static_cast<uint32_t>(info.minFilter)));
+    combine(std::hash<uint32_t>()(static_cast<uint32_t>(info.mipmapMode)));
+    combine(std::hash<uint32_t>()(static_cast<uint32_t>(info.addressModeU)));
+    combine(std::hash<uint32_t>()(static_cast<uint32_t>(info.addressModeV)));
+    combine(std::hash<uint32_t>()(static_cast<uint32_t>(info.addressModeW)));
+    combine(std::hash<float>()(info.mipLodBias));
+    combine(std::hash<uint32_t>()(info.anisotropyEnable));
+    combine(std::hash<float>()(info.maxAnisotropy));
+    combine(std::hash<uint32_t>()(info.compareEnable));
+    combine(std::hash<uint32_t>()(static_cast<uint32_t>(info.compareOp)));
+    combine(std::hash<float>()(info.minLod));
+    combine(std::hash<float>()(info.maxLod));
+    combine(std::hash<uint32_t>()(static_cast<uint32_t>(info.borderColor)));
+    combine(std::hash<uint32_t>()(info.unnormalizedCoordinates));
+    return seed;
+}
+
+void SamplerCache::create(const vk::raii::Device& device){
+    clear();
+    device_ = &device;
+}
+
+vk::Sampler SamplerCache::get(const vk::SamplerCreateInfo& info) const{
+    if (info.pNext) {
+        throw std::runtime_error("sampler cache can't key samplers with a pNext chain!");
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    requestCount_++;
+    auto found = samplers_.find(info);
+    if (found != samplers_.end()) {
+        return **found->second;
+    }
+    auto sampler = std::make_unique<vk::raii::Sampler>(*device_, info);
+    vk::Sampler handle = **sampler;
+    samplers_.emplace(info, std::move(sampler));
+    return handle;
+}
+
+size_t SamplerCache::getSamplerCount() const{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return samplers_.size();
+}
+
+uint64_t SamplerCache::getRequestCount() const{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return requestCount_;
+}
+
+void SamplerCache::clear(){
+    std::lock_guard<std::mutex> lock(mutex_);
+    samplers_.clear();
+    requestCount_ = 0;
+    device_ = nullptr;
+}
+
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vulkan/vulkan_raii.hpp>
+
+namespace rendr{
+
+//Samplers of a device deduplicated by their create info. Textures with the same filtering share one
+//vk::Sampler instead of each creating its own, drivers cap the number of live samplers (often at 4000).
+//Samplers live as long as the cache, so the returned handles need no retiring
+class SamplerCache{
+public:
+    //every member of the create info except pNext, which get() refuses
+    struct InfoHash{
+        size_t operator()(const vk::SamplerCreateInfo& info) const;
+    };
+
+private:
+    const vk::raii::Device* device_ = nullptr;
+    //unique_ptr keeps the raii samplers in place when the map rehashes
+    mutable std::unordered_map<vk::SamplerCreateInfo, std::unique_ptr<vk::raii::Sampler>, InfoHash> samplers_;
+    mutable uint64_t requestCount_ = 0;
+    //materials compiled on workers request samplers too
+    mutable std::mutex mutex_;
+
+public:
+    SamplerCache() = default;
+
+    SamplerCache(const SamplerCache&) = delete;
+    SamplerCache& operator=(const SamplerCache&) = delete;
+
+    void create(const vk::raii::Device& device);
+
+    //creates the sampler on the first request for info, throws if info has a pNext chain since that can't be compared
+    vk::Sampler get(const vk::SamplerCreateInfo& info) const;
+
+    //distinct samplers alive on the device
+    size_t getSamplerCount() const;
+
+    //calls to get, getRequestCount() - getSamplerCount() samplers were saved
+    uint64_t getRequestCount() const;
+
+    void clear();
+};
+
+}
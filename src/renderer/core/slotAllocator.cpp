@@ -0,0 +1,37 @@
+#include "slotAllocator.hpp"
+
+#include <stdexcept>
+
+namespace rendr{
+
+void SlotAllocator::reset(uint32_t capacity){
+    capacity_ = capacity;
+    nextSlot_ = 0;
+    epoch_++;
+    freeSlots_.clear();
+}
+
+uint32_t SlotAllocator::allocate(){
+    if (!freeSlots_.empty()) {
+        uint32_t index = freeSlots_.back();
+        freeSlots_.pop_back();
+        return index;
+    }
+    if (nextSlot_ < capacity_) {
+        return nextSlot_++;
+    }
+    throw std::runtime_error("no free slots left!");
+}
+
+void SlotAllocator::free(uint32_t index, uint32_t epoch){
+    //handles may outlive a reset, their stale indices are dropped even once nextSlot_ passes them again
+    if (epoch == epoch_) {
+        freeSlots_.push_back(index);
+    }
+}
+
+uint32_t SlotAllocator::size() const{
+    return nextSlot_ - static_cast<uint32_t>(freeSlots_.size());
+}
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace rendr{
+
+//Hands out indices below a capacity. Freed indices are reused, the most recently freed first,
+//before the never used ones past them. Every reset starts a new epoch, frees carry the epoch
+//their index was allocated in so indices from before a reset can't go back on the free list. Not thread safe, the owner locks
+class SlotAllocator{
+private:
+    uint32_t capacity_ = 0;
+    uint32_t nextSlot_ = 0;
+    uint32_t epoch_ = 0;
+    std::vector<uint32_t> freeSlots_;
+
+public:
+    //forgets every allocated index and starts a new epoch
+    void reset(uint32_t capacity);
+
+    //throws when every index is in use
+    uint32_t allocate();
+
+    //indices of an older epoch are ignored
+    void free(uint32_t index, uint32_t epoch);
+
+    //indices in use
+    uint32_t size() const;
+
+    uint32_t getCapacity() const{
+        return capacity_;
+    }
+
+    //epoch of the indices allocate hands out now
+    uint32_t getEpoch() const{
+        return epoch_;
+    }
+};
+
+}
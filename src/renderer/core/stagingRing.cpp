@@ -0,0 +1,88 @@
+#include "stagingRing.hpp"
+
+namespace rendr{
+
+static vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment){
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+void StagingRing::create(const rendr::Allocator& allocator, const vk::raii::Device& device, vk::DeviceSize capacity,
+    vk::BufferUsageFlags usage, const std::vector<uint32_t>& queueFamilies){
+
+    buffer_ = rendr::createBuffer(allocator, device, capacity, vk::BufferUsageFlagBits::eTransferSrc | usage,
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, queueFamilies);
+    mappedData_ = static_cast<uint8_t*>(buffer_.allocation.getMappedData());
+    capacity_ = capacity;
+    head_ = 0;
+    tail_ = 0;
+    regions_.clear();
+}
+
+std::optional<StagingSpan> StagingRing::allocate(vk::DeviceSize size, vk::DeviceSize alignment){
+    if (size == 0 || size > capacity_) {
+        return std::nullopt;
+    }
+    if (regions_.empty()) {
+        head_ = 0;
+        tail_ = 0;
+    }
+
+    //wrapped: live data is [tail_, capacity_) + [0, head_), free range is [head_, tail_)
+    bool wrapped = head_ < tail_ || (head_ == tail_ && !regions_.empty());
+    vk::DeviceSize offset = alignUp(head_, alignment);
+
+    if (!wrapped) {
+        if (offset + size > capacity_) {
+            //the end of the buffer is too short, continue from the beginning
+            offset = 0;
+            if (size > tail_) {
+                return std::nullopt;
+            }
+        }
+    } else if (offset + size > tail_) {
+        return std::nullopt;
+    }
+
+    head_ = offset + size;
+    regions_.push_back(Region{nextId_, offset, head_, false});
+
+    StagingSpan span;
+    span.buffer = &buffer_.buffer;
+    span.offset = offset;
+    span.size = size;
+    span.mappedData = mappedData_ + offset;
+    span.id = nextId_++;
+    return span;
+}
+
+void StagingRing::release(uint64_t spanId){
+    for (Region& region : regions_) {
+        if (region.id == spanId) {
+            region.released = true;
+            break;
+        }
+    }
+
+    while (!regions_.empty() && regions_.front().released) {
+        regions_.pop_front();
+    }
+
+    if (regions_.empty()) {
+        head_ = 0;
+        tail_ = 0;
+    } else {
+        tail_ = regions_.front().begin;
+    }
+}
+
+vk::DeviceSize StagingRing::getUsedBytes() const{
+    if (regions_.empty()) {
+        return 0;
+    }
+    if (head_ > tail_) {
+        return head_ - tail_;
+    }
+    return capacity_ - tail_ + head_;
+}
+
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <deque>
+#include <optional>
+#include <vector>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "allocator.hpp"
+
+namespace rendr{
+
+struct StagingSpan{
+    const vk::raii::Buffer* buffer = nullptr;
+    vk::DeviceSize offset = 0;
+    vk::DeviceSize size = 0;
+    void* mappedData = nullptr;
+    //pass to StagingRing::release once the GPU is done with the span, 0 for spans not owned by a ring
+    uint64_t id = 0;
+};
+
+//Persistently mapped host visible buffer handed out in sub-ranges.
+//Spans may be released in any order, memory is reused in FIFO order once every older span is released
+class StagingRing{
+private:
+    struct Region{
+        uint64_t id;
+        vk::DeviceSize begin;
+        vk::DeviceSize end;
+        bool released;
+    };
+
+    rendr::Buffer buffer_;
+    uint8_t* mappedData_ = nullptr;
+    vk::DeviceSize capacity_ = 0;
+    vk::DeviceSize head_ = 0;
+    vk::DeviceSize tail_ = 0;
+    std::deque<Region> regions_;
+    uint64_t nextId_ = 1;
+
+public:
+    StagingRing() = default;
+
+    StagingRing(const StagingRing&) = delete;
+    StagingRing& operator=(const StagingRing&) = delete;
+
+    //usage is added to eTransferSrc, queueFamilies are passed to createBuffer
+    void create(const rendr::Allocator& allocator, const vk::raii::Device& device, vk::DeviceSize capacity,
+        vk::BufferUsageFlags usage, const std::vector<uint32_t>& queueFamilies = {});
+
+    //nullopt if there is no contiguous free range of that size right now
+    std::optional<StagingSpan> allocate(vk::DeviceSize size, vk::DeviceSize alignment);
+
+    void release(uint64_t spanId);
+
+    const vk::raii::Buffer& getBuffer() const{
+        return buffer_.buffer;
+    }
+
+    vk::DeviceSize getCapacity() const{
+        return capacity_;
+    }
+
+    vk::DeviceSize getUsedBytes() const;
+};
+
+}
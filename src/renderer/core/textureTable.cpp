@@ -0,0 +1,134 @@
+#include "textureTable.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace rendr{
+
+TextureSlot::TextureSlot(TextureSlot&& other) noexcept
+    : table_(other.table_), index_(other.index_), epoch_(other.epoch_){
+    other.table_ = nullptr;
+}
+
+TextureSlot& TextureSlot::operator=(TextureSlot&& other) noexcept{
+    if (this != &other) {
+        clear();
+        table_ = other.table_;
+        index_ = other.index_;
+        epoch_ = other.epoch_;
+        other.table_ = nullptr;
+    }
+    return *this;
+}
+
+TextureSlot::~TextureSlot(){
+    clear();
+}
+
+void TextureSlot::clear(){
+    if (table_) {
+        table_->free(index_, epoch_);
+        table_ = nullptr;
+    }
+    index_ = 0;
+    epoch_ = 0;
+}
+
+TextureTable::TextureTable()
+: layout_(nullptr), pool_(nullptr), set_(nullptr){}
+
+bool TextureTable::isSupported(const vk::PhysicalDeviceVulkan12Features& enabledFeatures){
+    return enabledFeatures.runtimeDescriptorArray
+        && enabledFeatures.shaderSampledImageArrayNonUniformIndexing
+        && enabledFeatures.descriptorBindingSampledImageUpdateAfterBind
+        && enabledFeatures.descriptorBindingPartiallyBound
+        && enabledFeatures.descriptorBindingUpdateUnusedWhilePending;
+}
+
+void TextureTable::create(const vk::raii::PhysicalDevice& physicalDevice, const vk::raii::Device& device, uint32_t capacity){
+    clear();
+
+    //a combined image sampler counts against the sampler and the sampled image limits
+    auto propertiesChain = physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceVulkan12Properties>();
+    const vk::PhysicalDeviceVulkan12Properties& limits = propertiesChain.get<vk::PhysicalDeviceVulkan12Properties>();
+    capacity = std::min({capacity,
+        limits.maxPerStageDescriptorUpdateAfterBindSamplers, limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+        limits.maxDescriptorSetUpdateAfterBindSamplers, limits.maxDescriptorSetUpdateAfterBindSampledImages});
+    if (capacity == 0) {
+        throw std::runtime_error("texture table capacity is zero!");
+    }
+
+    vk::DescriptorSetLayoutBinding binding(
+        0, // binding
+        vk::DescriptorType::eCombinedImageSampler,
+        capacity, // descriptorCount
+        vk::ShaderStageFlagBits::eFragment,
+        nullptr
+    );
+    //new slots are written while frames using the set are still pending, they only touch elements those frames don't read
+    vk::DescriptorBindingFlags bindingFlags = vk::DescriptorBindingFlagBits::eUpdateAfterBind | vk::DescriptorBindingFlagBits::ePartiallyBound
+        | vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+    vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo(1, &bindingFlags);
+    vk::DescriptorSetLayoutCreateInfo layoutInfo(vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool, 1, &binding, &bindingFlagsInfo);
+    layout_ = vk::raii::DescriptorSetLayout(device, layoutInfo);
+
+    vk::DescriptorPoolSize poolSize(vk::DescriptorType::eCombinedImageSampler, capacity);
+    vk::DescriptorPoolCreateInfo poolInfo(
+        vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind | vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet, // flags
+        1, // maxSets
+        1, // poolSizeCount
+        &poolSize // pPoolSizes
+    );
+    pool_ = vk::raii::DescriptorPool(device, poolInfo);
+
+    vk::DescriptorSetLayout setLayout = *layout_;
+    vk::DescriptorSetAllocateInfo allocInfo(*pool_, 1, &setLayout);
+    set_ = std::move(device.allocateDescriptorSets(allocInfo).front());
+
+    device_ = &device;
+    slots_.reset(capacity);
+}
+
+TextureSlot TextureTable::add(vk::ImageView imageView, vk::Sampler sampler, vk::ImageLayout imageLayout){
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (slots_.size() == slots_.getCapacity()) {
+        throw std::runtime_error("texture table is full!");
+    }
+    uint32_t index = slots_.allocate();
+
+    vk::DescriptorImageInfo imageInfo(sampler, imageView, imageLayout);
+    vk::WriteDescriptorSet write(
+        *set_, // dstSet
+        0, // dstBinding
+        index, // dstArrayElement
+        1, // descriptorCount
+        vk::DescriptorType::eCombinedImageSampler, // descriptorType
+        &imageInfo, // pImageInfo
+        nullptr, // pBufferInfo
+        nullptr // pTexelBufferView
+    );
+    device_->updateDescriptorSets(write, nullptr);
+
+    return TextureSlot(this, index, slots_.getEpoch());
+}
+
+void TextureTable::free(uint32_t index, uint32_t epoch){
+    //the stale descriptor stays in place, partially bound slots may be invalid while no draw reads them
+    std::lock_guard<std::mutex> lock(mutex_);
+    slots_.free(index, epoch);
+}
+
+uint32_t TextureTable::size() const{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return slots_.size();
+}
+
+void TextureTable::clear(){
+    set_.clear();
+    pool_.clear();
+    layout_.clear();
+    device_ = nullptr;
+    slots_.reset(0);
+}
+
+}
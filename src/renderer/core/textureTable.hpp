@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "slotAllocator.hpp"
+
+namespace rendr{
+
+class TextureTable;
+
+//Owning handle of a table slot, the slot goes back to the table on destruction.
+//The GPU has to be done with the slot by then, hand it to Renderer::retire
+class TextureSlot{
+private:
+    TextureTable* table_ = nullptr;
+    uint32_t index_ = 0;
+    uint32_t epoch_ = 0;
+
+public:
+    TextureSlot() = default;
+    TextureSlot(TextureTable* table, uint32_t index, uint32_t epoch)
+        : table_(table), index_(index), epoch_(epoch) {}
+
+    TextureSlot(const TextureSlot&) = delete;
+    TextureSlot& operator=(const TextureSlot&) = delete;
+
+    TextureSlot(TextureSlot&& other) noexcept;
+    TextureSlot& operator=(TextureSlot&& other) noexcept;
+
+    ~TextureSlot();
+
+    void clear();
+
+    //what draws put into DrawPacket::textureIndex
+    uint32_t getIndex() const{
+        return index_;
+    }
+
+    explicit operator bool() const{
+        return table_ != nullptr;
+    }
+};
+
+//One descriptor set with an array of every texture of the renderer, bound once as set 1.
+//Draws select their texture with DrawData::textureIndex, so draws of different textures share
+//all bound state and merge into the same indirect draws. The set is update after bind and partially bound:
+//slots are written while frames using other slots are in flight, unwritten slots are never read
+class TextureTable{
+private:
+    const vk::raii::Device* device_ = nullptr;
+    vk::raii::DescriptorSetLayout layout_;
+    vk::raii::DescriptorPool pool_;
+    vk::raii::DescriptorSet set_;
+    rendr::SlotAllocator slots_;
+    //slots are added by loaders and freed by the deletion queue, descriptor writes to the set need the lock too
+    mutable std::mutex mutex_;
+
+public:
+    TextureTable();
+
+    TextureTable(const TextureTable&) = delete;
+    TextureTable& operator=(const TextureTable&) = delete;
+
+    //features the table needs, DeviceConfig::requiredVulkan12Features has them so pickPhysicalDevice skips devices without them
+    static bool isSupported(const vk::PhysicalDeviceVulkan12Features& enabledFeatures);
+
+    //capacity is clamped to the device's update after bind limits
+    void create(const vk::raii::PhysicalDevice& physicalDevice, const vk::raii::Device& device, uint32_t capacity);
+
+    //writes the texture into a free slot, throws when the table is full. The view and the sampler have to live as long as the slot
+    TextureSlot add(vk::ImageView imageView, vk::Sampler sampler,
+        vk::ImageLayout imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal);
+
+    //slots of a table that was created again since are ignored
+    void free(uint32_t index, uint32_t epoch);
+
+    const vk::raii::DescriptorSetLayout& getLayout() const{
+        return layout_;
+    }
+
+    vk::DescriptorSet getSet() const{
+        return *set_;
+    }
+
+    uint32_t getCapacity() const{
+        return slots_.getCapacity();
+    }
+
+    //slots in use
+    uint32_t size() const;
+
+    void clear();
+};
+
+}
@@ -0,0 +1,160 @@
+#include "uploadContext.hpp"
+
+#include <cstring>
+
+namespace rendr{
+
+UploadContext::UploadContext()
+: commandPool_(nullptr){}
+
+UploadContext::~UploadContext(){
+    if (device_ != nullptr) {
+        waitIdle();
+    }
+}
+
+void UploadContext::create(const vk::raii::Device& device, const rendr::Allocator& allocator, rendr::StagingRing& stagingRing,
+    uint32_t queueFamily, const vk::raii::Queue& queue, bool supportsGraphics, std::vector<uint32_t> sharingFamilies){
+
+    device_ = &device;
+    allocator_ = &allocator;
+    stagingRing_ = &stagingRing;
+    queue_ = &queue;
+    queueFamily_ = queueFamily;
+    supportsGraphics_ = supportsGraphics;
+    sharingFamilies_ = std::move(sharingFamilies);
+
+    vk::CommandPoolCreateInfo poolCreateInfo(
+        vk::CommandPoolCreateFlagBits::eResetCommandBuffer | vk::CommandPoolCreateFlagBits::eTransient,
+        queueFamily_
+    );
+    commandPool_ = vk::raii::CommandPool(device, poolCreateInfo);
+}
+
+UploadContext::Batch UploadContext::acquireBatch(){
+    if (!freeBatches_.empty()) {
+        Batch batch = std::move(freeBatches_.back());
+        freeBatches_.pop_back();
+        batch.commandBuffer.reset();
+        device_->resetFences({*batch.fence});
+        return batch;
+    }
+
+    vk::CommandBufferAllocateInfo buffAllocInfo(
+        *commandPool_,
+        vk::CommandBufferLevel::ePrimary,
+        1
+    );
+
+    Batch batch;
+    std::vector<vk::raii::CommandBuffer> buffers = device_->allocateCommandBuffers(buffAllocInfo);
+    batch.commandBuffer = std::move(buffers[0]);
+    batch.fence = vk::raii::Fence(*device_, vk::FenceCreateInfo());
+    return batch;
+}
+
+const vk::raii::CommandBuffer& UploadContext::getCommandBuffer(){
+    if (!recording_) {
+        recording_ = acquireBatch();
+        recording_->ticket = UploadTicket{nextTicket_++};
+
+        vk::CommandBufferBeginInfo beginInfo(
+            vk::CommandBufferUsageFlagBits::eOneTimeSubmit
+        );
+        recording_->commandBuffer.begin(beginInfo);
+    }
+    return recording_->commandBuffer;
+}
+
+UploadTicket UploadContext::getRecordingTicket(){
+    getCommandBuffer();
+    return recording_->ticket;
+}
+
+StagingSpan UploadContext::stage(const void* data, vk::DeviceSize size, vk::DeviceSize alignment){
+    getCommandBuffer();
+
+    //payloads bigger than half of the ring would stall everything else using it
+    if (size <= stagingRing_->getCapacity() / 2) {
+        std::optional<StagingSpan> span = stagingRing_->allocate(size, alignment);
+        if (!span && !inFlight_.empty()) {
+            //ring is held by submitted batches, the oldest one gives its ranges back first
+            wait(inFlight_.front().ticket);
+            span = stagingRing_->allocate(size, alignment);
+        }
+        if (span) {
+            memcpy(span->mappedData, data, static_cast<size_t>(size));
+            recording_->ringSpans.push_back(span->id);
+            return *span;
+        }
+    }
+
+    rendr::Buffer stagingBuffer = rendr::createBuffer(*allocator_, *device_, size, vk::BufferUsageFlagBits::eTransferSrc,
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+    memcpy(stagingBuffer.allocation.getMappedData(), data, static_cast<size_t>(size));
+    recording_->stagingBuffers.push_back(std::move(stagingBuffer));
+
+    StagingSpan span;
+    span.buffer = &recording_->stagingBuffers.back().buffer;
+    span.size = size;
+    span.mappedData = recording_->stagingBuffers.back().allocation.getMappedData();
+    return span;
+}
+
+UploadTicket UploadContext::submit(){
+    if (!recording_) {
+        return UploadTicket{nextTicket_ - 1};
+    }
+
+    recording_->commandBuffer.end();
+    vk::SubmitInfo submitInfo({}, {}, *recording_->commandBuffer);
+    queue_->submit({ submitInfo }, *recording_->fence);
+
+    UploadTicket ticket = recording_->ticket;
+    inFlight_.push_back(std::move(*recording_));
+    recording_.reset();
+    return ticket;
+}
+
+void UploadContext::collect(){
+    while (!inFlight_.empty() && inFlight_.front().fence.getStatus() == vk::Result::eSuccess) {
+        Batch& batch = inFlight_.front();
+        completedTicket_ = batch.ticket.value;
+        for (uint64_t spanId : batch.ringSpans) {
+            stagingRing_->release(spanId);
+        }
+        batch.ringSpans.clear();
+        batch.stagingBuffers.clear();
+        freeBatches_.push_back(std::move(batch));
+        inFlight_.pop_front();
+    }
+}
+
+bool UploadContext::isComplete(UploadTicket ticket){
+    if (ticket.value <= completedTicket_) {
+        return true;
+    }
+    collect();
+    return ticket.value <= completedTicket_;
+}
+
+void UploadContext::wait(UploadTicket ticket){
+    if (recording_ && ticket.value >= recording_->ticket.value) {
+        submit();
+    }
+
+    for (Batch& batch : inFlight_) {
+        if (batch.ticket.value > ticket.value) {
+            break;
+        }
+        vk::Result waitRes = device_->waitForFences({*batch.fence}, VK_TRUE, UINT64_MAX);
+    }
+    collect();
+}
+
+void UploadContext::waitIdle(){
+    submit();
+    wait(UploadTicket{nextTicket_ - 1});
+}
+
+}
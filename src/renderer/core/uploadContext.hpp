@@ -0,0 +1,100 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <optional>
+#include <vulkan/vulkan_raii.hpp>
+
+#include "allocator.hpp"
+#include "stagingRing.hpp"
+
+namespace rendr{
+
+//Identifies the batch a copy was recorded into. Zero ticket means there is nothing to wait for
+struct UploadTicket{
+    uint64_t value = 0;
+
+    bool operator<(const UploadTicket& other) const{
+        return value < other.value;
+    }
+};
+
+//Accumulates copies and layout transitions into one command buffer per batch.
+//Batches are submitted with a fence and never block the caller, staging ranges are given back to the ring when the batch completes
+class UploadContext{
+private:
+    struct Batch{
+        vk::raii::CommandBuffer commandBuffer;
+        vk::raii::Fence fence;
+        std::vector<uint64_t> ringSpans;
+        //dedicated buffers for payloads too big for the ring
+        std::deque<rendr::Buffer> stagingBuffers;
+        UploadTicket ticket;
+
+        Batch() : commandBuffer(nullptr), fence(nullptr){}
+    };
+
+    const vk::raii::Device* device_ = nullptr;
+    const rendr::Allocator* allocator_ = nullptr;
+    const vk::raii::Queue* queue_ = nullptr;
+    rendr::StagingRing* stagingRing_ = nullptr;
+    vk::raii::CommandPool commandPool_;
+    uint32_t queueFamily_ = 0;
+    bool supportsGraphics_ = false;
+    std::vector<uint32_t> sharingFamilies_;
+
+    std::optional<Batch> recording_;
+    std::deque<Batch> inFlight_;
+    std::vector<Batch> freeBatches_;
+    uint64_t nextTicket_ = 1;
+    uint64_t completedTicket_ = 0;
+
+    Batch acquireBatch();
+public:
+    UploadContext();
+    ~UploadContext();
+
+    UploadContext(const UploadContext&) = delete;
+    UploadContext& operator=(const UploadContext&) = delete;
+
+    //sharingFamilies - queue families the uploaded resources are used on, empty if it is only the upload queue family
+    void create(const vk::raii::Device& device, const rendr::Allocator& allocator, rendr::StagingRing& stagingRing,
+        uint32_t queueFamily, const vk::raii::Queue& queue, bool supportsGraphics, std::vector<uint32_t> sharingFamilies);
+
+    //command buffer of the batch being recorded, begins a new batch if needed
+    const vk::raii::CommandBuffer& getCommandBuffer();
+
+    //ticket that will be signaled by the batch being recorded
+    UploadTicket getRecordingTicket();
+
+    //ticket covering every copy recorded so far, doesn't begin a batch
+    UploadTicket getLatestTicket() const{
+        return recording_ ? recording_->ticket : UploadTicket{nextTicket_ - 1};
+    }
+
+    //copies data into staging memory which lives until the current batch completes.
+    //alignment is the offset alignment required by the copy command reading the span
+    StagingSpan stage(const void* data, vk::DeviceSize size, vk::DeviceSize alignment = 16);
+
+    //submits the batch being recorded, returns its ticket (or the last submitted one if nothing was recorded)
+    UploadTicket submit();
+
+    bool isComplete(UploadTicket ticket);
+    void wait(UploadTicket ticket);
+    void waitIdle();
+
+    //recycles command buffers and staging memory of completed batches
+    void collect();
+
+    //resources written by the upload queue have to be shared with these queue families (concurrent sharing mode)
+    const std::vector<uint32_t>& getSharingFamilies() const{
+        return sharingFamilies_;
+    }
+
+    //transfer only queues can't blit or wait for graphics stages
+    bool supportsGraphics() const{
+        return supportsGraphics_;
+    }
+};
+
+}
@@ -1,4 +1,6 @@
 #include "utility.hpp"
+#include <cstddef>
+#include <chrono>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -19,19 +21,55 @@ bool checkDeviceExtensionSupport(const vk::PhysicalDevice& device, const std::ve
 }
 
 
+//the Bool32 members of VkPhysicalDeviceVulkan12Features, after sType and pNext
+static const size_t firstVulkan12Feature = offsetof(VkPhysicalDeviceVulkan12Features, samplerMirrorClampToEdge);
+static const size_t vulkan12FeatureCount = (sizeof(VkPhysicalDeviceVulkan12Features) - firstVulkan12Feature) / sizeof(vk::Bool32);
+
+static const vk::Bool32* getVulkan12FeatureBools(const vk::PhysicalDeviceVulkan12Features& features){
+    return reinterpret_cast<const vk::Bool32*>(reinterpret_cast<const char*>(&features) + firstVulkan12Feature);
+}
+
+static vk::Bool32* getVulkan12FeatureBools(vk::PhysicalDeviceVulkan12Features& features){
+    return reinterpret_cast<vk::Bool32*>(reinterpret_cast<char*>(&features) + firstVulkan12Feature);
+}
+
+static bool hasVulkan12Features(vk::raii::PhysicalDevice const & device, const vk::PhysicalDeviceVulkan12Features& required){
+    const vk::Bool32* requiredBools = getVulkan12FeatureBools(required);
+    bool anyRequired = false;
+    for (size_t i = 0; i < vulkan12FeatureCount; i++) {
+        anyRequired = anyRequired || requiredBools[i];
+    }
+    if (!anyRequired) {
+        return true;
+    }
+    if (device.getProperties().apiVersion < VK_API_VERSION_1_2) {
+        return false;
+    }
+
+    auto supportedChain = device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+    const vk::Bool32* supportedBools = getVulkan12FeatureBools(supportedChain.get<vk::PhysicalDeviceVulkan12Features>());
+    for (size_t i = 0; i < vulkan12FeatureCount; i++) {
+        if (requiredBools[i] && !supportedBools[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
 bool isPhysicalDeviceSuitable(vk::raii::PhysicalDevice const & device, vk::raii::SurfaceKHR const & surface, const DeviceConfig& config) {
     
     vk::PhysicalDeviceFeatures features = device.getFeatures();
     vk::PhysicalDeviceProperties properties = device.getProperties();
-    bool featuresSupport = config.isDeviceFeaturesSuitable(features);
+    bool featuresSupport = config.isDeviceFeaturesSuitable(features) && hasVulkan12Features(device, config.requiredVulkan12Features);
     bool propertiesSupport = config.isDevicePropertiesSuitable(properties);
 
     QueueFamilyIndices indices = findQueueFamilies(*device, *surface);
     bool familyIndicesSupport = config.isDeviceFamilyIndicesSuitable(indices);
 
     bool extensionsSupported = checkDeviceExtensionSupport(*device, config.requiredDeviceExtensions);
-    bool swapChainAdequate = false;
-    if (extensionsSupported) {
+    //headless devices are picked without a surface and present nothing
+    bool swapChainAdequate = !*surface;
+    if (extensionsSupported && *surface) {
         SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device, surface);
         swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
     }
@@ -62,18 +100,27 @@ QueueFamilyIndices findQueueFamilies(const vk::PhysicalDevice& device, const vk:
     std::vector<vk::QueueFamilyProperties> queueFamilies = device.getQueueFamilyProperties();
     uint32_t familyIndex = 0;
     for (const auto& queueFamily : queueFamilies) {
-        if (queueFamily.queueFlags & vk::QueueFlagBits::eGraphics) {
+        bool graphics = static_cast<bool>(queueFamily.queueFlags & vk::QueueFlagBits::eGraphics);
+        bool compute = static_cast<bool>(queueFamily.queueFlags & vk::QueueFlagBits::eCompute);
+        bool transfer = static_cast<bool>(queueFamily.queueFlags & vk::QueueFlagBits::eTransfer);
+
+        if (graphics && !indices.graphicsFamily.has_value()) {
             indices.graphicsFamily = familyIndex;
         }
-        VkBool32 presentSupport = false;
        
-        if(device.getSurfaceSupportKHR(familyIndex, surface)){
+        if(surface && !indices.presentFamily.has_value() && device.getSurfaceSupportKHR(familyIndex, surface)){
             indices.presentFamily = familyIndex;
         }
 
-        //TODO найти все типы очередей
-        if (indices.isGraphicsAndPresent()) {
-            break;
+        //transfer only family is usually backed by a DMA engine which runs alongside graphics work
+        if (transfer && !graphics && !compute) {
+            indices.transferFamily = familyIndex;
+        } else if (transfer && !graphics && !indices.transferFamily.has_value()) {
+            indices.transferFamily = familyIndex;
+        }
+
+        if (compute && !graphics && !indices.computeFamily.has_value()) {
+            indices.computeFamily = familyIndex;
         }
         familyIndex++;
     }
@@ -90,15 +137,25 @@ SwapChainSupportDetails querySwapChainSupport(vk::raii::PhysicalDevice const & d
     return details;
 }
 
+static void mergeOptionalFeatures(vk::Bool32* enabled, const vk::Bool32* optional, const vk::Bool32* supported, size_t featureCount){
+    for (size_t i = 0; i < featureCount; i++) {
+        enabled[i] = enabled[i] || (optional[i] && supported[i]);
+    }
+}
+
 DeviceWithGraphicsAndPresentQueues createDeviceWithGraphicsAndPresentQueues( vk::raii::PhysicalDevice const & physicalDevice,  vk::raii::SurfaceKHR const & surface, const DeviceConfig& config){
     QueueFamilyIndices indices = findQueueFamilies(*physicalDevice, *surface);
     
     std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
-    std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+    uint32_t presentFamily = indices.presentFamily.value_or(indices.graphicsFamily.value());
+    std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), presentFamily};
+    if (indices.transferFamily.has_value()) {
+        uniqueQueueFamilies.insert(indices.transferFamily.value());
+    }
    
     float queuePriority = 1.0f;
     for (uint32_t queueFamily : uniqueQueueFamilies) {
-        queueCreateInfos.push_back(vk::DeviceQueueCreateInfo( vk::DeviceQueueCreateFlags(), indices.graphicsFamily.value(), 1, &queuePriority));
+        queueCreateInfos.push_back(vk::DeviceQueueCreateInfo( vk::DeviceQueueCreateFlags(), queueFamily, 1, &queuePriority));
     }
 
     vk::DeviceCreateInfo deviceCreateInfo;
@@ -106,14 +163,36 @@ DeviceWithGraphicsAndPresentQueues createDeviceWithGraphicsAndPresentQueues( vk:
     deviceCreateInfo.setPQueueCreateInfos(queueCreateInfos.data()); 
     deviceCreateInfo.setEnabledExtensionCount(config.requiredDeviceExtensions.size()); 
     deviceCreateInfo.setPpEnabledExtensionNames(config.requiredDeviceExtensions.data()); 
-    deviceCreateInfo.setPEnabledFeatures(&config.deviceEnableFeatures); 
+    //optional features are switched on only where the device has them
+    vk::PhysicalDeviceFeatures enabledFeatures = config.deviceEnableFeatures;
+    vk::PhysicalDeviceFeatures supportedFeatures = physicalDevice.getFeatures();
+    mergeOptionalFeatures(reinterpret_cast<vk::Bool32*>(&enabledFeatures), reinterpret_cast<const vk::Bool32*>(&config.optionalDeviceFeatures),
+        reinterpret_cast<const vk::Bool32*>(&supportedFeatures), sizeof(vk::PhysicalDeviceFeatures) / sizeof(vk::Bool32));
+    deviceCreateInfo.setPEnabledFeatures(&enabledFeatures); 
+
+    //1.2 features are chained only on devices that report 1.2, older drivers reject the struct.
+    //pickPhysicalDevice already made sure the required ones are supported
+    vk::PhysicalDeviceVulkan12Features enabledVulkan12Features;
+    if (physicalDevice.getProperties().apiVersion >= VK_API_VERSION_1_2) {
+        auto supportedChain = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+        enabledVulkan12Features = config.requiredVulkan12Features;
+        mergeOptionalFeatures(
+            getVulkan12FeatureBools(enabledVulkan12Features),
+            getVulkan12FeatureBools(config.optionalVulkan12Features),
+            getVulkan12FeatureBools(supportedChain.get<vk::PhysicalDeviceVulkan12Features>()),
+            vulkan12FeatureCount);
+        enabledVulkan12Features.pNext = nullptr;
+        deviceCreateInfo.setPNext(&enabledVulkan12Features);
+    }
     deviceCreateInfo.setFlags(vk::DeviceCreateFlags());
 
     vk::raii::Device device(physicalDevice, deviceCreateInfo);
     vk::raii::Queue graphicsQueue(device, indices.graphicsFamily.value(), 0);
-    vk::raii::Queue presentQueue (device, indices.presentFamily.value(), 0);
+    vk::raii::Queue presentQueue (device, presentFamily, 0);
+    vk::raii::Queue transferQueue (device, indices.transferFamily.value_or(indices.graphicsFamily.value()), 0);
     
-    return DeviceWithGraphicsAndPresentQueues{std::move(device), std::move(graphicsQueue), std::move(presentQueue)};
+    return DeviceWithGraphicsAndPresentQueues{std::move(device), std::move(graphicsQueue), std::move(presentQueue), std::move(transferQueue),
+        enabledFeatures, enabledVulkan12Features};
 }
 
 VkSurfaceFormatKHR chooseSwapSurfaceFormat(std::vector<vk::SurfaceFormatKHR> const & availableFormats,
@@ -159,7 +238,8 @@ SwapChainData createSwapChain(
     vk::raii::SurfaceKHR const & surface, 
     vk::raii::Device const & device, 
     rendr::Window const & win,
-    const rendr::SwapChainConfig& config) 
+    const rendr::SwapChainConfig& config,
+    vk::SwapchainKHR oldSwapChain) 
 {
     rendr::SwapChainSupportDetails swapChainSupport = rendr::querySwapChainSupport(physicalDevice, surface);
     vk::SurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats, config);
@@ -196,7 +276,7 @@ SwapChainData createSwapChain(
     createInfo.compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque;
     createInfo.presentMode = presentMode;
     createInfo.clipped = VK_TRUE;
-    createInfo.oldSwapchain = VK_NULL_HANDLE;
+    createInfo.oldSwapchain = oldSwapChain;
 
     vk::raii::SwapchainKHR swapChain(device, createInfo);
 
@@ -270,7 +350,8 @@ vk::raii::RenderPass createRenderPass(
     return vk::raii::RenderPass(device, renderPassInfo);
 }
 
-vk::raii::RenderPass createRenderPassWithColorAndDepthAttOneSubpass(const vk::raii::Device& device, vk::Format swapChainImageFormat, vk::Format depthFormat) {
+vk::raii::RenderPass createRenderPassWithColorAndDepthAttOneSubpass(const vk::raii::Device& device, vk::Format swapChainImageFormat, vk::Format depthFormat,
+    vk::ImageLayout finalColorLayout, bool storeDepth) {
     vk::AttachmentDescription colorAttachment(
         {},
         swapChainImageFormat,
@@ -280,7 +361,7 @@ vk::raii::RenderPass createRenderPassWithColorAndDepthAttOneSubpass(const vk::ra
         vk::AttachmentLoadOp::eDontCare,
         vk::AttachmentStoreOp::eDontCare,
         vk::ImageLayout::eUndefined,
-        vk::ImageLayout::ePresentSrcKHR
+        finalColorLayout
     );
 
     vk::AttachmentDescription depthAttachment(
@@ -288,7 +369,7 @@ vk::raii::RenderPass createRenderPassWithColorAndDepthAttOneSubpass(const vk::ra
         depthFormat,
         vk::SampleCountFlagBits::e1,
         vk::AttachmentLoadOp::eClear,
-        vk::AttachmentStoreOp::eDontCare,
+        storeDepth ? vk::AttachmentStoreOp::eStore : vk::AttachmentStoreOp::eDontCare,
         vk::AttachmentLoadOp::eDontCare,
         vk::AttachmentStoreOp::eDontCare,
         vk::ImageLayout::eUndefined,
@@ -319,6 +400,17 @@ vk::raii::RenderPass createRenderPassWithColorAndDepthAttOneSubpass(const vk::ra
     std::vector<vk::SubpassDescription> subpasses = { subpass };
     std::vector<vk::SubpassDependency> dependencies = { dependency };
 
+    if (finalColorLayout == vk::ImageLayout::eTransferSrcOptimal) {
+        //implicit external dependency doesn't cover the copy that follows the render pass
+        dependencies.push_back(vk::SubpassDependency(
+            0, VK_SUBPASS_EXTERNAL,
+            vk::PipelineStageFlagBits::eColorAttachmentOutput,
+            vk::PipelineStageFlagBits::eTransfer,
+            vk::AccessFlagBits::eColorAttachmentWrite,
+            vk::AccessFlagBits::eTransferRead
+        ));
+    }
+
     return createRenderPass(device, attachments, subpasses, dependencies);
 }
 
@@ -380,6 +472,43 @@ vk::raii::DescriptorSetLayout createSamplerDescriptorSetLayout(const vk::raii::D
 }
 
 
+vk::raii::DescriptorSetLayout createDynamicUboDescriptorSetLayout(const vk::raii::Device& device) {
+    vk::DescriptorSetLayoutBinding uboLayoutBinding(
+        0, // binding
+        vk::DescriptorType::eUniformBufferDynamic,
+        1, // descriptorCount
+        vk::ShaderStageFlagBits::eVertex,
+        nullptr
+    );
+
+    std::vector<vk::DescriptorSetLayoutBinding> bindings = {uboLayoutBinding};
+
+    return createDescriptorSetLayout(device, bindings);
+}
+
+
+vk::raii::DescriptorSetLayout createFrameDescriptorSetLayout(const vk::raii::Device& device) {
+    vk::DescriptorSetLayoutBinding uboLayoutBinding(
+        0, // binding
+        vk::DescriptorType::eUniformBufferDynamic,
+        1, // descriptorCount
+        vk::ShaderStageFlagBits::eVertex,
+        nullptr
+    );
+
+    vk::DescriptorSetLayoutBinding drawDataLayoutBinding(
+        1, // binding
+        vk::DescriptorType::eStorageBuffer,
+        1, // descriptorCount
+        vk::ShaderStageFlagBits::eVertex,
+        nullptr
+    );
+
+    std::vector<vk::DescriptorSetLayoutBinding> bindings = {uboLayoutBinding, drawDataLayoutBinding};
+
+    return createDescriptorSetLayout(device, bindings);
+}
+
 vk::raii::DescriptorSetLayout createUboAndSamplerDescriptorSetLayout(const vk::raii::Device& device) {
     vk::DescriptorSetLayoutBinding uboLayoutBinding(
         0, // binding
@@ -440,41 +569,17 @@ uint32_t findMemoryType(vk::raii::PhysicalDevice const & physicalDevice, uint32_
     throw std::runtime_error("failed to find suitable memory type!");
 }
 
-rendr::Image createImage(
-    const vk::raii::PhysicalDevice& physicalDevice,
-    const vk::raii::Device& device,
-    vk::MemoryPropertyFlags properties,
-    vk::ImageCreateInfo imageInfo,
-    vk::ImageViewCreateInfo imageViewInfo) {
-
-    rendr::Image image;
-    image.image = device.createImage(imageInfo);
-    vk::MemoryRequirements memRequirements = image.image.getMemoryRequirements();
-    
-    vk::MemoryAllocateInfo allocInfo(
-        memRequirements.size, // allocationSize
-        findMemoryType(physicalDevice, memRequirements.memoryTypeBits, properties)
-    );
-
-    image.imageMemory = device.allocateMemory(allocInfo);
-
-    image.image.bindMemory(*image.imageMemory, 0);
-
-    imageViewInfo.image = *image.image;
-    image.imageView = device.createImageView(imageViewInfo);
-
-    return image;
-}
-
 rendr::Image createDepthImage(
     const vk::raii::PhysicalDevice& physicalDevice,
+    const rendr::Allocator& allocator,
     const vk::raii::Device& device,
     uint32_t width,
-    uint32_t height){
+    uint32_t height,
+    vk::ImageUsageFlags extraUsage){
     
     vk::Format format = findDepthFormat(physicalDevice);
     vk::ImageTiling tiling = vk::ImageTiling::eOptimal;
-    vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eDepthStencilAttachment;
+    vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eDepthStencilAttachment | extraUsage;
     vk::MemoryPropertyFlags properties = vk::MemoryPropertyFlagBits::eDeviceLocal;
 
     vk::ImageCreateInfo imageInfo(
@@ -508,13 +613,54 @@ rendr::Image createDepthImage(
         } 
     );
 
-    return createImage(physicalDevice, device, properties, imageInfo, viewInfo);
+    return createImage(allocator, device, properties, imageInfo, viewInfo);
+}
+
+rendr::Image createOffscreenColorImage(
+    const rendr::Allocator& allocator,
+    const vk::raii::Device& device,
+    vk::Format format,
+    uint32_t width,
+    uint32_t height){
+
+    vk::ImageCreateInfo imageInfo(
+        {}, // flags
+        vk::ImageType::e2D, // imageType
+        format, // format
+        vk::Extent3D(width, height, 1), // extent
+        1, // mipLevels
+        1, // arrayLayers
+        vk::SampleCountFlagBits::e1, // samples
+        vk::ImageTiling::eOptimal, // tiling
+        vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst, // usage
+        vk::SharingMode::eExclusive, // sharingMode
+        0, // queueFamilyIndexCount
+        nullptr, // pQueueFamilyIndices
+        vk::ImageLayout::eUndefined // initialLayout
+    );
+
+    vk::ImageViewCreateInfo viewInfo(
+        {}, // flags
+        {}, // image
+        vk::ImageViewType::e2D, // viewType
+        format, // format
+        {}, // components
+        {   // subresourceRange
+            vk::ImageAspectFlagBits::eColor, //aspectMask
+            0, //baseMipLevel
+            1, //levelCount
+            0, //baseArrayLayer
+            1 //layerCount
+        } 
+    );
+
+    return createImage(allocator, device, vk::MemoryPropertyFlagBits::eDeviceLocal, imageInfo, viewInfo);
 }
 
 std::vector<vk::raii::Framebuffer> createSwapChainFramebuffersWithDepthAtt(
     const vk::raii::Device& device, 
     const vk::raii::RenderPass& renderPass,
-    const std::vector<vk::raii::ImageView>& swapChainImageViews,
+    const std::vector<vk::ImageView>& swapChainImageViews,
     const vk::raii::ImageView& depthImageView, 
     uint32_t width, uint32_t height){
     
@@ -523,7 +669,7 @@ std::vector<vk::raii::Framebuffer> createSwapChainFramebuffersWithDepthAtt(
 
     for (size_t i = 0; i < swapChainImageViews.size(); i++) {
         std::vector<vk::ImageView> attachments = {
-            *swapChainImageViews[i],
+            swapChainImageViews[i],
             *depthImageView
         };
 
@@ -552,56 +698,8 @@ vk::raii::CommandPool createGraphicsCommandPool( const vk::raii::Device& device,
 
 }
 
-rendr::Buffer createBuffer(const vk::raii::PhysicalDevice &physicalDevice, const vk::raii::Device &device, vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties)
-{
-    vk::BufferCreateInfo bufferInfo(
-    {},
-    size,
-    usage,
-    vk::SharingMode::eExclusive);
-    rendr::Buffer buffer;
-    buffer.buffer = vk::raii::Buffer(device, bufferInfo);
-    vk::MemoryRequirements memRequirements = buffer.buffer.getMemoryRequirements();
-
-    vk::MemoryAllocateInfo memAllocInfo(
-        std::max(size, memRequirements.size),
-        findMemoryType(physicalDevice, memRequirements.memoryTypeBits, properties)
-    );
-
-    buffer.bufferMemory = vk::raii::DeviceMemory(device, memAllocInfo);
-    buffer.buffer.bindMemory(*(buffer.bufferMemory), 0);
-    
-    return buffer;
-}
-
-vk::raii::CommandBuffer beginSingleTimeCommands(const vk::raii::Device &device, const vk::raii::CommandPool& commandPool) {
-    vk::CommandBufferAllocateInfo buffAllocInfo(
-        *commandPool,
-        vk::CommandBufferLevel::ePrimary,
-        1
-    );
-
-    std::vector<vk::raii::CommandBuffer> buffers = device.allocateCommandBuffers(buffAllocInfo);
-    vk::raii::CommandBuffer buffer = std::move(buffers[0]);
-
-    vk::CommandBufferBeginInfo beginInfo(
-        vk::CommandBufferUsageFlagBits::eOneTimeSubmit
-    );
-    buffer.begin(beginInfo);
-
-    return buffer;
-}
-
-void endSingleTimeCommands(const vk::raii::CommandBuffer& commandBuffer, const vk::raii::Queue& queueToSubmit ) {
-    commandBuffer.end();
-
-    vk::SubmitInfo submitInfo({}, {}, *commandBuffer);
-    queueToSubmit.submit({ submitInfo });
-    queueToSubmit.waitIdle();
-}
-
-void writeTransitionImageLayoutBarrier(const vk::raii::CommandBuffer& singleTimeCommandBuffer, const vk::raii::Image& image, vk::Format format,
-    vk::ImageLayout oldLayout, vk::ImageLayout newLayout) {
+void writeTransitionImageLayoutBarrier(const vk::raii::CommandBuffer& commandBuffer, const vk::raii::Image& image, vk::Format format,
+    vk::ImageLayout oldLayout, vk::ImageLayout newLayout, bool onGraphicsQueue, uint32_t mipLevels) {
     
     vk::ImageMemoryBarrier barrier(
         {}, // srcAccessMask
@@ -614,7 +712,7 @@ void writeTransitionImageLayoutBarrier(const vk::raii::CommandBuffer& singleTime
         vk::ImageSubresourceRange(
             vk::ImageAspectFlagBits::eColor, // aspectMask
             0, // baseMipLevel
-            1, // levelCount
+            mipLevels, // levelCount
             0, // baseArrayLayer
             1 // layerCount
         )
@@ -631,15 +729,15 @@ void writeTransitionImageLayoutBarrier(const vk::raii::CommandBuffer& singleTime
         destinationStage = vk::PipelineStageFlagBits::eTransfer;
     } else if (oldLayout == vk::ImageLayout::eTransferDstOptimal && newLayout == vk::ImageLayout::eShaderReadOnlyOptimal) {
         barrier.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite);
-        barrier.setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+        barrier.setDstAccessMask(onGraphicsQueue ? vk::AccessFlagBits::eShaderRead : vk::AccessFlags());
 
         sourceStage = vk::PipelineStageFlagBits::eTransfer;
-        destinationStage = vk::PipelineStageFlagBits::eFragmentShader;
+        destinationStage = onGraphicsQueue ? vk::PipelineStageFlagBits::eFragmentShader : vk::PipelineStageFlagBits::eBottomOfPipe;
     } else {
         throw std::invalid_argument("unsupported layout transition!");
     }
 
-    singleTimeCommandBuffer.pipelineBarrier(
+    commandBuffer.pipelineBarrier(
         sourceStage, destinationStage,
         {},
         nullptr, nullptr,
@@ -647,10 +745,10 @@ void writeTransitionImageLayoutBarrier(const vk::raii::CommandBuffer& singleTime
     );
 }
     
-void writeCopyBufferToImageCommand(const vk::raii::CommandBuffer& singleTimeCommandBuffer, vk::raii::Buffer& buffer, 
-    const vk::raii::Image& image, uint32_t width, uint32_t height) {
+void writeCopyBufferToImageCommand(const vk::raii::CommandBuffer& commandBuffer, const vk::raii::Buffer& buffer, 
+    const vk::raii::Image& image, uint32_t width, uint32_t height, vk::DeviceSize bufferOffset) {
     vk::BufferImageCopy region(
-        0, // bufferOffset
+        bufferOffset, // bufferOffset
         0, // bufferRowLength
         0, // bufferImageHeight
         vk::ImageSubresourceLayers(
@@ -663,7 +761,7 @@ void writeCopyBufferToImageCommand(const vk::raii::CommandBuffer& singleTimeComm
         vk::Extent3D(width, height, 1) // imageExtent
     );
 
-    singleTimeCommandBuffer.copyBufferToImage(
+    commandBuffer.copyBufferToImage(
         *buffer,
         *image,
         vk::ImageLayout::eTransferDstOptimal,
@@ -671,72 +769,289 @@ void writeCopyBufferToImageCommand(const vk::raii::CommandBuffer& singleTimeComm
     );
 }
 
+void writeCopyImageToBufferCommand(const vk::raii::CommandBuffer& commandBuffer, const vk::raii::Image& image, 
+    const vk::raii::Buffer& buffer, uint32_t width, uint32_t height) {
+    vk::BufferImageCopy region(
+        0, // bufferOffset
+        0, // bufferRowLength
+        0, // bufferImageHeight
+        vk::ImageSubresourceLayers(
+            vk::ImageAspectFlagBits::eColor, // aspectMask
+            0, // mipLevel
+            0, // baseArrayLayer
+            1 // layerCount
+        ),
+        vk::Offset3D(0, 0, 0), // imageOffset
+        vk::Extent3D(width, height, 1) // imageExtent
+    );
+
+    commandBuffer.copyImageToBuffer(
+        *image,
+        vk::ImageLayout::eTransferSrcOptimal,
+        *buffer,
+        region
+    );
+
+    vk::BufferMemoryBarrier barrier(
+        vk::AccessFlagBits::eTransferWrite, // srcAccessMask
+        vk::AccessFlagBits::eHostRead, // dstAccessMask
+        VK_QUEUE_FAMILY_IGNORED, // srcQueueFamilyIndex
+        VK_QUEUE_FAMILY_IGNORED, // dstQueueFamilyIndex
+        *buffer, // buffer
+        0, // offset
+        VK_WHOLE_SIZE // size
+    );
+
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost,
+        {},
+        nullptr, barrier, nullptr
+    );
+}
+
+void writeCopyBufferToImageMipsCommand(const vk::raii::CommandBuffer& commandBuffer, const vk::raii::Buffer& buffer, 
+    const vk::raii::Image& image, const std::vector<MipLevel>& levels, vk::DeviceSize bufferOffset) {
+    std::vector<vk::BufferImageCopy> regions;
+    regions.reserve(levels.size());
+
+    for (uint32_t i = 0; i < levels.size(); i++) {
+        regions.push_back(vk::BufferImageCopy(
+            bufferOffset + levels[i].offset, // bufferOffset
+            0, // bufferRowLength
+            0, // bufferImageHeight
+            vk::ImageSubresourceLayers(
+                vk::ImageAspectFlagBits::eColor, // aspectMask
+                i, // mipLevel
+                0, // baseArrayLayer
+                1 // layerCount
+            ),
+            vk::Offset3D(0, 0, 0), // imageOffset
+            vk::Extent3D(levels[i].width, levels[i].height, 1) // imageExtent
+        ));
+    }
+
+    commandBuffer.copyBufferToImage(
+        *buffer,
+        *image,
+        vk::ImageLayout::eTransferDstOptimal,
+        regions
+    );
+}
+
+void writeGenerateMipmapsCommands(const vk::raii::CommandBuffer& commandBuffer, const vk::raii::Image& image, 
+    uint32_t width, uint32_t height, uint32_t mipLevels) {
+    
+    vk::ImageMemoryBarrier barrier(
+        {}, // srcAccessMask
+        {}, // dstAccessMask
+        {}, // oldLayout
+        {}, // newLayout
+        VK_QUEUE_FAMILY_IGNORED, // srcQueueFamilyIndex
+        VK_QUEUE_FAMILY_IGNORED, // dstQueueFamilyIndex
+        *image, // image
+        vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1)
+    );
+
+    int32_t mipWidth = static_cast<int32_t>(width);
+    int32_t mipHeight = static_cast<int32_t>(height);
+
+    for (uint32_t i = 1; i < mipLevels; i++) {
+        //previous level becomes the blit source
+        barrier.subresourceRange.baseMipLevel = i - 1;
+        barrier.setOldLayout(vk::ImageLayout::eTransferDstOptimal);
+        barrier.setNewLayout(vk::ImageLayout::eTransferSrcOptimal);
+        barrier.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite);
+        barrier.setDstAccessMask(vk::AccessFlagBits::eTransferRead);
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr, barrier);
+
+        int32_t nextWidth = std::max(mipWidth / 2, 1);
+        int32_t nextHeight = std::max(mipHeight / 2, 1);
+        vk::ImageBlit blit(
+            vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, i - 1, 0, 1), // srcSubresource
+            {vk::Offset3D(0, 0, 0), vk::Offset3D(mipWidth, mipHeight, 1)}, // srcOffsets
+            vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, i, 0, 1), // dstSubresource
+            {vk::Offset3D(0, 0, 0), vk::Offset3D(nextWidth, nextHeight, 1)} // dstOffsets
+        );
+        commandBuffer.blitImage(*image, vk::ImageLayout::eTransferSrcOptimal, *image, vk::ImageLayout::eTransferDstOptimal, blit, vk::Filter::eLinear);
+
+        barrier.setOldLayout(vk::ImageLayout::eTransferSrcOptimal);
+        barrier.setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal);
+        barrier.setSrcAccessMask(vk::AccessFlagBits::eTransferRead);
+        barrier.setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, nullptr, nullptr, barrier);
+
+        mipWidth = nextWidth;
+        mipHeight = nextHeight;
+    }
+
+    //the last level is only ever written
+    barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+    barrier.setOldLayout(vk::ImageLayout::eTransferDstOptimal);
+    barrier.setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal);
+    barrier.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite);
+    barrier.setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, nullptr, nullptr, barrier);
+}
+
 Image create2DTextureImage(
-    const vk::raii::PhysicalDevice &physicalDevice, 
+    const vk::raii::PhysicalDevice& physicalDevice,
+    const rendr::Allocator &allocator, 
     const vk::raii::Device &device, 
-    const vk::raii::CommandPool& commandPool,
-    const vk::raii::Queue& graphicsQueue,
+    rendr::UploadContext& uploadContext,
     STBImageRaii ImageData){
     
-    vk::DeviceSize imageSize = ImageData.getWidth() * ImageData.getHeight() * 4;
-
-    rendr::Buffer stagingBuffer = createBuffer(physicalDevice, device, imageSize, vk::BufferUsageFlagBits::eTransferSrc,
-        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
-    
-    void* data = stagingBuffer.bufferMemory.mapMemory(0, imageSize);
-        memcpy(data, ImageData.getDataPtr(), static_cast<size_t>(imageSize));
-    stagingBuffer.bufferMemory.unmapMemory();
+    const vk::Format format = vk::Format::eR8G8B8A8Srgb;
+    uint32_t width = static_cast<uint32_t>(ImageData.getWidth());
+    uint32_t height = static_cast<uint32_t>(ImageData.getHeight());
+    uint32_t mipLevels = calcMipLevels(width, height);
+
+    //vkCmdBlitImage needs a graphics queue and linear filtering support for the format
+    vk::FormatProperties formatProperties = physicalDevice.getFormatProperties(format);
+    bool blitMips = uploadContext.supportsGraphics() &&
+        (formatProperties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImageFilterLinear) &&
+        (formatProperties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eBlitSrc) &&
+        (formatProperties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eBlitDst);
+
+    std::vector<MipLevel> levels;
+    rendr::StagingSpan staging;
+    if (blitMips) {
+        staging = uploadContext.stage(ImageData.getDataPtr(), vk::DeviceSize(width) * height * 4);
+    } else {
+        std::vector<uint8_t> chain = buildMipChainRGBA8(ImageData.getDataPtr(), width, height, true, levels);
+        staging = uploadContext.stage(chain.data(), chain.size());
+    }
 
     vk::ImageCreateInfo imageCreateInfo(
         {},
         vk::ImageType::e2D,
-        vk::Format::eR8G8B8A8Srgb,
-        vk::Extent3D(ImageData.getWidth(), ImageData.getHeight(),  1),
-        1, // mipLevels
+        format,
+        vk::Extent3D(width, height, 1),
+        mipLevels, // mipLevels
         1, // arrayLayers
         vk::SampleCountFlagBits::e1,
         vk::ImageTiling::eOptimal,
-        vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+        vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
         vk::SharingMode::eExclusive,
         0, // queueFamilyIndexCount
         nullptr, // pQueueFamilyIndices
         vk::ImageLayout::eUndefined // initialLayout
     );
+    const std::vector<uint32_t>& sharingFamilies = uploadContext.getSharingFamilies();
+    if (sharingFamilies.size() > 1) {
+        imageCreateInfo.setSharingMode(vk::SharingMode::eConcurrent);
+        imageCreateInfo.setQueueFamilyIndices(sharingFamilies);
+    }
 
     vk::ImageViewCreateInfo imageViewCreateInfo(
         {}, //flags
         {}, //image
         vk::ImageViewType::e2D, // viewType, 
-        vk::Format::eR8G8B8A8Srgb,
+        format,
         {}, // components
-        { vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 }
+        { vk::ImageAspectFlagBits::eColor, 0, mipLevels, 0, 1 }
     );
 
-    rendr::Image textureImage = createImage(physicalDevice, device, vk::MemoryPropertyFlagBits::eDeviceLocal, imageCreateInfo, imageViewCreateInfo);
+    rendr::Image textureImage = createImage(allocator, device, vk::MemoryPropertyFlagBits::eDeviceLocal, imageCreateInfo, imageViewCreateInfo);
      
-    vk::raii::CommandBuffer singleTimeCommandBuffer = rendr::beginSingleTimeCommands(device, commandPool);
-        writeTransitionImageLayoutBarrier(singleTimeCommandBuffer, textureImage.image, vk::Format::eR8G8B8A8Srgb, 
-            vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
-    rendr::endSingleTimeCommands(singleTimeCommandBuffer, graphicsQueue);
-
-    singleTimeCommandBuffer = rendr::beginSingleTimeCommands(device, commandPool);
-        writeCopyBufferToImageCommand(singleTimeCommandBuffer, stagingBuffer.buffer, textureImage.image, ImageData.getWidth(), ImageData.getHeight());
-    rendr::endSingleTimeCommands(singleTimeCommandBuffer, graphicsQueue);
-
-    singleTimeCommandBuffer = rendr::beginSingleTimeCommands(device, commandPool);
-        writeTransitionImageLayoutBarrier(singleTimeCommandBuffer, textureImage.image, vk::Format::eR8G8B8A8Srgb, 
-            vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
-    rendr::endSingleTimeCommands(singleTimeCommandBuffer, graphicsQueue);
+    const vk::raii::CommandBuffer& commandBuffer = uploadContext.getCommandBuffer();
+    writeTransitionImageLayoutBarrier(commandBuffer, textureImage.image, format, 
+        vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, true, mipLevels);
+    if (blitMips) {
+        writeCopyBufferToImageCommand(commandBuffer, *staging.buffer, textureImage.image, width, height, staging.offset);
+        writeGenerateMipmapsCommands(commandBuffer, textureImage.image, width, height, mipLevels);
+    } else {
+        writeCopyBufferToImageMipsCommand(commandBuffer, *staging.buffer, textureImage.image, levels, staging.offset);
+        writeTransitionImageLayoutBarrier(commandBuffer, textureImage.image, format, 
+            vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, uploadContext.supportsGraphics(), mipLevels);
+    }
     
     return textureImage;
 }
 
 
+static vk::Format toVkFormat(CookedTextureFormat format, bool srgb){
+    switch (format) {
+    case CookedTextureFormat::RGBA8: return srgb ? vk::Format::eR8G8B8A8Srgb : vk::Format::eR8G8B8A8Unorm;
+    case CookedTextureFormat::BC1: return srgb ? vk::Format::eBc1RgbSrgbBlock : vk::Format::eBc1RgbUnormBlock;
+    case CookedTextureFormat::BC5: return vk::Format::eBc5UnormBlock;
+    case CookedTextureFormat::BC7: return srgb ? vk::Format::eBc7SrgbBlock : vk::Format::eBc7UnormBlock;
+    }
+    throw std::invalid_argument("unknown cooked texture format!");
+}
+
+bool isCookedFormatSupported(const vk::raii::PhysicalDevice& physicalDevice, CookedTextureFormat format, bool srgb){
+    vk::FormatProperties properties = physicalDevice.getFormatProperties(toVkFormat(format, srgb));
+    vk::FormatFeatureFlags features = vk::FormatFeatureFlagBits::eSampledImage | vk::FormatFeatureFlagBits::eTransferDst;
+    return (properties.optimalTilingFeatures & features) == features;
+}
+
+Image create2DTextureImage(
+    const vk::raii::PhysicalDevice& physicalDevice,
+    const rendr::Allocator &allocator, 
+    const vk::raii::Device &device, 
+    rendr::UploadContext& uploadContext,
+    const CookedTexture& texture){
+    
+    vk::Format format = findSupportedFormat(
+        physicalDevice,
+        {toVkFormat(texture.format, texture.srgb)},
+        vk::ImageTiling::eOptimal,
+        vk::FormatFeatureFlagBits::eSampledImage | vk::FormatFeatureFlagBits::eTransferDst
+    );
+    uint32_t mipLevels = static_cast<uint32_t>(texture.levels.size());
 
-vk::raii::Sampler createTextureSampler(const vk::raii::Device& device, const vk::raii::PhysicalDevice& physicalDevice) {
-    vk::PhysicalDeviceProperties properties = physicalDevice.getProperties();
+    std::vector<MipLevel> levels;
+    levels.reserve(texture.levels.size());
+    for (const CookedMip& level : texture.levels) {
+        levels.push_back(MipLevel{level.width, level.height, static_cast<size_t>(level.offset)});
+    }
 
-    vk::SamplerCreateInfo samplerInfo(
+    rendr::StagingSpan staging = uploadContext.stage(texture.data.data(), texture.data.size(), getCookedFormatBlockSize(texture.format));
+
+    vk::ImageCreateInfo imageCreateInfo(
+        {},
+        vk::ImageType::e2D,
+        format,
+        vk::Extent3D(texture.width, texture.height, 1),
+        mipLevels, // mipLevels
+        1, // arrayLayers
+        vk::SampleCountFlagBits::e1,
+        vk::ImageTiling::eOptimal,
+        vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+        vk::SharingMode::eExclusive,
+        0, // queueFamilyIndexCount
+        nullptr, // pQueueFamilyIndices
+        vk::ImageLayout::eUndefined // initialLayout
+    );
+    const std::vector<uint32_t>& sharingFamilies = uploadContext.getSharingFamilies();
+    if (sharingFamilies.size() > 1) {
+        imageCreateInfo.setSharingMode(vk::SharingMode::eConcurrent);
+        imageCreateInfo.setQueueFamilyIndices(sharingFamilies);
+    }
+
+    vk::ImageViewCreateInfo imageViewCreateInfo(
+        {}, //flags
+        {}, //image
+        vk::ImageViewType::e2D, // viewType, 
+        format,
+        {}, // components
+        { vk::ImageAspectFlagBits::eColor, 0, mipLevels, 0, 1 }
+    );
+
+    rendr::Image textureImage = createImage(allocator, device, vk::MemoryPropertyFlagBits::eDeviceLocal, imageCreateInfo, imageViewCreateInfo);
+     
+    const vk::raii::CommandBuffer& commandBuffer = uploadContext.getCommandBuffer();
+    writeTransitionImageLayoutBarrier(commandBuffer, textureImage.image, format, 
+        vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, true, mipLevels);
+    writeCopyBufferToImageMipsCommand(commandBuffer, *staging.buffer, textureImage.image, levels, staging.offset);
+    writeTransitionImageLayoutBarrier(commandBuffer, textureImage.image, format, 
+        vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal, uploadContext.supportsGraphics(), mipLevels);
+    
+    return textureImage;
+}
+
+vk::SamplerCreateInfo createTextureSamplerInfo(const vk::PhysicalDeviceLimits& limits) {
+    return vk::SamplerCreateInfo(
         {}, // flags
         vk::Filter::eLinear, // magFilter
         vk::Filter::eLinear, // minFilter
@@ -746,19 +1061,81 @@ vk::raii::Sampler createTextureSampler(const vk::raii::Device& device, const vk:
         vk::SamplerAddressMode::eRepeat, // addressModeW
         0.0f, // mipLodBias
         VK_TRUE, // anisotropyEnable
-        properties.limits.maxSamplerAnisotropy, // maxAnisotropy
+        limits.maxSamplerAnisotropy, // maxAnisotropy
         VK_FALSE, // compareEnable
         vk::CompareOp::eAlways, // compareOp
         0.0f, // minLod
-        0.0f, // maxLod
+        VK_LOD_CLAMP_NONE, // maxLod
         vk::BorderColor::eIntOpaqueBlack, // borderColor
         VK_FALSE // unnormalizedCoordinates
     );
+}
 
+vk::Sampler getTextureSampler(const rendr::Device& device) {
+    return device.samplerCache_.get(createTextureSamplerInfo(device.limits_));
+}
+
+vk::raii::Sampler createTextureSampler(const vk::raii::Device& device, const vk::PhysicalDeviceLimits& limits, const rendr::Image& image) {
+    vk::SamplerCreateInfo samplerInfo = createTextureSamplerInfo(limits);
+    samplerInfo.maxLod = static_cast<float>(image.mipLevels);
     return vk::raii::Sampler(device, samplerInfo);
 }
 
-std::pair<std::vector<VertexPCT>, std::vector<uint32_t>>  loadModel(const std::string& filepath) {
+// Открытая адресация по тройке индексов obj, без узлов и без хеширования float
+class ObjIndexDedupeTable{
+private:
+    struct Slot{
+        int vertexIndex;
+        int texcoordIndex;
+        int normalIndex;
+        uint32_t uniqueIndex;
+    };
+    static constexpr uint32_t emptySlot = std::numeric_limits<uint32_t>::max();
+
+    std::vector<Slot> slots_;
+    size_t mask_;
+
+    static uint64_t hash(const tinyobj::index_t& index){
+        uint64_t h = uint64_t(uint32_t(index.vertex_index)) | (uint64_t(uint32_t(index.texcoord_index)) << 32);
+        h ^= uint64_t(uint32_t(index.normal_index)) * 0x9E3779B97F4A7C15ull;
+        // splitmix64 finalizer
+        h ^= h >> 30;
+        h *= 0xBF58476D1CE4E5B9ull;
+        h ^= h >> 27;
+        h *= 0x94D049BB133111EBull;
+        h ^= h >> 31;
+        return h;
+    }
+public:
+    explicit ObjIndexDedupeTable(size_t maxEntries){
+        size_t capacity = 16;
+        while (capacity < maxEntries * 2) {
+            capacity *= 2;
+        }
+        slots_.assign(capacity, Slot{0, 0, 0, emptySlot});
+        mask_ = capacity - 1;
+    }
+
+    //index already assigned to the triple, or newIndex if the triple is seen for the first time
+    uint32_t findOrInsert(const tinyobj::index_t& index, uint32_t newIndex, bool& inserted){
+        size_t pos = hash(index) & mask_;
+        while (true) {
+            Slot& slot = slots_[pos];
+            if (slot.uniqueIndex == emptySlot) {
+                slot = Slot{index.vertex_index, index.texcoord_index, index.normal_index, newIndex};
+                inserted = true;
+                return newIndex;
+            }
+            if (slot.vertexIndex == index.vertex_index && slot.texcoordIndex == index.texcoord_index && slot.normalIndex == index.normal_index) {
+                inserted = false;
+                return slot.uniqueIndex;
+            }
+            pos = (pos + 1) & mask_;
+        }
+    }
+};
+
+rendr::Mesh<VertexPCT> loadModel(const std::string& filepath) {
     tinyobj::attrib_t attrib;
     std::vector<tinyobj::shape_t> shapes;
     std::vector<tinyobj::material_t> materials;
@@ -771,41 +1148,56 @@ std::pair<std::vector<VertexPCT>, std::vector<uint32_t>>  loadModel(const std::s
         throw std::runtime_error(warn + err);
     }
 
-    std::unordered_map<VertexPCT, uint32_t> uniqueVertices{};
-
+    size_t indexCount = 0;
     for (const auto& shape : shapes) {
-        for (const auto& index : shape.mesh.indices) {
-            VertexPCT vertex{};
-
-
-            vertex.pos = {
-                attrib.vertices[3 * index.vertex_index + 0],
-                attrib.vertices[3 * index.vertex_index + 1],
-                attrib.vertices[3 * index.vertex_index + 2]
-            };
-
-            vertex.texCoord = {
-                attrib.texcoords[2 * index.texcoord_index + 0],
-                1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-            };
+        indexCount += shape.mesh.indices.size();
+    }
+    indices.reserve(indexCount);
+    vertices.reserve(std::min(indexCount, attrib.vertices.size() / 3 * 2));
 
-            vertex.color = {1.0f, 1.0f, 1.0f};
+    // Вершины одинаковы, если совпадают индексы позиции, uv и нормали
+    ObjIndexDedupeTable uniqueVertices(indexCount);
 
-            if (uniqueVertices.count(vertex) == 0) {
-                uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
+    for (const auto& shape : shapes) {
+        for (const auto& index : shape.mesh.indices) {
+            bool inserted;
+            uint32_t uniqueIndex = uniqueVertices.findOrInsert(index, static_cast<uint32_t>(vertices.size()), inserted);
+
+            if (inserted) {
+                VertexPCT vertex{};
+
+                vertex.pos = {
+                    attrib.vertices[3 * index.vertex_index + 0],
+                    attrib.vertices[3 * index.vertex_index + 1],
+                    attrib.vertices[3 * index.vertex_index + 2]
+                };
+
+                if (index.texcoord_index >= 0) {
+                    vertex.texCoord = {
+                        attrib.texcoords[2 * index.texcoord_index + 0],
+                        1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
+                    };
+                }
+
+                vertex.color = {1.0f, 1.0f, 1.0f};
                 vertices.push_back(vertex);
             }
 
-            indices.push_back(uniqueVertices[vertex]);
+            indices.push_back(uniqueIndex);
         }        
     }
 
-    return {std::move(vertices), std::move(indices)};
+    rendr::Mesh<VertexPCT> mesh;
+    mesh.boundingSphere = computeBoundingSphere(vertices.data(), vertices.size());
+    mesh.vertices = std::move(vertices);
+    mesh.indices = std::move(indices);
+    return mesh;
 }
 
 
 rendr::Mesh<VertexPTN> convertUfbxMeshPart(ufbx_mesh *mesh, ufbx_mesh_part *part, ufbx_matrix* transformMat) {
     std::vector<VertexPTN> vertices;
+    vertices.reserve(part->num_triangles * 3);
     std::vector<uint32_t> tri_indices;
     tri_indices.resize(mesh->max_face_triangles * 3);
 
@@ -852,8 +1244,11 @@ rendr::Mesh<VertexPTN> convertUfbxMeshPart(ufbx_mesh *mesh, ufbx_mesh_part *part
 
     vertices.resize(num_vertices);
 
-
-    return {std::move(vertices), std::move(indices)};
+    rendr::Mesh<VertexPTN> meshPart;
+    meshPart.boundingSphere = computeBoundingSphere(vertices.data(), vertices.size());
+    meshPart.vertices = std::move(vertices);
+    meshPart.indices = std::move(indices);
+    return meshPart;
 }
 
 ufbx_scene* ufbxOpenScene(const std::string& filepath, bool blender_flag = true) {
@@ -871,9 +1266,23 @@ void ufbxCloseScene(ufbx_scene* scene_ptr){
     ufbx_free_scene(scene_ptr);
 }
 
-std::vector<std::pair<rendr::Mesh<VertexPTN>, uint32_t>> ufbxLoadMeshesPartsSepByMaterial(ufbx_scene* scene) {
+MaterialId ufbxGetMaterialId(const ufbx_mesh* mesh, size_t slot) {
+    // typed_id различает материалы с одинаковыми именами, поиск по имени сливал их
+    const ufbx_material* material = slot < mesh->materials.count ? mesh->materials[slot] : nullptr;
+    return material ? MaterialId{material->typed_id} : noMaterialId;
+}
+
+std::vector<rendr::Mesh<VertexPTN>> ufbxLoadMeshesPartsSepByMaterial(ufbx_scene* scene, rendr::JobSystem* jobs) {
+
+    struct PartToConvert{
+        ufbx_mesh* mesh;
+        ufbx_mesh_part* part;
+        ufbx_matrix transform;
+        MaterialId materialId;
+    };
 
-    std::vector<std::pair<rendr::Mesh<VertexPTN>, uint32_t>> meshesParts;
+    // Сбор частей в порядке сцены, конвертация идет параллельно по этому списку
+    std::vector<PartToConvert> partsToConvert;
     for (size_t i = 0; i < scene->nodes.count; i++) {
         ufbx_node* node = scene->nodes.data[i];
 
@@ -886,93 +1295,62 @@ std::vector<std::pair<rendr::Mesh<VertexPTN>, uint32_t>> ufbxLoadMeshesPartsSepB
                 
                 if(part->num_faces == 0) continue;   
 
-                uint32_t sceneMatIndex;
-                uint32_t partFaceIndex = part->face_indices[0];
-                uint32_t matInMeshIndex = mesh->face_material[partFaceIndex];
-                
-                for(size_t k = 0; k < scene->materials.count; k++){
-                    if(!strcmp(mesh->materials[matInMeshIndex]->name.data, scene->materials[k]->name.data)){
-                        sceneMatIndex = k;
-                    }
-                }                                     
-                meshesParts.push_back({convertUfbxMeshPart(mesh, part, &meshTransform), sceneMatIndex});
+                // material_parts[j] содержит грани слота материала j
+                partsToConvert.push_back({mesh, part, meshTransform, ufbxGetMaterialId(mesh, j)});
             }
         }
     } 
 
+    std::vector<rendr::Mesh<VertexPTN>> meshesParts(partsToConvert.size());
+    auto convertPart = [&](size_t i) {
+        PartToConvert& toConvert = partsToConvert[i];
+        meshesParts[i] = convertUfbxMeshPart(toConvert.mesh, toConvert.part, &toConvert.transform);
+        meshesParts[i].materialId = toConvert.materialId;
+    };
+
+    if (jobs) {
+        jobs->parallelFor(partsToConvert.size(), convertPart);
+    } else {
+        for (size_t i = 0; i < partsToConvert.size(); i++) {
+            convertPart(i);
+        }
+    }
+
     return meshesParts;
 }
 
-void writeCopyBufferCommand(const vk::raii::CommandBuffer& singleTimeCommandBuffer, const vk::raii::Buffer& srcBuffer, const vk::raii::Buffer& dstBuffer, vk::DeviceSize size) {
-    std::vector<vk::BufferCopy> copyRegions = {vk::BufferCopy(0,0,size)};
-    singleTimeCommandBuffer.copyBuffer(*srcBuffer, *dstBuffer, copyRegions);
+void writeCopyBufferCommand(const vk::raii::CommandBuffer& commandBuffer, const vk::raii::Buffer& srcBuffer, const vk::raii::Buffer& dstBuffer, vk::DeviceSize size, vk::DeviceSize srcOffset) {
+    std::vector<vk::BufferCopy> copyRegions = {vk::BufferCopy(srcOffset,0,size)};
+    commandBuffer.copyBuffer(*srcBuffer, *dstBuffer, copyRegions);
 }
 
-rendr::Buffer createIndexBuffer(const vk::raii::PhysicalDevice &physicalDevice, 
+rendr::Buffer createIndexBuffer(const rendr::Allocator &allocator, 
     const vk::raii::Device &device,
-    const vk::raii::CommandPool& commandPool,
-    const vk::raii::Queue& graphicsQueue,
-    const std::vector<uint32_t>& indices){
-
-    vk::DeviceSize bufferSize = sizeof(indices[0]) * indices.size();
-
-    rendr::Buffer stagingBuffer = createBuffer(physicalDevice, device, bufferSize, vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eVertexBuffer, 
-        vk::MemoryPropertyFlagBits::eHostVisible |  vk::MemoryPropertyFlagBits::eHostCoherent
-    );
+    rendr::UploadContext& uploadContext,
+    const std::vector<uint32_t>& indices) {
 
-    void* data = stagingBuffer.bufferMemory.mapMemory(0, bufferSize);
-        memcpy(data, indices.data(), (size_t) bufferSize);
-    stagingBuffer.bufferMemory.unmapMemory();
-
-    rendr::Buffer indexBuffer = createBuffer(physicalDevice, device, bufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer, 
-        vk::MemoryPropertyFlagBits::eDeviceLocal
-    );
-
-    vk::raii::CommandBuffer singleTimeCommandBuffer = rendr::beginSingleTimeCommands(device, commandPool);
-        writeCopyBufferCommand(singleTimeCommandBuffer, stagingBuffer.buffer, indexBuffer.buffer, bufferSize);
-    rendr::endSingleTimeCommands(singleTimeCommandBuffer, graphicsQueue);
-    
-    return indexBuffer;
+    return createIndexBuffer(allocator, device, uploadContext, indices.data(), indices.size());
 }
 
-//TODO отвязаться от конкретного типа юниформ буфера (сделать функцию шаблонной?)
-std::vector<rendr::Buffer> createAndMapUniformBuffers(const vk::raii::PhysicalDevice &physicalDevice, const vk::raii::Device &device, 
-    std::vector<void*>& uniformBuffersMappedData, size_t numOfBuffers, MVPUniformBufferObject ubo) {
-    
-    vk::DeviceSize bufferSize = sizeof(ubo);
-    std::vector<rendr::Buffer> uniformBuffers;
-    uniformBuffers.reserve(numOfBuffers);
-    uniformBuffersMappedData.clear();
-    uniformBuffersMappedData.reserve(numOfBuffers);
-
-    for (size_t i = 0; i < numOfBuffers; i++) {
-        uniformBuffers.push_back(createBuffer(physicalDevice, device, bufferSize, vk::BufferUsageFlagBits::eUniformBuffer, 
-                                                vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent));
-        
-        uniformBuffersMappedData.push_back(uniformBuffers.back().bufferMemory.mapMemory(0, bufferSize));
-    }
-
-    return uniformBuffers;
-}
+rendr::Buffer createIndexBuffer(const rendr::Allocator &allocator, 
+    const vk::raii::Device &device,
+    rendr::UploadContext& uploadContext,
+    const uint32_t* indices,
+    size_t indexCount){
 
+    vk::DeviceSize bufferSize = sizeof(uint32_t) * indexCount;
 
-vk::raii::DescriptorPool createDescriptorPool(const vk::raii::Device& device, uint32_t maxFramesInFlight) {
-    std::array<vk::DescriptorPoolSize, 2> poolSizes = {
-        vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, maxFramesInFlight),
-        vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, maxFramesInFlight)
-    };
+    rendr::StagingSpan staging = uploadContext.stage(indices, bufferSize);
 
-    vk::DescriptorPoolCreateInfo poolInfo(
-        {vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet}, // flags
-        maxFramesInFlight, // maxSets
-        static_cast<uint32_t>(poolSizes.size()), // poolSizeCount
-        poolSizes.data() // pPoolSizes
+    rendr::Buffer indexBuffer = createBuffer(allocator, device, bufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer, 
+        vk::MemoryPropertyFlagBits::eDeviceLocal, uploadContext.getSharingFamilies()
     );
 
-    return vk::raii::DescriptorPool(device, poolInfo);
+    writeCopyBufferCommand(uploadContext.getCommandBuffer(), *staging.buffer, indexBuffer.buffer, bufferSize, staging.offset);
+    
+    return indexBuffer;
 }
 
-
 std::vector<vk::raii::CommandBuffer> createCommandBuffers(const vk::raii::Device& device, const vk::raii::CommandPool& commandPool, uint32_t framesInFlight) {
     std::vector<vk::raii::CommandBuffer> commandBuffers;
 
@@ -987,6 +1365,22 @@ std::vector<vk::raii::CommandBuffer> createCommandBuffers(const vk::raii::Device
     return commandBuffers;
 }
 
+std::vector<rendr::RecordingSlot> createRecordingSlots(const vk::raii::Device& device, uint32_t queueFamilyIndex, uint32_t slotCount, uint32_t framesInFlight) {
+    std::vector<rendr::RecordingSlot> slots(slotCount);
+    for (rendr::RecordingSlot& slot : slots) {
+        for (uint32_t i = 0; i < framesInFlight; i++) {
+            slot.commandPools.emplace_back(device, vk::CommandPoolCreateInfo(vk::CommandPoolCreateFlagBits::eTransient, queueFamilyIndex));
+            vk::CommandBufferAllocateInfo allocInfo(
+                *slot.commandPools.back(), // commandPool
+                vk::CommandBufferLevel::eSecondary, // level
+                1 // commandBufferCount
+            );
+            slot.commandBuffers.push_back(std::move(device.allocateCommandBuffers(allocInfo).front()));
+        }
+    }
+    return slots;
+}
+
 std::vector<rendr::PerFrameSync> createSyncObjects(const vk::raii::Device& device, uint32_t framesInFlight) {
     
     std::vector<rendr::PerFrameSync> syncObjects(framesInFlight);
@@ -1003,7 +1397,6 @@ std::vector<rendr::PerFrameSync> createSyncObjects(const vk::raii::Device& devic
 
     for (size_t i = 0; i < framesInFlight; i++) {
         syncObjects[i].imageAvailableSemaphore = vk::raii::Semaphore(device, semaphoreInfo);
-        syncObjects[i].renderFinishedSemaphore = vk::raii::Semaphore(device, semaphoreInfo);
         syncObjects[i].inFlightFence = vk::raii::Fence(device, fenceInfo);
     }
 
@@ -1012,31 +1405,32 @@ std::vector<rendr::PerFrameSync> createSyncObjects(const vk::raii::Device& devic
 
 
 RendererSetup::RendererSetup():
-descriptorSetLayout_(nullptr), 
-renderPass_(nullptr),
 pipelineLayout_(nullptr),
-graphicsPipeline_(nullptr),
-swapChainFramebuffers_(),
-descriptorPool_(nullptr)
+graphicsPipeline_(nullptr)
 {}
 
 
 SwapChain::SwapChain()
 : swapChain_(nullptr){}
 
-void SwapChain::create(const rendr::Device &renderDevice, const rendr::Window &win, const rendr::SwapChainConfig& config){
-    rendr::SwapChainData swapChainData = rendr::createSwapChain(renderDevice.physicalDevice_, renderDevice.surface_, renderDevice.device_, win, config);
+void SwapChain::create(const rendr::Device &renderDevice, const rendr::Window &win, const rendr::SwapChainConfig& config, vk::SwapchainKHR oldSwapChain){
+    rendr::SwapChainData swapChainData = rendr::createSwapChain(renderDevice.physicalDevice_, renderDevice.surface_, renderDevice.device_, win, config, oldSwapChain);
     swapChain_ = std::move(swapChainData.swapChain);
     swapChainExtent_ = std::move(swapChainData.swapChainExtent);
     swapChainImageFormat_ = std::move(swapChainData.swapChainImageFormat);
     swapChainImages_ = swapChain_.getImages();
     swapChainImageViews_ = rendr::createImageViews(swapChainImages_, renderDevice.device_, swapChainImageFormat_, vk::ImageAspectFlagBits::eColor);
+    presentSemaphores_.clear();
+    for (size_t i = 0; i < swapChainImages_.size(); i++) {
+        presentSemaphores_.emplace_back(renderDevice.device_, vk::SemaphoreCreateInfo());
+    }
 }
 
 void SwapChain::clear(){
     for (auto& imageView : swapChainImageViews_) {
         imageView.clear();
     }
+    presentSemaphores_.clear();
     swapChain_.clear();
 }
 
@@ -1048,7 +1442,9 @@ physicalDevice_(nullptr),
 device_(nullptr),
 graphicsQueue_(nullptr),
 presentQueue_(nullptr),
-commandPool_(nullptr)
+transferQueue_(nullptr),
+commandPool_(nullptr),
+allocator_(nullptr)
 {}
 
 void Device::create(DeviceConfig config, const rendr::Window& win){
@@ -1057,9 +1453,36 @@ void Device::create(DeviceConfig config, const rendr::Window& win){
     physicalDevice_ = pickPhysicalDevice(*instance_, surface_, config);
     rendr::DeviceWithGraphicsAndPresentQueues deviceAndQueues = rendr::createDeviceWithGraphicsAndPresentQueues(physicalDevice_, surface_, config);
     device_ = std::move(deviceAndQueues.device);
+    pipelineCache_.create(physicalDevice_, device_, config.pipelineCachePath);
+    samplerCache_.create(device_);
+    graphicsQueue_ = std::move(deviceAndQueues.graphicsQueue);
+    presentQueue_ = std::move(deviceAndQueues.presentQueue);
+    transferQueue_ = std::move(deviceAndQueues.transferQueue);
+    enabledFeatures_ = deviceAndQueues.enabledFeatures;
+    enabledVulkan12Features_ = deviceAndQueues.enabledVulkan12Features;
+    limits_ = physicalDevice_.getProperties().limits;
+    queueFamilyIndices_ = rendr::findQueueFamilies(*physicalDevice_, *surface_);
+    commandPool_ =  rendr::createGraphicsCommandPool(device_, queueFamilyIndices_);
+    allocator_ = rendr::Allocator(*instance_, physicalDevice_, device_, AppInfo::apiVersion);
+}
+
+void Device::createHeadless(DeviceConfig config){
+    instance_ = rendr::Instance(std::vector<const char*>{});
+    surface_ = vk::raii::SurfaceKHR(nullptr);
+    physicalDevice_ = pickPhysicalDevice(*instance_, surface_, config);
+    rendr::DeviceWithGraphicsAndPresentQueues deviceAndQueues = rendr::createDeviceWithGraphicsAndPresentQueues(physicalDevice_, surface_, config);
+    device_ = std::move(deviceAndQueues.device);
+    pipelineCache_.create(physicalDevice_, device_, config.pipelineCachePath);
+    samplerCache_.create(device_);
     graphicsQueue_ = std::move(deviceAndQueues.graphicsQueue);
     presentQueue_ = std::move(deviceAndQueues.presentQueue);
-    commandPool_ =  rendr::createGraphicsCommandPool(device_, rendr::findQueueFamilies(*physicalDevice_, *surface_));
+    transferQueue_ = std::move(deviceAndQueues.transferQueue);
+    enabledFeatures_ = deviceAndQueues.enabledFeatures;
+    enabledVulkan12Features_ = deviceAndQueues.enabledVulkan12Features;
+    limits_ = physicalDevice_.getProperties().limits;
+    queueFamilyIndices_ = rendr::findQueueFamilies(*physicalDevice_, nullptr);
+    commandPool_ =  rendr::createGraphicsCommandPool(device_, queueFamilyIndices_);
+    allocator_ = rendr::Allocator(*instance_, physicalDevice_, device_, AppInfo::apiVersion);
 }
 
 
@@ -1117,7 +1540,9 @@ void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& create
 
 Instance::Instance() : context_(), instance_(nullptr), debugUtilsMessenger_(nullptr) {}
 
-Instance::Instance(Window const &window) : context_(), instance_(nullptr), debugUtilsMessenger_(nullptr)
+Instance::Instance(Window const &window) : Instance(window.getRequiredExtensions()) {}
+
+Instance::Instance(const std::vector<const char*>& requiredExtensions) : context_(), instance_(nullptr), debugUtilsMessenger_(nullptr)
 {
     if (DebugConfig::enableValidationLayers && !checkValidationLayerSupport())
     {
@@ -1147,7 +1572,7 @@ Instance::Instance(Window const &window) : context_(), instance_(nullptr), debug
         instanceCreateInfo.pNext = nullptr;
     }
 
-    std::vector<const char *> extensions = window.getRequiredExtensions();
+    std::vector<const char *> extensions = requiredExtensions;
 
     if (DebugConfig::enableValidationLayers)
     {
@@ -1185,39 +1610,113 @@ vk::raii::Instance const &Instance::operator*() const{
 }
 
 
-void Renderer::cleanupSwapChain(){
-    for(auto& setup : rendrSetups_){
-        setup.second.swapChainFramebuffers_.clear();
+bool Renderer::areFramesComplete(uint64_t frameNumber) const{
+    for (uint64_t slotFrameNumber : slotFrameNumbers_) {
+        if (slotFrameNumber < frameNumber && !isFrameComplete(slotFrameNumber)) {
+            return false;
+        }
     }
+    return true;
+}
 
-    depthImage_.imageView.clear();
-    depthImage_.image.clear();
-    depthImage_.imageMemory.clear();
-    swapChain_.clear();
+void Renderer::collectRetired(){
+    deletionQueue_.collect([this](uint64_t frameNumber, rendr::UploadTicket uploadTicket){
+        return areFramesComplete(frameNumber) && uploadContext_.isComplete(uploadTicket);
+    });
 }
 
 void Renderer::updateUniformBuffer(rendr::MVPUniformBufferObject ubo){
-    memcpy(uniformBuffersMapped_[currentFrame_], &ubo, sizeof(ubo));
+    frameUbo_ = ubo;
 }
 
 Renderer::Renderer()
-: descriptorSetLayout_(nullptr), descriptorPool_(nullptr){}
+: renderPass_(nullptr), descriptorSetLayout_(nullptr){}
+
+Renderer::~Renderer(){
+    //the jobs write into the setups owned by pendingSetups_
+    for (auto& pending : pendingSetups_) {
+        try {
+            jobSystem_->wait(*pending.second.counter);
+        } catch (const std::exception& e) {
+            std::cerr << "material compile failed: " << e.what() << std::endl;
+        }
+    }
+}
+
+void Renderer::writeFrameUbo(){
+    if (frameUboSpans_[currentFrame_] != 0) {
+        stagingRing_.release(frameUboSpans_[currentFrame_]);
+    }
+    vk::DeviceSize uboAlignment = device_.limits_.minUniformBufferOffsetAlignment;
+    std::optional<rendr::StagingSpan> uboSpan = stagingRing_.allocate(sizeof(frameUbo_), uboAlignment);
+    if (!uboSpan) {
+        //ring is held by uploads, let them finish
+        uploadContext_.waitIdle();
+        uboSpan = stagingRing_.allocate(sizeof(frameUbo_), uboAlignment);
+    }
+    if (!uboSpan) {
+        throw std::runtime_error("staging ring is exhausted!");
+    }
+    memcpy(uboSpan->mappedData, &frameUbo_, sizeof(frameUbo_));
+    frameUboSpans_[currentFrame_] = uboSpan->id;
+    frameUboOffset_ = static_cast<uint32_t>(uboSpan->offset);
+}
 
 void Renderer::drawFrame()
 {
-    vk::Result waitFanceRes = device_.device_.waitForFences({*framesSyncObjs_[currentFrame_].inFlightFence}, VK_TRUE, UINT64_MAX);
+    if (headless_) {
+        drawFrameHeadless();
+        return;
+    }
 
-    std::pair<vk::Result, uint32_t> imageAcqRes = swapChain_.swapChain_.acquireNextImage(UINT64_MAX, 
-        *framesSyncObjs_[currentFrame_].imageAvailableSemaphore, nullptr);
+    uploadContext_.submit();
+    uploadContext_.collect();
 
-    uint32_t imageIndex = imageAcqRes.second;
+    vk::Fence frameFence = *framesSyncObjs_[currentFrame_].inFlightFence;
+    pacingStats_.frameFenceWaitMs = waitForFence(frameFence);
+    pacingStats_.imageFenceWaitMs = 0.0f;
+    collectRetired();
+    collectCompiledMaterials();
+    descriptorAllocator_.resetFrame(static_cast<uint32_t>(currentFrame_));
+    //may throw on too many draws, nothing is acquired or reset yet so the next frame can retry
+    prepareDrawList();
 
-    device_.device_.resetFences({*framesSyncObjs_[currentFrame_].inFlightFence});
+    if (swapChainDirty_) {
+        recreateSwapChain(*window_);
+    }
+
+    uint32_t imageIndex = 0;
+    try {
+        std::pair<vk::Result, uint32_t> imageAcqRes = swapChain_.swapChain_.acquireNextImage(UINT64_MAX,
+            *framesSyncObjs_[currentFrame_].imageAvailableSemaphore, nullptr);
+        imageIndex = imageAcqRes.second;
+        //still presentable, rendered this frame and recreated after the present
+        if (imageAcqRes.first == vk::Result::eSuboptimalKHR) {
+            swapChainDirty_ = true;
+        }
+    } catch (const vk::OutOfDateKHRError&) {
+        //nothing was submitted, the frame fence stays signaled for the retry
+        recreateSwapChain(*window_);
+        return;
+    }
+
+    //an earlier frame slot may still be rendering into this image
+    if (imagesInFlight_[imageIndex] && imagesInFlight_[imageIndex] != frameFence) {
+        pacingStats_.imageFenceWaitMs = waitForFence(imagesInFlight_[imageIndex]);
+    }
+    imagesInFlight_[imageIndex] = frameFence;
+    float waitMs = pacingStats_.frameFenceWaitMs + pacingStats_.imageFenceWaitMs;
+    pacingStats_.averageWaitMs += (waitMs - pacingStats_.averageWaitMs) * 0.05f;
+
+    writeFrameUbo();
+
+    device_.device_.resetFences({frameFence});
 
     commandBuffers_[currentFrame_].reset();
     recordCommandBuffer(imageIndex);
 
     vk::PipelineStageFlags waitStages = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+    vk::Semaphore presentSemaphore = *swapChain_.presentSemaphores_[imageIndex];
 
     vk::SubmitInfo submitInfo(
         1, // waitSemaphoreCount
@@ -1226,24 +1725,116 @@ void Renderer::drawFrame()
         1, // commandBufferCount
         &(*commandBuffers_[currentFrame_]), // pCommandBuffers
         1, // signalSemaphoreCount
-        &(*framesSyncObjs_[currentFrame_].renderFinishedSemaphore) // pSignalSemaphores
+        &presentSemaphore // pSignalSemaphores
     );
 
-    device_.graphicsQueue_.submit({submitInfo}, *framesSyncObjs_[currentFrame_].inFlightFence);
+    device_.graphicsQueue_.submit({submitInfo}, frameFence);
+    slotFrameNumbers_[currentFrame_] = frameNumber_;
+    frameNumber_++;
 
     vk::PresentInfoKHR presentInfo(
         1, // waitSemaphoreCount
-        &(*framesSyncObjs_[currentFrame_].renderFinishedSemaphore), // pWaitSemaphores
+        &presentSemaphore, // pWaitSemaphores
         1, // swapchainCount
         &(*swapChain_.swapChain_), // pSwapchains
         &imageIndex // pImageIndices
     );
-    
-    vk::Result presenrRes = device_.presentQueue_.presentKHR(presentInfo);
 
+    try {
+        if (device_.presentQueue_.presentKHR(presentInfo) == vk::Result::eSuboptimalKHR) {
+            swapChainDirty_ = true;
+        }
+    } catch (const vk::OutOfDateKHRError&) {
+        swapChainDirty_ = true;
+    }
+
+    currentFrame_ = (currentFrame_ + 1) % framesInFlight_;
+}
+
+float Renderer::waitForFence(vk::Fence fence){
+    auto start = std::chrono::steady_clock::now();
+    vk::Result waitFanceRes = device_.device_.waitForFences({fence}, VK_TRUE, UINT64_MAX);
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Renderer::waitForFrames(){
+    std::vector<vk::Fence> fences;
+    for (const auto& sync : framesSyncObjs_) {
+        fences.push_back(*sync.inFlightFence);
+    }
+    vk::Result waitFanceRes = device_.device_.waitForFences(fences, VK_TRUE, UINT64_MAX);
+}
+
+bool Renderer::isFrameComplete(uint64_t frameNumber) const{
+    uint32_t slot = static_cast<uint32_t>(frameNumber % framesInFlight_);
+    //slot fence was waited on before the slot got reused
+    if (slotFrameNumbers_[slot] != frameNumber) {
+        return true;
+    }
+    return framesSyncObjs_[slot].inFlightFence.getStatus() == vk::Result::eSuccess;
+}
+
+void Renderer::drawFrameHeadless()
+{
+    uploadContext_.submit();
+    uploadContext_.collect();
+
+    pacingStats_.frameFenceWaitMs = waitForFence(*framesSyncObjs_[currentFrame_].inFlightFence);
+    pacingStats_.averageWaitMs += (pacingStats_.frameFenceWaitMs - pacingStats_.averageWaitMs) * 0.05f;
+    collectRetired();
+    collectCompiledMaterials();
+    descriptorAllocator_.resetFrame(static_cast<uint32_t>(currentFrame_));
+    //before the fence reset, a throw leaves the fence signaled
+    prepareDrawList();
+
+    auto isComplete = [this](uint64_t frameNumber){ return isFrameComplete(frameNumber); };
+    readbackPool_.collect(isComplete, readbackCallback_);
+
+    writeFrameUbo();
+
+    std::optional<uint32_t> readbackSlot = readbackPool_.acquire(frameNumber_);
+    while (!readbackSlot) {
+        //every buffer holds a frame still in flight, wait for the oldest one
+        uint32_t oldestSlot = static_cast<uint32_t>(*readbackPool_.getOldestPending() % framesInFlight_);
+        vk::Result waitOldestRes = device_.device_.waitForFences({*framesSyncObjs_[oldestSlot].inFlightFence}, VK_TRUE, UINT64_MAX);
+        readbackPool_.collect(isComplete, readbackCallback_);
+        readbackSlot = readbackPool_.acquire(frameNumber_);
+    }
+
+    device_.device_.resetFences({*framesSyncObjs_[currentFrame_].inFlightFence});
+
+    commandBuffers_[currentFrame_].reset();
+    recordCommandBuffer(currentFrame_, readbackSlot);
+
+    vk::SubmitInfo submitInfo(
+        0, // waitSemaphoreCount
+        nullptr, // pWaitSemaphores
+        nullptr, // pWaitDstStageMask
+        1, // commandBufferCount
+        &(*commandBuffers_[currentFrame_]), // pCommandBuffers
+        0, // signalSemaphoreCount
+        nullptr // pSignalSemaphores
+    );
+
+    device_.graphicsQueue_.submit({submitInfo}, *framesSyncObjs_[currentFrame_].inFlightFence);
+    slotFrameNumbers_[currentFrame_] = frameNumber_;
+
+    frameNumber_++;
     currentFrame_ = (currentFrame_ + 1) % framesInFlight_;
 }
 
+void Renderer::setReadbackCallback(std::function<void(const rendr::ReadbackFrame&)> callback){
+    readbackCallback_ = std::move(callback);
+}
+
+void Renderer::flushReadbacks(){
+    if (!headless_) {
+        return;
+    }
+    waitForFrames();
+    readbackPool_.collect([this](uint64_t frameNumber){ return isFrameComplete(frameNumber); }, readbackCallback_);
+}
+
 void Renderer::setDrawableObjects(std::vector<IDrawableObj*> objs){
     for(auto& objs : setupIndexToDrawableObjs){
         objs.second.clear();
@@ -1255,12 +1846,67 @@ void Renderer::setDrawableObjects(std::vector<IDrawableObj*> objs){
     }
 }
 
+rendr::RendererSetupContext Renderer::getSetupContext() const{
+    rendr::RendererSetupContext context;
+    context.device = &device_;
+    context.renderPass = *renderPass_;
+    context.renderExtent = getRenderExtent();
+    context.frameSetLayout = *descriptorSetLayout_;
+    context.textureTableLayout = *textureTable_.getLayout();
+    context.framesInFlight = framesInFlight_;
+    context.shaderDirectory = shaderDirectory_;
+    return context;
+}
+
 void Renderer::initMaterial(Material& material){
     material.renderSetupIndex = matIndCount_;
-    rendrSetups_[matIndCount_] = material.createRendererSetup(*this, descriptorSetLayout_, framesInFlight_);
+    rendrSetups_[matIndCount_] = material.createRendererSetup(getSetupContext());
     matIndCount_++;
 }
 
+rendr::MaterialHandle Renderer::initMaterialAsync(Material& material){
+    material.renderSetupIndex = matIndCount_;
+    PendingSetup& pending = pendingSetups_[matIndCount_];
+    pending.counter = std::make_unique<rendr::JobCounter>();
+    pending.setup = std::make_unique<rendr::RendererSetup>();
+    //the job gets a copy of the context and never touches the renderer, the device handles creation from several threads
+    rendr::RendererSetup* setup = pending.setup.get();
+    jobSystem_->run([context = getSetupContext(), &material, setup]{
+        *setup = material.createRendererSetup(context);
+    }, pending.counter.get());
+    return rendr::MaterialHandle{matIndCount_++};
+}
+
+bool Renderer::isMaterialReady(rendr::MaterialHandle handle) const{
+    return rendrSetups_.count(handle.setupIndex) != 0;
+}
+
+void Renderer::waitForMaterial(rendr::MaterialHandle handle){
+    auto pending = pendingSetups_.find(handle.setupIndex);
+    if (pending != pendingSetups_.end()) {
+        finishMaterial(pending);
+    }
+}
+
+void Renderer::finishMaterial(std::map<int, PendingSetup>::iterator pending){
+    //erased first, a failed compile is reported once
+    int setupIndex = pending->first;
+    PendingSetup finished = std::move(pending->second);
+    pendingSetups_.erase(pending);
+    jobSystem_->wait(*finished.counter);
+    rendrSetups_[setupIndex] = std::move(*finished.setup);
+}
+
+void Renderer::collectCompiledMaterials(){
+    for (auto pending = pendingSetups_.begin(); pending != pendingSetups_.end();) {
+        auto next = std::next(pending);
+        if (pending->second.counter->isDone()) {
+            finishMaterial(pending);
+        }
+        pending = next;
+    }
+}
+
 void Renderer::recreateSwapChain(const rendr::Window& window){
     auto size = window.getFramebufferSize();
     int width = size.first;
@@ -1271,66 +1917,352 @@ void Renderer::recreateSwapChain(const rendr::Window& window){
         height = size.second;
         window.waitEvents();
     }
-    device_.device_.waitIdle();
-    cleanupSwapChain();
-    swapChain_.create(device_, window, swapChainConfig_);
+    //frames in flight keep the old swapchain and its attachments alive until their fences signal
+    rendr::SwapChain oldSwapChain = std::move(swapChain_);
+    swapChain_ = rendr::SwapChain();
+    swapChain_.create(device_, window, swapChainConfig_, *oldSwapChain.swapChain_);
+    retire(std::move(framebuffers_));
+    retire(std::move(oldSwapChain));
+    framebuffers_.clear();
+
+    //a larger depth attachment serves a smaller framebuffer, shrinking keeps it
+    vk::Extent2D extent = swapChain_.swapChainExtent_;
+    if (extent.width > depthExtent_.width || extent.height > depthExtent_.height) {
+        retire(std::move(depthImage_));
+        createDepthAttachment(extent);
+    }
 
-    depthImage_ = rendr::createDepthImage(device_.physicalDevice_, device_.device_, swapChain_.swapChainExtent_.width, swapChain_.swapChainExtent_.height);
+    //format doesn't change across recreation, the pass and the pipelines built against it stay valid
+    createFramebuffers();
+    retire(cullingPass_.setDepthImage(device_, depthImage_, rendr::findDepthFormat(device_.physicalDevice_), getRenderExtent()));
+    imagesInFlight_.assign(swapChain_.swapChainImages_.size(), nullptr);
+    swapChainDirty_ = false;
+    pacingStats_.swapChainRecreations++;
+}
 
-    for(auto& setup : rendrSetups_){
-        setup.second.swapChainFramebuffersRecreationFunc_(*this, setup.second);
+void Renderer::initCulling(const RendererConfig& config){
+    shaderDirectory_ = config.shaderDirectory;
+    cullingMode_ = config.cullingMode;
+    bool indirectDraws = device_.enabledFeatures_.multiDrawIndirect && device_.enabledFeatures_.drawIndirectFirstInstance;
+    if (cullingMode_ == rendr::CullingMode::eGpu && !indirectDraws) {
+        cullingMode_ = rendr::CullingMode::eCpu;
     }
+    vk::FormatProperties depthProperties = device_.physicalDevice_.getFormatProperties(rendr::findDepthFormat(device_.physicalDevice_));
+    occlusionCulling_ = cullingMode_ != rendr::CullingMode::eNone && config.occlusionCulling
+        && (depthProperties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImage);
+}
+
+void Renderer::createDepthAttachment(vk::Extent2D extent){
+    vk::ImageUsageFlags extraUsage = occlusionCulling_ ? vk::ImageUsageFlags(vk::ImageUsageFlagBits::eSampled) : vk::ImageUsageFlags();
+    depthImage_ = rendr::createDepthImage(device_.physicalDevice_, device_.allocator_, device_.device_, extent.width, extent.height, extraUsage);
+    depthExtent_ = extent;
+}
+
+void Renderer::createFramebuffers(){
+    vk::Extent2D extent = getRenderExtent();
+    framebuffers_ = rendr::createSwapChainFramebuffersWithDepthAtt(device_.device_, renderPass_, getColorImageViews(), depthImage_.imageView, extent.width, extent.height);
 }
 
 void Renderer::waitIdle(){
+    //compile jobs write into pendingSetups_, they must finish before anything they touch is torn down
+    while (!pendingSetups_.empty()) {
+        finishMaterial(pendingSetups_.begin());
+    }
+    uploadContext_.waitIdle();
     device_.device_.waitIdle();
+    deletionQueue_.flush();
 }
 
 float Renderer::getSwapChainAspect(){
-    return swapChain_.swapChainExtent_.width / (float) swapChain_.swapChainExtent_.height;
+    vk::Extent2D extent = getRenderExtent();
+    return extent.width / (float) extent.height;
+}
+
+vk::Format Renderer::getColorFormat() const{
+    return headless_ ? offscreenFormat_ : swapChain_.swapChainImageFormat_;
+}
+
+vk::Extent2D Renderer::getRenderExtent() const{
+    return headless_ ? offscreenExtent_ : swapChain_.swapChainExtent_;
+}
+
+std::vector<vk::ImageView> Renderer::getColorImageViews() const{
+    std::vector<vk::ImageView> views;
+    if (headless_) {
+        for (const auto& image : offscreenImages_) {
+            views.push_back(*image.imageView);
+        }
+    } else {
+        for (const auto& imageView : swapChain_.swapChainImageViews_) {
+            views.push_back(*imageView);
+        }
+    }
+    return views;
+}
+
+vk::ImageLayout Renderer::getColorFinalLayout() const{
+    return headless_ ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::ePresentSrcKHR;
 }
 
 void Renderer::init(const RendererConfig& config, rendr::Window& window){
     framesInFlight_ = config.framesInFlight;
     device_.create(config.deviceConfig, window);
+    initCulling(config);
     swapChain_.create(device_, window, config.swapChainConfig);
     swapChainConfig_ = config.swapChainConfig;
-    depthImage_ = rendr::createDepthImage(device_.physicalDevice_, device_.device_, swapChain_.swapChainExtent_.width, swapChain_.swapChainExtent_.height);
-    uniformBuffers_ = rendr::createAndMapUniformBuffers(device_.physicalDevice_, device_.device_, uniformBuffersMapped_, framesInFlight_, rendr::MVPUniformBufferObject());
+    createDepthAttachment(swapChain_.swapChainExtent_);
+
+    initFrameResources(config);
+    imagesInFlight_.assign(swapChain_.swapChainImages_.size(), nullptr);
+    window_ = &window;
+    
+    //recreated by the next drawFrame, not from inside pollEvents
+    window.callbacks.winResized = [this](int,int){
+        swapChainDirty_ = true;
+    };
+}
+
+void Renderer::initHeadless(const RendererConfig& config){
+    headless_ = true;
+    framesInFlight_ = config.framesInFlight;
+    device_.createHeadless(config.deviceConfig);
+    initCulling(config);
+
+    //readback rows are packed as 4 bytes per pixel
+    switch (config.offscreenFormat) {
+        case vk::Format::eR8G8B8A8Srgb:
+        case vk::Format::eR8G8B8A8Unorm:
+        case vk::Format::eB8G8R8A8Srgb:
+        case vk::Format::eB8G8R8A8Unorm:
+            break;
+        default:
+            throw std::runtime_error("unsupported offscreen format!");
+    }
+    offscreenFormat_ = rendr::findSupportedFormat(device_.physicalDevice_, {config.offscreenFormat}, vk::ImageTiling::eOptimal,
+        vk::FormatFeatureFlagBits::eColorAttachment | vk::FormatFeatureFlagBits::eTransferSrc);
+    offscreenExtent_ = config.offscreenExtent;
+
+    offscreenImages_.clear();
+    for (int i = 0; i < framesInFlight_; i++) {
+        offscreenImages_.push_back(rendr::createOffscreenColorImage(device_.allocator_, device_.device_, offscreenFormat_, offscreenExtent_.width, offscreenExtent_.height));
+    }
+    createDepthAttachment(offscreenExtent_);
+
+    readbackPool_.create(device_.allocator_, device_.device_, config.readbackBufferCount, offscreenExtent_, offscreenFormat_, 4);
+
+    initFrameResources(config);
+}
+
+void Renderer::initFrameResources(const RendererConfig& config){
+    vk::Format depthFormat = rendr::findDepthFormat(device_.physicalDevice_);
+    renderPass_ = rendr::createRenderPassWithColorAndDepthAttOneSubpass(device_.device_, getColorFormat(), depthFormat, getColorFinalLayout(), occlusionCulling_);
+    createFramebuffers();
+
+    uint32_t graphicsFamily = device_.queueFamilyIndices_.graphicsFamily.value();
+    uint32_t uploadFamily = device_.queueFamilyIndices_.transferFamily.value_or(graphicsFamily);
+    std::vector<uint32_t> uploadSharingFamilies;
+    if (uploadFamily != graphicsFamily) {
+        uploadSharingFamilies = {graphicsFamily, uploadFamily};
+    }
+    stagingRing_.create(device_.allocator_, device_.device_, config.stagingRingSize, vk::BufferUsageFlagBits::eUniformBuffer, uploadSharingFamilies);
+    uploadContext_.create(device_.device_, device_.allocator_, stagingRing_, uploadFamily, device_.transferQueue_, uploadFamily == graphicsFamily, uploadSharingFamilies);
+    frameUboSpans_.assign(framesInFlight_, 0);
+    //both paths number their frames, retired resources wait on these
+    slotFrameNumbers_.assign(framesInFlight_, 0);
+    frameNumber_ = 0;
+
+    //every material draws VertexPTN
+    geometryPool_.create(device_.allocator_, device_.device_, sizeof(rendr::VertexPTN), config.geometryPoolVertices, config.geometryPoolIndices, uploadSharingFamilies);
+    //only reachable when a DeviceConfig dropped them from requiredVulkan12Features
+    if (!rendr::TextureTable::isSupported(device_.enabledVulkan12Features_)) {
+        throw std::runtime_error("device does not support the descriptor indexing features of the texture table!");
+    }
+    textureTable_.create(device_.physicalDevice_, device_.device_, config.textureTableCapacity);
+    maxDrawsPerFrame_ = config.maxDrawsPerFrame;
+    indirectBuffers_.clear();
+    drawDataBuffers_.clear();
+    for (int i = 0; i < framesInFlight_; i++) {
+        //read by the cull pass as a storage buffer when culling runs on the GPU
+        indirectBuffers_.push_back(rendr::createBuffer(device_.allocator_, device_.device_, sizeof(vk::DrawIndexedIndirectCommand) * maxDrawsPerFrame_,
+            vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent));
+        drawDataBuffers_.push_back(rendr::createBuffer(device_.allocator_, device_.device_, sizeof(rendr::DrawData) * maxDrawsPerFrame_,
+            vk::BufferUsageFlagBits::eStorageBuffer, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent));
+    }
+    cullingPass_.create(device_, cullingMode_, occlusionCulling_, framesInFlight_, maxDrawsPerFrame_, shaderDirectory_, drawDataBuffers_, indirectBuffers_);
+    cullingPass_.setDepthImage(device_, depthImage_, depthFormat, getRenderExtent());
+
     commandBuffers_ = rendr::createCommandBuffers(device_.device_, device_.commandPool_, framesInFlight_);
     framesSyncObjs_ = rendr::createSyncObjects(device_.device_, framesInFlight_);
 
-    descriptorSetLayout_ = rendr::createUboDescriptorSetLayout(device_.device_);
-    descriptorPool_ = rendr::createDescriptorPool(device_.device_, framesInFlight_);
-    descriptorSets_ = rendr::createDescriptorSets(device_.device_, descriptorPool_, descriptorSetLayout_, framesInFlight_);
+    jobSystem_ = config.jobSystem;
+    if (!jobSystem_) {
+        ownJobSystem_ = std::make_unique<rendr::JobSystem>(config.recordingThreads);
+        jobSystem_ = ownJobSystem_.get();
+    }
+    //one job per thread, the calling thread included
+    uint32_t recordingJobs = static_cast<uint32_t>(jobSystem_->getThreadCount()) + 1;
+    recordingSlots_ = rendr::createRecordingSlots(device_.device_, graphicsFamily, recordingJobs, framesInFlight_);
+    parallelRecordingMinDraws_ = config.parallelRecordingMinDraws;
+
+    descriptorSetLayout_ = rendr::createFrameDescriptorSetLayout(device_.device_);
+    descriptorSets_.clear();
+    descriptorAllocator_.create(device_.device_, config.descriptorSetsPerPool, {
+        {vk::DescriptorType::eUniformBuffer, 1.0f},
+        {vk::DescriptorType::eUniformBufferDynamic, 1.0f},
+        {vk::DescriptorType::eStorageBuffer, 2.0f},
+        {vk::DescriptorType::eCombinedImageSampler, 2.0f},
+        {vk::DescriptorType::eStorageImage, 1.0f}
+    }, static_cast<uint32_t>(framesInFlight_));
+    descriptorSets_ = descriptorAllocator_.allocate(*descriptorSetLayout_, static_cast<uint32_t>(framesInFlight_));
 
     for(int i = 0; i < framesInFlight_; i++){
         vk::DescriptorBufferInfo bufferInfo(
-            *uniformBuffers_[i].buffer, // buffer
+            *stagingRing_.getBuffer(), // buffer
             0, // offset
             sizeof(rendr::MVPUniformBufferObject) // range
         );
 
-        std::array<vk::WriteDescriptorSet, 1> descriptorWrites = {
+        vk::DescriptorBufferInfo drawDataInfo(
+            *drawDataBuffers_[i].buffer, // buffer
+            0, // offset
+            VK_WHOLE_SIZE // range
+        );
+
+        std::array<vk::WriteDescriptorSet, 2> descriptorWrites = {
             vk::WriteDescriptorSet(
                 *descriptorSets_[i], // dstSet
                 0, // dstBinding
                 0, // dstArrayElement
                 1, // descriptorCount
-                vk::DescriptorType::eUniformBuffer, // descriptorType
+                vk::DescriptorType::eUniformBufferDynamic, // descriptorType
                 nullptr, // pImageInfo  
                 &bufferInfo, // pBufferInfo
                 nullptr // pTexelBufferView
+            ),
+            vk::WriteDescriptorSet(
+                *descriptorSets_[i], // dstSet
+                1, // dstBinding
+                0, // dstArrayElement
+                1, // descriptorCount
+                vk::DescriptorType::eStorageBuffer, // descriptorType
+                nullptr, // pImageInfo  
+                &drawDataInfo, // pBufferInfo
+                nullptr // pTexelBufferView
             )};
         device_.device_.updateDescriptorSets(descriptorWrites, nullptr);
     }
-    
-    window.callbacks.winResized = [this, &window](int,int){
-        this->recreateSwapChain(window);
-    };
 }
 
-void Renderer::recordCommandBuffer(uint32_t imageIndex){
+void Renderer::prepareDrawList(){
+    //draw bounds are in the space the frame UBO's model matrix is applied to
+    glm::mat4 viewProj = frameUbo_.proj * frameUbo_.view * frameUbo_.model;
+    drawList_.clear();
+    drawList_.setViewProj(viewProj);
+    for (auto& objs : setupIndexToDrawableObjs ) {
+        auto setupIt = rendrSetups_.find(objs.first);
+        if (setupIt == rendrSetups_.end()) {
+            //material still compiling
+            continue;
+        }
+        const rendr::RendererSetup& setup = setupIt->second;
+        for(auto& obj : objs.second){
+            if (!uploadContext_.isComplete(obj->uploadTicket)) {
+                continue;
+            }
+            obj->writeDrawPackets(drawList_, setup, currentFrame_);
+        }
+    }
+    drawList_.sort();
+
+    if (cullingMode_ != rendr::CullingMode::eNone) {
+        //the cull pass tests the frustum again, off screen draws just never get written for it
+        drawList_.cullFrustum(rendr::extractFrustumPlanes(viewProj));
+    }
+    if (cullingMode_ == rendr::CullingMode::eCpu) {
+        cullingPass_.cullOnHost(drawList_, currentFrame_);
+    }
+
+    rendr::IndirectDrawTarget& drawTarget = drawTarget_;
+    drawTarget.indirectBuffer = *indirectBuffers_[currentFrame_].buffer;
+    drawTarget.commands = static_cast<vk::DrawIndexedIndirectCommand*>(indirectBuffers_[currentFrame_].allocation.getMappedData());
+    drawTarget.drawData = static_cast<rendr::DrawData*>(drawDataBuffers_[currentFrame_].allocation.getMappedData());
+    drawTarget.capacity = maxDrawsPerFrame_;
+    drawTarget.multiDrawIndirect = device_.enabledFeatures_.multiDrawIndirect && device_.enabledFeatures_.drawIndirectFirstInstance;
+    drawTarget.maxDrawIndirectCount = drawTarget.multiDrawIndirect ? device_.limits_.maxDrawIndirectCount : 1;
+    drawList_.prepare(drawTarget);
+}
+
+void Renderer::recordFramePass(const vk::raii::CommandBuffer& commandBuffer, const vk::RenderPassBeginInfo& renderPassInfo,
+    const rendr::IndirectDrawTarget& drawTarget, const rendr::CulledDrawTarget* culledTarget){
+
+    vk::Extent2D extent = renderPassInfo.renderArea.extent;
+    vk::Viewport viewport(
+        0.0f, 0.0f,
+        static_cast<float>(extent.width),
+        static_cast<float>(extent.height),
+        0.0f, 1.0f
+    );
+    vk::Rect2D scissor({0, 0}, extent);
+    vk::DescriptorSet frameSet = *descriptorSets_[currentFrame_];
+
+    recordingTimes_.clear();
+    if (drawList_.size() < parallelRecordingMinDraws_ || recordingSlots_.size() < 2) {
+        commandBuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
+        commandBuffer.setViewport(0, viewport);
+        commandBuffer.setScissor(0, scissor);
+        drawStats_ = drawList_.record(commandBuffer, frameSet, frameUboOffset_, drawTarget, culledTarget);
+        commandBuffer.endRenderPass();
+        return;
+    }
+
+    std::vector<uint32_t> bounds = drawList_.splitRuns(static_cast<uint32_t>(recordingSlots_.size()), drawTarget.multiDrawIndirect);
+    size_t jobCount = bounds.size() - 1;
+    for (size_t job = 0; job < jobCount; job++) {
+        //the frame fence signaled, nothing recorded from this slot's pool is pending anymore
+        recordingSlots_[job].commandPools[currentFrame_].reset();
+    }
+
+    std::vector<rendr::DrawStats> jobStats(jobCount);
+    recordingTimes_.assign(jobCount, 0.0f);
+    vk::CommandBufferInheritanceInfo inheritanceInfo(
+        renderPassInfo.renderPass, // renderPass
+        0, // subpass
+        renderPassInfo.framebuffer // framebuffer
+    );
+    jobSystem_->parallelFor(jobCount, [&](size_t job){
+        auto start = std::chrono::steady_clock::now();
+        const vk::raii::CommandBuffer& secondary = recordingSlots_[job].commandBuffers[currentFrame_];
+        secondary.begin(vk::CommandBufferBeginInfo(
+            vk::CommandBufferUsageFlagBits::eRenderPassContinue | vk::CommandBufferUsageFlagBits::eOneTimeSubmit, // flags
+            &inheritanceInfo // pInheritanceInfo
+        ));
+        //dynamic state and bindings are not inherited from the primary
+        secondary.setViewport(0, viewport);
+        secondary.setScissor(0, scissor);
+        jobStats[job] = drawList_.record(secondary, frameSet, frameUboOffset_, drawTarget, culledTarget, bounds[job], bounds[job + 1]);
+        secondary.end();
+        recordingTimes_[job] = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    });
+
+    std::vector<vk::CommandBuffer> secondaries;
+    drawStats_ = rendr::DrawStats();
+    for (size_t job = 0; job < jobCount; job++) {
+        secondaries.push_back(*recordingSlots_[job].commandBuffers[currentFrame_]);
+        drawStats_.draws += jobStats[job].draws;
+        drawStats_.drawCalls += jobStats[job].drawCalls;
+        drawStats_.pipelineBinds += jobStats[job].pipelineBinds;
+        drawStats_.descriptorSetBinds += jobStats[job].descriptorSetBinds;
+        drawStats_.vertexBufferBinds += jobStats[job].vertexBufferBinds;
+        drawStats_.indexBufferBinds += jobStats[job].indexBufferBinds;
+    }
+
+    commandBuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eSecondaryCommandBuffers);
+    //executed in job order, which is the sorted draw order
+    commandBuffer.executeCommands(secondaries);
+    commandBuffer.endRenderPass();
+}
+
+void Renderer::recordCommandBuffer(uint32_t imageIndex, std::optional<uint32_t> readbackSlot){
     vk::raii::CommandBuffer& commandBuffer = commandBuffers_[currentFrame_];
     
     vk::CommandBufferBeginInfo beginInfo(
@@ -1339,44 +2271,33 @@ void Renderer::recordCommandBuffer(uint32_t imageIndex){
     );
     commandBuffer.begin(beginInfo);
 
-    for (auto& objs : setupIndexToDrawableObjs ) {
-    
-        rendr::RendererSetup& setup = rendrSetups_[objs.first];
-        std::array<vk::ClearValue, 2> clearValues{};
-        clearValues[0].color = std::array<float, 4>{0.0f, 0.0f, 0.0f, 1.0f};
-        clearValues[1].depthStencil = vk::ClearDepthStencilValue(1.0f, 0);
-
-        vk::RenderPassBeginInfo renderPassInfo(
-            *setup.renderPass_, // renderPass
-            *setup.swapChainFramebuffers_[imageIndex], // framebuffer
-            vk::Rect2D({0, 0}, swapChain_.swapChainExtent_), // renderArea
-            clearValues // clearValues
-        );
+    vk::Extent2D extent = getRenderExtent();
+    std::array<vk::ClearValue, 2> clearValues{};
+    clearValues[0].color = std::array<float, 4>{0.0f, 0.0f, 0.0f, 1.0f};
+    clearValues[1].depthStencil = vk::ClearDepthStencilValue(1.0f, 0);
 
-        commandBuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
-        commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *setup.graphicsPipeline_);
+    vk::RenderPassBeginInfo renderPassInfo(
+        *renderPass_, // renderPass
+        *framebuffers_[imageIndex], // framebuffer
+        vk::Rect2D({0, 0}, extent), // renderArea
+        clearValues // clearValues
+    );
 
-        vk::Viewport viewport(
-            0.0f, 0.0f,
-            static_cast<float>(swapChain_.swapChainExtent_.width),
-            static_cast<float>(swapChain_.swapChainExtent_.height),
-            0.0f, 1.0f
-        );
-        commandBuffer.setViewport(0, viewport);
+    glm::mat4 viewProj = frameUbo_.proj * frameUbo_.view * frameUbo_.model;
 
-        vk::Rect2D scissor({0, 0}, swapChain_.swapChainExtent_);
-        commandBuffer.setScissor(0, scissor);
+    std::optional<rendr::CulledDrawTarget> culledTarget;
+    if (cullingMode_ == rendr::CullingMode::eGpu) {
+        culledTarget = cullingPass_.writeCullCommands(commandBuffer, currentFrame_, static_cast<uint32_t>(drawList_.size()), viewProj);
+    }
 
-        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *setup.pipelineLayout_, 0, *descriptorSets_[currentFrame_],{});
-        
-        for(auto& obj : objs.second){
-            obj->bindResources(device_.device_, commandBuffer, setup.pipelineLayout_, currentFrame_);  
+    recordFramePass(commandBuffer, renderPassInfo, drawTarget_, culledTarget ? &*culledTarget : nullptr);
 
-            commandBuffer.drawIndexed(obj->getNumOfDrawIndices(), 1, 0, 0, 0);
-        }
-        
-        commandBuffer.endRenderPass();
-    }        
+    cullingPass_.writeBuildHiZCommands(commandBuffer, currentFrame_, viewProj);
+
+    if (readbackSlot) {
+        const rendr::Image& target = offscreenImages_[imageIndex];
+        writeCopyImageToBufferCommand(commandBuffer, target.image, readbackPool_.getBuffer(*readbackSlot), extent.width, extent.height);
+    }
     commandBuffer.end();
 }
 
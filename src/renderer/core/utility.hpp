@@ -9,28 +9,38 @@
 #include <iostream>
 #include <optional>
 #include <unordered_map>
+#include <string_view>
 #include <limits>
 #include <algorithm>
+#include <cmath>
 #include <glm/glm.hpp>
 #include <map>
+#include <functional>
+#include <memory>
 
 #include "vertex.hpp"
 #include "window.hpp"
+#include "allocator.hpp"
+#include "uploadContext.hpp"
+#include "mipChain.hpp"
+#include "cookedTexture.hpp"
+#include "jobSystem.hpp"
+#include "deletionQueue.hpp"
+#include "pipelineCache.hpp"
+#include "samplerCache.hpp"
+#include "readbackPool.hpp"
+#include "drawList.hpp"
+#include "geometryPool.hpp"
+#include "textureTable.hpp"
+#include "descriptorAllocator.hpp"
+#include "culling.hpp"
 #include "stb_image.h"
 #include "ufbx.h"
 
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
-
-namespace std {
-    template<> struct hash<rendr::VertexPCT> {
-        size_t operator()(rendr::VertexPCT const& vertex) const {
-            return ((hash<glm::vec3>()(vertex.pos) ^
-                   (hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^
-                   (hash<glm::vec2>()(vertex.texCoord) << 1);
-        }
-    };
-}
+//set by CMake to the directory glslc writes the .spv files into
+#ifndef ENGINE_SHADER_DIR
+#define ENGINE_SHADER_DIR "shaders"
+#endif
 
 namespace rendr{
 
@@ -70,6 +80,8 @@ private:
 public:
     Instance();
     Instance(Window const & window);
+    //headless instance gets no surface extensions
+    Instance(const std::vector<const char*>& extensions);
 
     Instance(const Instance&) = delete;
     Instance& operator=(const Instance&) = delete;
@@ -108,6 +120,22 @@ struct DeviceConfig{
     };
 
     vk::PhysicalDeviceFeatures deviceEnableFeatures;
+    //enabled only when the picked device supports them, see Device::enabledFeatures_
+    vk::PhysicalDeviceFeatures optionalDeviceFeatures = vk::PhysicalDeviceFeatures()
+        .setMultiDrawIndirect(true)
+        .setDrawIndirectFirstInstance(true);
+    //same for the Vulkan 1.2 features, nothing of it is enabled on 1.0 and 1.1 devices
+    vk::PhysicalDeviceVulkan12Features optionalVulkan12Features = vk::PhysicalDeviceVulkan12Features()
+        .setDrawIndirectCount(true);
+    //devices without them are not picked, the texture table has no fallback
+    vk::PhysicalDeviceVulkan12Features requiredVulkan12Features = vk::PhysicalDeviceVulkan12Features()
+        .setRuntimeDescriptorArray(true)
+        .setShaderSampledImageArrayNonUniformIndexing(true)
+        .setDescriptorBindingSampledImageUpdateAfterBind(true)
+        .setDescriptorBindingPartiallyBound(true)
+        .setDescriptorBindingUpdateUnusedWhilePending(true);
+    //Device::pipelineCache_ is loaded from and saved to it, empty keeps the cache in memory
+    std::string pipelineCachePath = "pipelineCache.bin";
 
     std::function<bool(vk::PhysicalDeviceFeatures)> isDeviceFeaturesSuitable = [](vk::PhysicalDeviceFeatures features){
         return features.samplerAnisotropy && features.geometryShader;
@@ -120,7 +148,25 @@ struct DeviceConfig{
     std::function<bool(QueueFamilyIndices)> isDeviceFamilyIndicesSuitable = [](QueueFamilyIndices familyIndices){
         return familyIndices.isGraphicsAndPresent();
     };
-    
+
+    //offscreen rendering only: no swapchain, any device type including software rasterizers like lavapipe
+    static DeviceConfig headless(){
+        DeviceConfig config;
+        config.requiredDeviceExtensions.clear();
+        config.isDeviceFeaturesSuitable = [](vk::PhysicalDeviceFeatures features){
+            return static_cast<bool>(features.samplerAnisotropy);
+        };
+        config.isDevicePropertiesSuitable = [](vk::PhysicalDeviceProperties properties){
+            return properties.deviceType == vk::PhysicalDeviceType::eDiscreteGpu
+                || properties.deviceType == vk::PhysicalDeviceType::eIntegratedGpu
+                || properties.deviceType == vk::PhysicalDeviceType::eVirtualGpu
+                || properties.deviceType == vk::PhysicalDeviceType::eCpu;
+        };
+        config.isDeviceFamilyIndicesSuitable = [](QueueFamilyIndices familyIndices){
+            return familyIndices.graphicsFamily.has_value();
+        };
+        return config;
+    }
 };
 
 class Device;
@@ -133,31 +179,86 @@ struct Device{
     vk::raii::SurfaceKHR surface_;
     vk::raii::PhysicalDevice physicalDevice_;
     vk::raii::Device device_;
+    //every pipeline is created through it, saved when the device is destroyed
+    rendr::PipelineCache pipelineCache_;
+    //textures and materials take their samplers from it, samplers are destroyed with the device
+    rendr::SamplerCache samplerCache_;
     vk::raii::Queue graphicsQueue_;
     vk::raii::Queue presentQueue_;
+    //dedicated transfer queue if the device has one, graphics queue otherwise
+    vk::raii::Queue transferQueue_;
+    rendr::QueueFamilyIndices queueFamilyIndices_;
+    //required features plus the supported optional ones
+    vk::PhysicalDeviceFeatures enabledFeatures_;
+    vk::PhysicalDeviceVulkan12Features enabledVulkan12Features_;
+    //queried once at create, getProperties is a driver call and frames read the limits every time
+    vk::PhysicalDeviceLimits limits_;
     vk::raii::CommandPool commandPool_;
+    rendr::Allocator allocator_;
 
     Device();
     void create(DeviceConfig config, const rendr::Window& win);
+    //no surface, presentQueue_ is the graphics queue
+    void createHeadless(DeviceConfig config);
 };
 
 struct RendererSetup{
-    vk::raii::DescriptorSetLayout descriptorSetLayout_;
-    vk::raii::RenderPass renderPass_;
     vk::raii::PipelineLayout pipelineLayout_;
+    //built against Renderer::getRenderPass(), every setup draws inside the renderer's frame pass
     vk::raii::Pipeline graphicsPipeline_;
-    std::vector<vk::raii::Framebuffer> swapChainFramebuffers_;
-    std::function<void(const rendr::Renderer&, rendr::RendererSetup& setup)> swapChainFramebuffersRecreationFunc_;
-    vk::raii::DescriptorPool descriptorPool_;
-    std::vector<vk::raii::DescriptorSet> descriptorSets_;
 
     RendererSetup();
 };
 
+//What Material::createRendererSetup builds against. Copied on the thread that starts the compile,
+//so compile jobs never read the renderer while it recreates its swapchain
+struct RendererSetupContext{
+    const rendr::Device* device = nullptr;
+    //Renderer::getRenderPass(), lives as long as the renderer
+    vk::RenderPass renderPass;
+    vk::Extent2D renderExtent;
+    //set 0, the renderer's frame set
+    vk::DescriptorSetLayout frameSetLayout;
+    //set 1, the renderer's TextureTable
+    vk::DescriptorSetLayout textureTableLayout;
+    int framesInFlight = 0;
+    //RendererConfig::shaderDirectory
+    std::string shaderDirectory;
+};
+
 struct RendererConfig{
+    //frames the host records ahead of the GPU, independent of the swapchain image count.
+    //More hides CPU spikes, fewer lowers input latency
     int framesInFlight = 2;
+    //persistently mapped ring for uploads and per-frame uniform data
+    vk::DeviceSize stagingRingSize = 64 * 1024 * 1024;
     DeviceConfig deviceConfig;
     SwapChainConfig swapChainConfig;
+    //headless mode only, see Renderer::initHeadless
+    vk::Extent2D offscreenExtent{1280, 720};
+    vk::Format offscreenFormat = vk::Format::eR8G8B8A8Srgb;
+    uint32_t readbackBufferCount = 3;
+    //shared vertex/index buffers of every mesh, in elements
+    uint32_t geometryPoolVertices = 2 * 1024 * 1024;
+    uint32_t geometryPoolIndices = 8 * 1024 * 1024;
+    //slots of the bindless texture table, clamped to the device limits
+    uint32_t textureTableCapacity = 4096;
+    //sets of the first descriptor pools, later pools grow by half
+    uint32_t descriptorSetsPerPool = 64;
+    //size of the per frame indirect command and draw data buffers
+    uint32_t maxDrawsPerFrame = 65536;
+    //compiled .spv files of the renderer's passes and SimpleMaterial
+    std::string shaderDirectory = ENGINE_SHADER_DIR;
+    //eGpu falls back to eCpu on devices without multiDrawIndirect
+    rendr::CullingMode cullingMode = rendr::CullingMode::eGpu;
+    //HiZ test against the previous frame's depth on top of the frustum test
+    bool occlusionCulling = true;
+    //frame pass recording fans out onto it, the renderer creates its own when it is null
+    rendr::JobSystem* jobSystem = nullptr;
+    //workers of the renderer's own job system, 0 is one less than the hardware threads
+    uint32_t recordingThreads = 0;
+    //smaller draw lists are recorded inline into the primary command buffer
+    uint32_t parallelRecordingMinDraws = 2048;
 };
 
 struct SwapChain{
@@ -166,37 +267,72 @@ struct SwapChain{
     vk::Extent2D swapChainExtent_;
     std::vector<vk::Image> swapChainImages_;
     std::vector<vk::raii::ImageView> swapChainImageViews_;
+    //signaled by the frame rendering into image i and waited on by its present. Per image rather than
+    //per frame slot: the image has to be acquired again before its semaphore can be reused
+    std::vector<vk::raii::Semaphore> presentSemaphores_;
 
     SwapChain();
-    void create(const rendr::Device&  renderDevice, const rendr::Window& win, const rendr::SwapChainConfig& config);
+    void create(const rendr::Device&  renderDevice, const rendr::Window& win, const rendr::SwapChainConfig& config, vk::SwapchainKHR oldSwapChain = nullptr);
     void clear();
 };
 
-struct Image{
-    vk::raii::ImageView imageView;
-    vk::raii::DeviceMemory imageMemory;
-    vk::raii::Image image;
+//Scene material of a mesh: ufbx_material::typed_id, the material's index in ufbx_scene::materials.
+//Materials that share a name keep distinct ids
+struct MaterialId{
+    uint32_t value = std::numeric_limits<uint32_t>::max();
 
-    Image() : image(nullptr), imageMemory(nullptr), imageView(nullptr){}
+    bool operator==(MaterialId other) const{
+        return value == other.value;
+    }
+    bool operator!=(MaterialId other) const{
+        return value != other.value;
+    }
+    bool operator<(MaterialId other) const{
+        return value < other.value;
+    }
 };
 
-struct Buffer{   
-    vk::raii::DeviceMemory bufferMemory;
-    vk::raii::Buffer buffer;
-    Buffer() : buffer(nullptr), bufferMemory(nullptr){}
-};
+//material id of meshes without a material
+const MaterialId noMaterialId{};
 
 template<typename VertexType>
 struct Mesh{
     std::vector<VertexType> vertices;
     std::vector<uint32_t> indices;
+    MaterialId materialId = noMaterialId;
+    //xyz center, w radius, in the space of the vertex positions
+    glm::vec4 boundingSphere{0.0f};
 };
 
+//sphere around the AABB center, looser than a minimal sphere but one pass over the positions
+template<typename VertexType>
+glm::vec4 computeBoundingSphere(const VertexType* vertices, size_t vertexCount){
+    if (vertexCount == 0) {
+        return glm::vec4(0.0f);
+    }
+    glm::vec3 minPos = vertices[0].pos;
+    glm::vec3 maxPos = vertices[0].pos;
+    for (size_t i = 1; i < vertexCount; i++) {
+        minPos = glm::min(minPos, vertices[i].pos);
+        maxPos = glm::max(maxPos, vertices[i].pos);
+    }
+    glm::vec3 center = (minPos + maxPos) * 0.5f;
+    float radiusSq = 0.0f;
+    for (size_t i = 0; i < vertexCount; i++) {
+        glm::vec3 offset = vertices[i].pos - center;
+        radiusSq = std::max(radiusSq, glm::dot(offset, offset));
+    }
+    return glm::vec4(center, std::sqrt(radiusSq));
+}
+
 
 struct DeviceWithGraphicsAndPresentQueues{
     vk::raii::Device device;
     vk::raii::Queue graphicsQueue;
     vk::raii::Queue presentQueue;
+    vk::raii::Queue transferQueue;
+    vk::PhysicalDeviceFeatures enabledFeatures;
+    vk::PhysicalDeviceVulkan12Features enabledVulkan12Features;
 };
 
 struct SwapChainSupportDetails {
@@ -266,9 +402,15 @@ struct MVPUniformBufferObject {
 
 struct PerFrameSync{
     vk::raii::Semaphore imageAvailableSemaphore;
-    vk::raii::Semaphore renderFinishedSemaphore;
     vk::raii::Fence inFlightFence;
-    PerFrameSync() : imageAvailableSemaphore(nullptr), renderFinishedSemaphore(nullptr), inFlightFence(nullptr) {}
+    PerFrameSync() : imageAvailableSemaphore(nullptr), inFlightFence(nullptr) {}
+};
+
+//command pool and secondary command buffer of one recording job, per frame in flight.
+//A job runs on one thread at a time, so its pools are never used concurrently
+struct RecordingSlot{
+    std::vector<vk::raii::CommandPool> commandPools;
+    std::vector<vk::raii::CommandBuffer> commandBuffers;
 };
 
 class UfbxSceneRaii {
@@ -332,7 +474,9 @@ vk::PresentModeKHR chooseSwapPresentMode(std::vector<vk::PresentModeKHR> const &
 
 vk::Extent2D chooseSwapExtent(vk::SurfaceCapabilitiesKHR const &capabilities, std::pair<int, int> const &winFramebufferSize);
 
-SwapChainData createSwapChain(vk::raii::PhysicalDevice const &physicalDevice, vk::raii::SurfaceKHR const &surface, vk::raii::Device const &device, rendr::Window const &win, const rendr::SwapChainConfig &config);
+//oldSwapChain is retired by the new one, its presented images stay valid until it is destroyed
+SwapChainData createSwapChain(vk::raii::PhysicalDevice const &physicalDevice, vk::raii::SurfaceKHR const &surface, vk::raii::Device const &device, rendr::Window const &win, const rendr::SwapChainConfig &config,
+    vk::SwapchainKHR oldSwapChain = nullptr);
 
 vk::raii::ImageView createImageView(vk::raii::Device const &device, vk::Image const &image, vk::Format const &format, vk::ImageAspectFlags aspectFlags);
 
@@ -344,62 +488,96 @@ vk::Format findDepthFormat(const vk::raii::PhysicalDevice &physicalDevice);
 
 vk::raii::RenderPass createRenderPass(const vk::raii::Device &device, const std::vector<vk::AttachmentDescription> &attachments, const std::vector<vk::SubpassDescription> &subpasses, const std::vector<vk::SubpassDependency> &dependencies);
 
-vk::raii::RenderPass createRenderPassWithColorAndDepthAttOneSubpass(const vk::raii::Device &device, vk::Format swapChainImageFormat, vk::Format depthFormat);
+//finalColorLayout is eTransferSrcOptimal for offscreen targets that are read back,
+//storeDepth keeps the depth attachment for passes that sample it afterwards
+vk::raii::RenderPass createRenderPassWithColorAndDepthAttOneSubpass(const vk::raii::Device &device, vk::Format swapChainImageFormat, vk::Format depthFormat,
+    vk::ImageLayout finalColorLayout = vk::ImageLayout::ePresentSrcKHR, bool storeDepth = false);
 
 vk::raii::DescriptorSetLayout createDescriptorSetLayout(const vk::raii::Device &device, std::vector<vk::DescriptorSetLayoutBinding> bindings);
 
 vk::raii::DescriptorSetLayout createSamplerDescriptorSetLayout(const vk::raii::Device &device);
 
+vk::raii::DescriptorSetLayout createDynamicUboDescriptorSetLayout(const vk::raii::Device &device);
+
 vk::raii::DescriptorSetLayout createUboAndSamplerDescriptorSetLayout(const vk::raii::Device &device);
 
+//renderer's set 0: dynamic frame UBO at binding 0, per draw DrawData storage buffer at binding 1
+vk::raii::DescriptorSetLayout createFrameDescriptorSetLayout(const vk::raii::Device &device);
+
 vk::raii::ShaderModule createShaderModule(const vk::raii::Device &device, const std::vector<char> &code);
 
 vk::raii::PipelineLayout createPipelineLayout(const vk::raii::Device &device, const std::vector<vk::DescriptorSetLayout> &descriptorSetLayouts, const std::vector<vk::PushConstantRange> &pushConstantRanges);
 
 uint32_t findMemoryType(vk::raii::PhysicalDevice const &physicalDevice, uint32_t typeFilter, vk::MemoryPropertyFlags properties);
 
-rendr::Image createImage(const vk::raii::PhysicalDevice &physicalDevice, const vk::raii::Device &device, vk::MemoryPropertyFlags properties, vk::ImageCreateInfo imageInfo, vk::ImageViewCreateInfo imageViewInfo);
+rendr::Image createDepthImage(const vk::raii::PhysicalDevice &physicalDevice, const rendr::Allocator &allocator, const vk::raii::Device &device, uint32_t width, uint32_t height,
+    vk::ImageUsageFlags extraUsage = {});
 
-rendr::Image createDepthImage(const vk::raii::PhysicalDevice &physicalDevice, const vk::raii::Device &device, uint32_t width, uint32_t height);
+rendr::Image createOffscreenColorImage(const rendr::Allocator &allocator, const vk::raii::Device &device, vk::Format format, uint32_t width, uint32_t height);
 
-std::vector<vk::raii::Framebuffer> createSwapChainFramebuffersWithDepthAtt(const vk::raii::Device &device, const vk::raii::RenderPass &renderPass, const std::vector<vk::raii::ImageView> &swapChainImageViews, const vk::raii::ImageView &depthImageView, uint32_t width, uint32_t height);
+std::vector<vk::raii::Framebuffer> createSwapChainFramebuffersWithDepthAtt(const vk::raii::Device &device, const vk::raii::RenderPass &renderPass, const std::vector<vk::ImageView> &swapChainImageViews, const vk::raii::ImageView &depthImageView, uint32_t width, uint32_t height);
 
 vk::raii::CommandPool createGraphicsCommandPool(const vk::raii::Device &device, const rendr::QueueFamilyIndices &queueFamilyIndices);
 
-rendr::Buffer createBuffer(const vk::raii::PhysicalDevice &physicalDevice, const vk::raii::Device &device, vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties);
+//onGraphicsQueue = false for transfer only queues: shader stages can't be waited there, the upload fence makes the image visible
+void writeTransitionImageLayoutBarrier(const vk::raii::CommandBuffer &commandBuffer, const vk::raii::Image &image, vk::Format format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout, bool onGraphicsQueue = true, uint32_t mipLevels = 1);
+
+void writeCopyBufferToImageCommand(const vk::raii::CommandBuffer &commandBuffer, const vk::raii::Buffer &buffer, const vk::raii::Image &image, uint32_t width, uint32_t height, vk::DeviceSize bufferOffset = 0);
+
+//expects the image in eTransferSrcOptimal, makes the copy visible to host reads
+void writeCopyImageToBufferCommand(const vk::raii::CommandBuffer &commandBuffer, const vk::raii::Image &image, const vk::raii::Buffer &buffer, uint32_t width, uint32_t height);
 
-vk::raii::CommandBuffer beginSingleTimeCommands(const vk::raii::Device &device, const vk::raii::CommandPool &commandPool);
+void writeCopyBufferToImageMipsCommand(const vk::raii::CommandBuffer &commandBuffer, const vk::raii::Buffer &buffer, const vk::raii::Image &image, const std::vector<MipLevel> &levels, vk::DeviceSize bufferOffset = 0);
 
-void endSingleTimeCommands(const vk::raii::CommandBuffer &commandBuffer, const vk::raii::Queue &queueToSubmit);
+//blits level 0 down the chain, expects every level in eTransferDstOptimal and leaves them in eShaderReadOnlyOptimal. Graphics queue only
+void writeGenerateMipmapsCommands(const vk::raii::CommandBuffer &commandBuffer, const vk::raii::Image &image, uint32_t width, uint32_t height, uint32_t mipLevels);
 
-void writeTransitionImageLayoutBarrier(const vk::raii::CommandBuffer &singleTimeCommandBuffer, const vk::raii::Image &image, vk::Format format, vk::ImageLayout oldLayout, vk::ImageLayout newLayout);
+//creates the full mip chain, blitted on the GPU when the upload queue and the format allow it, built on the CPU otherwise
+Image create2DTextureImage(const vk::raii::PhysicalDevice &physicalDevice, const rendr::Allocator &allocator, const vk::raii::Device &device,
+    rendr::UploadContext &uploadContext, STBImageRaii ImageData);
 
-void writeCopyBufferToImageCommand(const vk::raii::CommandBuffer &singleTimeCommandBuffer, const vk::raii::Buffer &buffer, const vk::raii::Image &image, uint32_t width, uint32_t height);
+//the device can sample the cooked format, BC formats are missing on most mobile GPUs and some software rasterizers
+bool isCookedFormatSupported(const vk::raii::PhysicalDevice &physicalDevice, CookedTextureFormat format, bool srgb);
 
-Image create2DTextureImage(const vk::raii::PhysicalDevice &physicalDevice, const vk::raii::Device &device, const vk::raii::CommandPool &commandPool, const vk::raii::Queue &graphicsQueue, STBImageRaii ImageData);
+//uploads the already encoded levels of a cooked texture as is, throws if the device can't sample its format
+Image create2DTextureImage(const vk::raii::PhysicalDevice &physicalDevice, const rendr::Allocator &allocator, const vk::raii::Device &device,
+    rendr::UploadContext &uploadContext, const CookedTexture &texture);
 
-vk::raii::Sampler createTextureSampler(const vk::raii::Device &device, const vk::raii::PhysicalDevice &physicalDevice);
+//trilinear, repeating, maximum anisotropy. The lod range is unclamped, sampling stops at the view's last level,
+//so every texture gets the same create info
+vk::SamplerCreateInfo createTextureSamplerInfo(const vk::PhysicalDeviceLimits &limits);
 
-std::pair<std::vector<VertexPCT>, std::vector<uint32_t>> loadModel(const std::string &filepath);
+//the shared sampler of createTextureSamplerInfo from the device's sampler cache
+vk::Sampler getTextureSampler(const rendr::Device &device);
+
+//lod range covers every mip level of the image, owned by the caller. Prefer getTextureSampler
+vk::raii::Sampler createTextureSampler(const vk::raii::Device &device, const vk::PhysicalDeviceLimits &limits, const rendr::Image &image);
+
+rendr::Mesh<VertexPCT> loadModel(const std::string &filepath);
 
 ufbx_scene *ufbxOpenScene(const std::string &filepath, bool blenderFlag);
 
 void ufbxCloseScene(ufbx_scene *scene_ptr);
 
-std::vector<std::pair<rendr::Mesh<VertexPTN>, uint32_t>> ufbxLoadMeshesPartsSepByMaterial(ufbx_scene *scene);
+//id of the material in a mesh slot, noMaterialId for an empty slot
+MaterialId ufbxGetMaterialId(const ufbx_mesh *mesh, size_t slot);
 
-void writeCopyBufferCommand(const vk::raii::CommandBuffer &singleTimeCommandBuffer, const vk::raii::Buffer &srcBuffer, const vk::raii::Buffer &dstBuffer, vk::DeviceSize size);
+//parts are converted on the job system when it is given, output order is the scene order either way
+std::vector<rendr::Mesh<VertexPTN>> ufbxLoadMeshesPartsSepByMaterial(ufbx_scene *scene, rendr::JobSystem *jobs = nullptr);
 
-rendr::Buffer createIndexBuffer(const vk::raii::PhysicalDevice &physicalDevice, const vk::raii::Device &device, const vk::raii::CommandPool &commandPool, const vk::raii::Queue &graphicsQueue, const std::vector<uint32_t> &indices);
+void writeCopyBufferCommand(const vk::raii::CommandBuffer &commandBuffer, const vk::raii::Buffer &srcBuffer, const vk::raii::Buffer &dstBuffer, vk::DeviceSize size, vk::DeviceSize srcOffset = 0);
 
-std::vector<rendr::Buffer> createAndMapUniformBuffers(const vk::raii::PhysicalDevice &physicalDevice, const vk::raii::Device &device, std::vector<void *> &uniformBuffersMappedData, size_t numOfBuffers, MVPUniformBufferObject ubo);
+rendr::Buffer createIndexBuffer(const rendr::Allocator &allocator, const vk::raii::Device &device, rendr::UploadContext &uploadContext, const std::vector<uint32_t> &indices);
 
-vk::raii::DescriptorPool createDescriptorPool(const vk::raii::Device &device, uint32_t maxFramesInFlight);
+rendr::Buffer createIndexBuffer(const rendr::Allocator &allocator, const vk::raii::Device &device, rendr::UploadContext &uploadContext, const uint32_t *indices, size_t indexCount);
 
 std::vector<vk::raii::CommandBuffer> createCommandBuffers(const vk::raii::Device &device, const vk::raii::CommandPool &commandPool, uint32_t framesInFlight);
 
 std::vector<rendr::PerFrameSync> createSyncObjects(const vk::raii::Device &device, uint32_t framesInFlight);
 
+//pools are reset as a whole once per frame, no per buffer reset
+std::vector<rendr::RecordingSlot> createRecordingSlots(const vk::raii::Device &device, uint32_t queueFamilyIndex, uint32_t slotCount, uint32_t framesInFlight);
+
 static std::vector<char> readFile(std::string const &filename){
     std::ifstream file(filename, std::ios::ate | std::ios::binary);
 
@@ -416,41 +594,43 @@ static std::vector<char> readFile(std::string const &filename){
 }
 
 //concept
+//copy is recorded into the current upload batch, buffer is ready when uploadContext.getRecordingTicket() completes
 template<typename VertexType>
 rendr::Buffer createVertexBuffer(
-    const vk::raii::PhysicalDevice &physicalDevice, 
+    const rendr::Allocator &allocator, 
     const vk::raii::Device &device,
-    const vk::raii::CommandPool& commandPool,
-    const vk::raii::Queue& graphicsQueue, 
-    const std::vector<VertexType>& vertices){
-
-    vk::DeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+    rendr::UploadContext& uploadContext,
+    const VertexType* vertices,
+    size_t vertexCount){
 
-    rendr::Buffer stagingBuffer = createBuffer(physicalDevice, device, bufferSize, vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eVertexBuffer, 
-        vk::MemoryPropertyFlagBits::eHostVisible |  vk::MemoryPropertyFlagBits::eHostCoherent
-    );
-
-    void* data = stagingBuffer.bufferMemory.mapMemory(0,bufferSize);
-        memcpy(data, vertices.data(), (size_t) bufferSize);
-    stagingBuffer.bufferMemory.unmapMemory();
+    vk::DeviceSize bufferSize = sizeof(VertexType) * vertexCount;
 
+    rendr::StagingSpan staging = uploadContext.stage(vertices, bufferSize);
 
-    rendr::Buffer vertexBuffer = createBuffer(physicalDevice, device, bufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer, 
-        vk::MemoryPropertyFlagBits::eDeviceLocal
+    rendr::Buffer vertexBuffer = createBuffer(allocator, device, bufferSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer, 
+        vk::MemoryPropertyFlagBits::eDeviceLocal, uploadContext.getSharingFamilies()
     );
 
-    vk::raii::CommandBuffer singleTimeCommandBuffer = rendr::beginSingleTimeCommands(device, commandPool);
-        writeCopyBufferCommand(singleTimeCommandBuffer, stagingBuffer.buffer, vertexBuffer.buffer, bufferSize);
-    rendr::endSingleTimeCommands(singleTimeCommandBuffer, graphicsQueue);
+    writeCopyBufferCommand(uploadContext.getCommandBuffer(), *staging.buffer, vertexBuffer.buffer, bufferSize, staging.offset);
     
     return vertexBuffer;
 }
 
+template<typename VertexType>
+rendr::Buffer createVertexBuffer(
+    const rendr::Allocator &allocator, 
+    const vk::raii::Device &device,
+    rendr::UploadContext& uploadContext,
+    const std::vector<VertexType>& vertices){
+
+    return createVertexBuffer(allocator, device, uploadContext, vertices.data(), vertices.size());
+}
+
 
 inline vk::raii::Pipeline createGraphicsPipeline(
     const vk::raii::Device& device,
     const vk::raii::PipelineLayout& pipelineLayout,
-    const vk::raii::RenderPass& renderPass,
+    vk::RenderPass renderPass,
     const std::vector<vk::PipelineShaderStageCreateInfo>& shaderStages,
     const vk::PipelineVertexInputStateCreateInfo& vertexInputInfo,
     const vk::PipelineInputAssemblyStateCreateInfo& inputAssembly,
@@ -459,7 +639,8 @@ inline vk::raii::Pipeline createGraphicsPipeline(
     const vk::PipelineMultisampleStateCreateInfo& multisampling,
     const vk::PipelineColorBlendStateCreateInfo& colorBlending,
     const vk::PipelineDepthStencilStateCreateInfo& depthStencil,
-    const vk::PipelineDynamicStateCreateInfo& dynamicState) {
+    const vk::PipelineDynamicStateCreateInfo& dynamicState,
+    const rendr::PipelineCache* pipelineCache = nullptr) {
 
     vk::GraphicsPipelineCreateInfo pipelineInfo(
         {}, // flags
@@ -475,12 +656,15 @@ inline vk::raii::Pipeline createGraphicsPipeline(
         &colorBlending, // pColorBlendState
         &dynamicState, // pDynamicState
         *pipelineLayout, // layout
-        *renderPass, // renderPass
+        renderPass, // renderPass
         0, // subpass
         vk::Pipeline(), // basePipelineHandle
         -1 // basePipelineIndex
     );
 
+    if (pipelineCache) {
+        return pipelineCache->createGraphicsPipeline(device, pipelineInfo);
+    }
     return vk::raii::Pipeline(device, nullptr, pipelineInfo);
 }
 
@@ -488,11 +672,12 @@ inline vk::raii::Pipeline createGraphicsPipeline(
 template<typename VertexType>
 vk::raii::Pipeline createGraphicsPipelineWithDefaults(
     const vk::raii::Device& device,
-    const vk::raii::RenderPass& renderPass,
+    vk::RenderPass renderPass,
     const vk::raii::PipelineLayout& pipelineLayout,
     vk::Extent2D swapChainExtent, VertexType vertexType, 
     const vk::raii::ShaderModule& vertShaderModule,
-    const vk::raii::ShaderModule& fragShaderModule) {
+    const vk::raii::ShaderModule& fragShaderModule,
+    const rendr::PipelineCache* pipelineCache = nullptr) {
 
     vk::PipelineShaderStageCreateInfo vertShaderStageInfo(
         {}, // flags
@@ -636,7 +821,8 @@ vk::raii::Pipeline createGraphicsPipelineWithDefaults(
         multisampling,
         colorBlending,
         depthStencil,
-        dynamicState
+        dynamicState,
+        pipelineCache
     );
 }
 
@@ -662,43 +848,57 @@ struct Camera
 };
 
 template<typename VertexType>
-std::map<uint32_t, rendr::Mesh<VertexType>> mergeMeshesByMaterial(const std::vector<std::pair<rendr::Mesh<VertexType>, uint32_t>>& meshesAndMatInd) {
+std::map<rendr::MaterialId, rendr::Mesh<VertexType>> mergeMeshesByMaterial(const std::vector<rendr::Mesh<VertexType>>& meshes, rendr::JobSystem* jobs = nullptr) {
     
-    std::map<uint32_t, rendr::Mesh<VertexType>> materialToMesh;
-
-    // Подсчет общего количества вершин и индексов для каждого материала
-    std::map<uint32_t, size_t> materialVertexCount;
-    std::map<uint32_t, size_t> materialIndexCount;
-    for (const auto& meshMatPair : meshesAndMatInd) {
-        uint32_t materialIndex = meshMatPair.second;
-        materialVertexCount[materialIndex] += meshMatPair.first.vertices.size();
-        materialIndexCount[materialIndex] += meshMatPair.first.indices.size();
+    std::map<rendr::MaterialId, rendr::Mesh<VertexType>> materialToMesh;
+
+    // Смещения каждой части внутри меша её материала (префиксные суммы)
+    std::vector<size_t> vertexOffsets(meshes.size());
+    std::vector<size_t> indexOffsets(meshes.size());
+    std::map<rendr::MaterialId, std::pair<size_t, size_t>> materialCounts;
+    for (size_t i = 0; i < meshes.size(); i++) {
+        std::pair<size_t, size_t>& counts = materialCounts[meshes[i].materialId];
+        vertexOffsets[i] = counts.first;
+        indexOffsets[i] = counts.second;
+        counts.first += meshes[i].vertices.size();
+        counts.second += meshes[i].indices.size();
     }
 
-    // Резервирование памяти
-    for (const auto& entry : materialVertexCount) {
-        materialToMesh[entry.first].vertices.reserve(entry.second);
-    }
-    for (const auto& entry : materialIndexCount) {
-        materialToMesh[entry.first].indices.reserve(entry.second);
+    // Выделение памяти заранее, дальше части пишут каждая в свой диапазон
+    for (const auto& entry : materialCounts) {
+        rendr::Mesh<VertexType>& merged = materialToMesh[entry.first];
+        merged.vertices.resize(entry.second.first);
+        merged.indices.resize(entry.second.second);
+        merged.materialId = entry.first;
     }
 
-    // Объединение вершин и индексов по материалам
-    for (const auto& meshMatPair : meshesAndMatInd) {
-        const auto& mesh = meshMatPair.first;
-        uint32_t materialIndex = meshMatPair.second;
+    // Копирование вершин и индексов с учетом смещения
+    auto copyPart = [&](size_t i) {
+        const auto& mesh = meshes[i];
+        auto& meshData = materialToMesh.find(mesh.materialId)->second;
 
-        auto& meshData = materialToMesh[materialIndex];
-        auto vertexOffset = meshData.vertices.size();
+        std::copy(mesh.vertices.begin(), mesh.vertices.end(), meshData.vertices.begin() + vertexOffsets[i]);
 
-        meshData.vertices.insert(meshData.vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+        uint32_t vertexOffset = static_cast<uint32_t>(vertexOffsets[i]);
+        uint32_t* dstIndices = meshData.indices.data() + indexOffsets[i];
+        for (size_t j = 0; j < mesh.indices.size(); j++) {
+            dstIndices[j] = mesh.indices[j] + vertexOffset;
+        }
+    };
 
-        // Обновление индексов с учетом смещения
-        for (auto index : mesh.indices) {
-            meshData.indices.push_back(index + vertexOffset);
+    if (jobs) {
+        jobs->parallelFor(meshes.size(), copyPart);
+    } else {
+        for (size_t i = 0; i < meshes.size(); i++) {
+            copyPart(i);
         }
     }
 
+    for (auto& entry : materialToMesh) {
+        rendr::Mesh<VertexType>& merged = entry.second;
+        merged.boundingSphere = computeBoundingSphere(merged.vertices.data(), merged.vertices.size());
+    }
+
     return materialToMesh;
 }
 
@@ -715,35 +915,146 @@ class IDrawableObj;
 class Material;
 class DrawableObj;
 
+//material whose setup Renderer::initMaterialAsync is compiling, see Renderer::isMaterialReady
+struct MaterialHandle{
+    int setupIndex = -1;
+};
+
+//host time drawFrame spent blocked on fences, to tune framesInFlight for latency or throughput
+struct FramePacingStats{
+    //last frame, on the fence of the frame slot being reused
+    float frameFenceWaitMs = 0.0f;
+    //last frame, on the fence of an earlier frame still rendering into the acquired image
+    float imageFenceWaitMs = 0.0f;
+    //exponential average of both waits together
+    float averageWaitMs = 0.0f;
+    uint32_t swapChainRecreations = 0;
+};
+
 class Renderer{
 private:
     int framesInFlight_;  
     int currentFrame_ = 0;
     int matIndCount_ = 0;
     rendr::Device device_;
+    rendr::StagingRing stagingRing_;
+    rendr::UploadContext uploadContext_;
     rendr::SwapChain swapChain_;
     rendr::SwapChainConfig swapChainConfig_;
     rendr::Image depthImage_;
+    //allocated size of depthImage_, it is kept while the render extent fits into it
+    vk::Extent2D depthExtent_;
+    //one pass per frame with a single clear, shared by every material
+    vk::raii::RenderPass renderPass_;
+    std::vector<vk::raii::Framebuffer> framebuffers_;
     std::map<int, rendr::RendererSetup> rendrSetups_;
+    //setups compiled on the job system. Only the compiling job touches the setup until the counter
+    //is done, then the main thread moves it into rendrSetups_
+    struct PendingSetup{
+        std::unique_ptr<rendr::JobCounter> counter;
+        std::unique_ptr<rendr::RendererSetup> setup;
+    };
+    std::map<int, PendingSetup> pendingSetups_;
     std::vector<vk::raii::CommandBuffer> commandBuffers_;
     std::vector<rendr::PerFrameSync> framesSyncObjs_;
-    std::vector<rendr::Buffer> uniformBuffers_;
-    std::vector<void*> uniformBuffersMapped_;
+    //fence of the last frame that rendered into each swapchain image, images can come back out of order
+    std::vector<vk::Fence> imagesInFlight_;
+    //set by resizes and suboptimal or out of date results, the swapchain is recreated before the next acquire
+    bool swapChainDirty_ = false;
+    rendr::Window* window_ = nullptr;
+    rendr::FramePacingStats pacingStats_;
+    //uniform data of each frame lives in the staging ring until the frame fence signals
+    rendr::MVPUniformBufferObject frameUbo_;
+    std::vector<uint64_t> frameUboSpans_;
+    uint32_t frameUboOffset_ = 0;
 
     vk::raii::DescriptorSetLayout descriptorSetLayout_;
-    vk::raii::DescriptorPool descriptorPool_;
+    //before the sets allocated from it
+    rendr::DescriptorAllocator descriptorAllocator_;
     std::vector<vk::raii::DescriptorSet> descriptorSets_;
 
     std::map<int, std::vector<rendr::IDrawableObj*>> setupIndexToDrawableObjs;
-
-    void cleanupSwapChain();
-    void recordCommandBuffer(uint32_t imageIndex); 
+    rendr::DrawList drawList_;
+    //draw list of the current frame packed into its slot's indirect and DrawData buffers
+    rendr::IndirectDrawTarget drawTarget_;
+    rendr::DrawStats drawStats_;
+    rendr::GeometryPool geometryPool_;
+    rendr::TextureTable textureTable_;
+    //host visible, written by the draw list every frame
+    std::vector<rendr::Buffer> indirectBuffers_;
+    std::vector<rendr::Buffer> drawDataBuffers_;
+    uint32_t maxDrawsPerFrame_ = 0;
+    std::string shaderDirectory_;
+    rendr::CullingPass cullingPass_;
+    rendr::CullingMode cullingMode_ = rendr::CullingMode::eNone;
+    //the depth attachment is stored and sampled for the HiZ pyramid
+    bool occlusionCulling_ = false;
+    //recording jobs of the frame pass, one slot per job, the thread calling drawFrame takes jobs as well
+    std::unique_ptr<rendr::JobSystem> ownJobSystem_;
+    rendr::JobSystem* jobSystem_ = nullptr;
+    std::vector<rendr::RecordingSlot> recordingSlots_;
+    uint32_t parallelRecordingMinDraws_ = 0;
+    std::vector<float> recordingTimes_;
+
+    //headless mode renders frame slot i into offscreenImages_[i] and copies it into the readback pool
+    bool headless_ = false;
+    vk::Extent2D offscreenExtent_;
+    vk::Format offscreenFormat_ = vk::Format::eUndefined;
+    std::vector<rendr::Image> offscreenImages_;
+    rendr::ReadbackPool readbackPool_;
+    std::function<void(const rendr::ReadbackFrame&)> readbackCallback_;
+    //number of the frame last submitted in each frame slot
+    std::vector<uint64_t> slotFrameNumbers_;
+    uint64_t frameNumber_ = 0;
+    //declared last, retired resources go before the pools and the device they came from
+    rendr::DeletionQueue deletionQueue_;
+
+    void collectRetired();
+    //every frame numbered below frameNumber finished
+    bool areFramesComplete(uint64_t frameNumber) const;
+    //blocks until the fence signaled, returns the milliseconds waited
+    float waitForFence(vk::Fence fence);
+    //every submitted frame is done, the device may still run uploads
+    void waitForFrames();
+    //builds, culls and packs drawList_ into the current slot's buffers, the slot's fence must have signaled
+    void prepareDrawList();
+    //readbackSlot is given in headless mode, the target is copied into that readback buffer
+    void recordCommandBuffer(uint32_t imageIndex, std::optional<uint32_t> readbackSlot = std::nullopt); 
+    //draws of the frame pass, split over the recording jobs into secondary command buffers when the list is large enough
+    void recordFramePass(const vk::raii::CommandBuffer& commandBuffer, const vk::RenderPassBeginInfo& renderPassInfo,
+        const rendr::IndirectDrawTarget& drawTarget, const rendr::CulledDrawTarget* culledTarget);
+    void writeFrameUbo();
+    void drawFrameHeadless();
+    bool isFrameComplete(uint64_t frameNumber) const;
+    void initFrameResources(const RendererConfig& config);
+    rendr::RendererSetupContext getSetupContext() const;
+    //moves finished setups into rendrSetups_, rethrows compile errors
+    void collectCompiledMaterials();
+    void finishMaterial(std::map<int, PendingSetup>::iterator pending);
+    //resolves the culling mode against the device, before the depth attachment is created
+    void initCulling(const RendererConfig& config);
+    void createDepthAttachment(vk::Extent2D extent);
+    void createFramebuffers();
 public:
     Renderer();
+    //waits for material compiles still running
+    ~Renderer();
     void drawFrame();
     void setDrawableObjects(std::vector<IDrawableObj*> objs);
     void initMaterial(Material& material);
+    //compiles the material's setup on a worker and returns at once, the driver side pipeline cache is shared
+    //by all compiles. Objects of the material are not drawn until it is ready
+    rendr::MaterialHandle initMaterialAsync(Material& material);
+    bool isMaterialReady(rendr::MaterialHandle handle) const;
+    //blocks until the setup is compiled, running queued jobs meanwhile
+    void waitForMaterial(rendr::MaterialHandle handle);
     void init(const RendererConfig& config, rendr::Window& win);
+    //renders into config.offscreenExtent images without a window, use DeviceConfig::headless() for display-less machines
+    void initHeadless(const RendererConfig& config);
+    //called from drawFrame for every read back frame, in submission order
+    void setReadbackCallback(std::function<void(const rendr::ReadbackFrame&)> callback);
+    //waits for every submitted frame and delivers its readback
+    void flushReadbacks();
     void recreateSwapChain(const rendr::Window& window);
     void waitIdle();
     void updateUniformBuffer(rendr::MVPUniformBufferObject ubo);
@@ -758,25 +1069,99 @@ public:
         return device_;
     }
 
+    rendr::UploadContext& getUploadContext(){
+        return uploadContext_;
+    }
+
+    //meshes are sub-allocated from it so their draws can be merged
+    rendr::GeometryPool& getGeometryPool(){
+        return geometryPool_;
+    }
+
+    rendr::TextureTable& getTextureTable(){
+        return textureTable_;
+    }
+
+    const rendr::TextureTable& getTextureTable() const{
+        return textureTable_;
+    }
+
+    rendr::DescriptorAllocator& getDescriptorAllocator(){
+        return descriptorAllocator_;
+    }
+
+    //valid for the frame being recorded only, call it from IDrawableObj::writeDrawPackets.
+    //The frame's sets are reset together once its fence signaled
+    vk::DescriptorSet allocateFrameDescriptorSet(vk::DescriptorSetLayout layout){
+        return descriptorAllocator_.allocateTransient(static_cast<uint32_t>(currentFrame_), layout);
+    }
+
+    rendr::DescriptorAllocatorStats getDescriptorStats() const{
+        return descriptorAllocator_.getStats();
+    }
+
     const rendr::SwapChain& getSwapChain() const{
         return swapChain_;
     }
+
+    bool isHeadless() const{
+        return headless_;
+    }
+
+    //swapchain or offscreen targets, whichever the renderer draws into
+    vk::Format getColorFormat() const;
+    vk::Extent2D getRenderExtent() const;
+    std::vector<vk::ImageView> getColorImageViews() const;
+    vk::ImageLayout getColorFinalLayout() const;
     
     const rendr::Image& getDepthImage() const{
         return depthImage_;
     }
 
+    const vk::raii::RenderPass& getRenderPass() const{
+        return renderPass_;
+    }
+
     const int getNumOfFramesInFlight() const{
         return framesInFlight_;
     }
+
+    //destroys resource once every frame submitted so far and every upload recorded so far finished,
+    //for handles that frames in flight may still reference
+    template<typename T>
+    void retire(T&& resource){
+        deletionQueue_.push(frameNumber_, uploadContext_.getLatestTicket(), std::forward<T>(resource));
+    }
+
+    //resources retired and not yet destroyed
+    size_t getRetiredCount() const{
+        return deletionQueue_.size();
+    }
+
+    const rendr::FramePacingStats& getFramePacingStats() const{
+        return pacingStats_;
+    }
+
+    //commands recorded for the last frame
+    const rendr::DrawStats& getDrawStats() const{
+        return drawStats_;
+    }
+
+    //milliseconds each recording job of the last frame took, empty when it was recorded inline
+    const std::vector<float>& getRecordingTimes() const{
+        return recordingTimes_;
+    }
+
+    //mode after falling back on devices that can't run the requested one
+    rendr::CullingMode getCullingMode() const{
+        return cullingMode_;
+    }
 };
 
 struct Material{
     int renderSetupIndex = -1;
-    virtual RendererSetup createRendererSetup(const rendr::Renderer& renderer,
-        const vk::raii::DescriptorSetLayout& rendererDescriptorSetLayout,
-        int framesInFlight){
-
+    //may run on a worker, see Renderer::initMaterialAsync. The material has to outlive the compile
+    virtual RendererSetup createRendererSetup(const rendr::RendererSetupContext& context){
         return RendererSetup();
     };
     virtual ~Material() = default;
@@ -785,9 +1170,12 @@ struct Material{
 struct IDrawableObj {
     IDrawableObj(Material& mat) : renderMaterial(&mat){}
     Material* renderMaterial;
-    virtual void bindResources(
-        const vk::raii::Device& device, const vk::raii::CommandBuffer& buffer, const vk::raii::PipelineLayout& layout, int curFrame){};
-    virtual size_t getNumOfDrawIndices(){return 0;};
+    //written to the object's per draw data every frame
+    glm::mat4 modelMatrix{1.0f};
+    //object is skipped until its buffers and textures are uploaded
+    rendr::UploadTicket uploadTicket;
+    //appends the object's draws for this frame, commands are recorded by the renderer from the sorted list
+    virtual void writeDrawPackets(rendr::DrawList& drawList, const rendr::RendererSetup& setup, int curFrame) const {};
     virtual ~IDrawableObj() = default;
 };
 
@@ -1,74 +1,107 @@
 #pragma once
 #include "utility.hpp"
+#include "meshCache.hpp"
 
 class MeshWithTextureObj : public rendr::IDrawableObj{
     rendr::Image texture;
-    rendr::Buffer indexBuffer;
-    rendr::Buffer vertexBuffer;
-    vk::raii::Sampler sampler;
-    vk::raii::DescriptorPool descriptorPool;
-    std::vector<vk::raii::DescriptorSet> descriptorSets;
-     
-    size_t numOfIndices;
+    //range inside the renderer's geometry pool
+    rendr::GeometryAllocation geometry;
+    const rendr::GeometryPool* geometryPool = nullptr;
+    //negative radius until a mesh is loaded, such draws are never culled
+    glm::vec4 boundingSphere{0.0f, 0.0f, 0.0f, -1.0f};
+    //shared through the device's sampler cache, not owned
+    vk::Sampler sampler;
+    //texture's slot in the renderer's texture table and the table's set
+    rendr::TextureSlot textureSlot;
+    vk::DescriptorSet textureTableSet;
 public:
 
     MeshWithTextureObj(rendr::Material& mat)
-    : IDrawableObj(mat), sampler(nullptr),descriptorPool(nullptr) {}
+    : IDrawableObj(mat) {}
 
-    void loadMesh(rendr::Mesh<rendr::VertexPTN>& mesh, const rendr::Renderer& renderer){
+    void loadMesh(rendr::Mesh<rendr::VertexPTN>& mesh, rendr::Renderer& renderer){
+        loadMesh(mesh.vertices.data(), mesh.vertices.size(), mesh.indices.data(), mesh.indices.size(), renderer);
+        boundingSphere = mesh.boundingSphere;
+    }
+
+    void loadMesh(const rendr::MeshView& mesh, rendr::Renderer& renderer){
+        loadMesh(mesh.vertices, mesh.vertexCount, mesh.indices, mesh.indexCount, renderer);
+        boundingSphere = mesh.boundingSphere;
+    }
+
+    void loadTexture(rendr::STBImageRaii tex, rendr::Renderer& renderer){
         const rendr::Device& device = renderer.getDevice();
-        vertexBuffer = rendr::createVertexBuffer(device.physicalDevice_, device.device_, device.commandPool_,device.graphicsQueue_, mesh.vertices);
-        indexBuffer = rendr::createIndexBuffer(device.physicalDevice_, device.device_, device.commandPool_,device.graphicsQueue_, mesh.indices);
-        numOfIndices = mesh.indices.size();
+        rendr::UploadContext& uploads = renderer.getUploadContext();
+        retireTexture(renderer);
+        texture = rendr::create2DTextureImage(device.physicalDevice_, device.allocator_, device.device_, uploads, std::move(tex));
+        uploadTicket = std::max(uploadTicket, uploads.getRecordingTicket());
+        registerTexture(renderer);
     }
 
-    void loadTexture(rendr::STBImageRaii tex, const rendr::Renderer& renderer){
+    void loadTexture(const rendr::CookedTexture& tex, rendr::Renderer& renderer){
         const rendr::Device& device = renderer.getDevice();
-        texture = rendr::create2DTextureImage(device.physicalDevice_,device.device_, device.commandPool_, device.graphicsQueue_, std::move(tex));
-        sampler = rendr::createTextureSampler(device.device_, device.physicalDevice_);
-        int framesOnFlight = renderer.getNumOfFramesInFlight();
-        descriptorSets.clear();
-        descriptorPool = rendr::createDescriptorPool(device.device_, framesOnFlight);
-        const rendr::RendererSetup& setup = renderer.getRenderSetup(renderMaterial->renderSetupIndex);
-        const vk::raii::DescriptorSetLayout& layout = setup.descriptorSetLayout_;
-        descriptorSets = rendr::createDescriptorSets(device.device_, descriptorPool, layout, framesOnFlight);
+        rendr::UploadContext& uploads = renderer.getUploadContext();
+        retireTexture(renderer);
+        texture = rendr::create2DTextureImage(device.physicalDevice_, device.allocator_, device.device_, uploads, tex);
+        uploadTicket = std::max(uploadTicket, uploads.getRecordingTicket());
+        registerTexture(renderer);
+    }
 
-        for(int i = 0; i < framesOnFlight; i++){
-            vk::DescriptorImageInfo imageInfo(
-                *sampler, // sampler
-                *texture.imageView,
-                vk::ImageLayout::eShaderReadOnlyOptimal // imageLayout
-            );
+    //hands the GPU resources to the renderer's deletion queue, remove the object from the drawn objects first
+    void release(rendr::Renderer& renderer){
+        retireTexture(renderer);
+        if (geometryPool) {
+            renderer.retire(std::move(geometry));
+            geometryPool = nullptr;
+        }
+    }
 
-            std::array<vk::WriteDescriptorSet, 1> descriptorWrites = {        
-                vk::WriteDescriptorSet(
-                    *descriptorSets[i], // dstSet
-                    0, // dstBinding
-                    0, // dstArrayElement
-                    1, // descriptorCount
-                    vk::DescriptorType::eCombinedImageSampler, // descriptorType
-                    &imageInfo, // pImageInfo
-                    nullptr, // pBufferInfo
-                    nullptr // pTexelBufferView
-                )
-            };
+    void writeDrawPackets(rendr::DrawList& drawList, const rendr::RendererSetup& setup, int curFrame) const override{
+        rendr::DrawPacket packet;
+        packet.pipeline = *setup.graphicsPipeline_;
+        packet.pipelineLayout = *setup.pipelineLayout_;
+        packet.materialSet = textureTableSet;
+        packet.textureIndex = textureSlot.getIndex();
+        packet.vertexBuffer = *geometryPool->getVertexBuffer();
+        packet.indexBuffer = *geometryPool->getIndexBuffer();
+        packet.indexCount = geometry->indexCount;
+        packet.firstIndex = geometry->firstIndex;
+        packet.vertexOffset = static_cast<int32_t>(geometry->firstVertex);
+        packet.model = modelMatrix;
+        packet.boundingSphere = boundingSphere;
+        packet.depth = rendr::computeDrawDepth(drawList.getViewProj(), modelMatrix, boundingSphere);
+        drawList.add(packet);
+    }
 
-            device.device_.updateDescriptorSets(descriptorWrites, nullptr);
+private:
+    void loadMesh(const rendr::VertexPTN* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount, rendr::Renderer& renderer){
+        rendr::GeometryPool& pool = renderer.getGeometryPool();
+        rendr::UploadContext& uploads = renderer.getUploadContext();
+        if (geometryPool) {
+            //the previous mesh may still be drawn by frames in flight
+            renderer.retire(std::move(geometry));
         }
+        geometry = pool.allocate(static_cast<uint32_t>(vertexCount), static_cast<uint32_t>(indexCount));
+        pool.upload(uploads, *geometry, vertices, indices);
+        geometryPool = &pool;
+        uploadTicket = std::max(uploadTicket, uploads.getRecordingTicket());
     }
 
-    size_t getNumOfDrawIndices() override{
-        return numOfIndices;
+    void retireTexture(rendr::Renderer& renderer){
+        if (!*texture.image) {
+            return;
+        }
+        //frames in flight may still sample the slot
+        renderer.retire(std::move(textureSlot));
+        renderer.retire(std::move(texture));
+        texture = rendr::Image();
     }
 
-    void bindResources(
-        const vk::raii::Device& device, 
-        const vk::raii::CommandBuffer& buffer, 
-        const vk::raii::PipelineLayout& layout,
-        int curFrame) override{
-    
-        buffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *layout, 1, {*descriptorSets[curFrame]}, {});
-        buffer.bindVertexBuffers(0, *vertexBuffer.buffer, {0});
-        buffer.bindIndexBuffer(*indexBuffer.buffer, 0, vk::IndexType::eUint32);
+    void registerTexture(rendr::Renderer& renderer){
+        const rendr::Device& device = renderer.getDevice();
+        sampler = rendr::getTextureSampler(device);
+        rendr::TextureTable& textureTable = renderer.getTextureTable();
+        textureSlot = textureTable.add(*texture.imageView, sampler);
+        textureTableSet = textureTable.getSet();
     }
 };
\ No newline at end of file
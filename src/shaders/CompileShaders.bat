@@ -1,9 +1,9 @@
-:: Этот скрипт компилирует файлы .frag и .vert в SPIR-V формат с помощью glslc 
+:: Этот скрипт компилирует файлы .frag, .vert и .comp в SPIR-V формат с помощью glslc 
 :: (glslc должен быть в переменных окружения)
 
 @echo off
 
-for %%i in (*.frag *.vert) do (
+for %%i in (*.frag *.vert *.comp) do (
     glslc %%i -o %%~ni.spv
 )
 
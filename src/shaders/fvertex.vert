@@ -1,20 +1,36 @@
 #version 450
 
-layout(binding = 0) uniform UniformBufferObject {
+layout(set = 0, binding = 0) uniform UniformBufferObject {
     mat4 model;
     mat4 view;
     mat4 proj;
 } ubo;
 
+struct DrawData {
+    mat4 model;
+    vec4 boundingSphere;
+    uint runIndex;
+    uint runFirst;
+    uint textureIndex;
+    uint padding;
+};
+
+//firstInstance of every draw is its index in the frame's draw data
+layout(std430, set = 0, binding = 1) readonly buffer DrawDataBuffer {
+    DrawData draws[];
+};
+
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec2 inTexCoord;
 layout(location = 2) in vec3 inNormal;
 
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) flat out uint fragTextureIndex;
 
 void main() {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+    gl_Position = ubo.proj * ubo.view * ubo.model * draws[gl_InstanceIndex].model * vec4(inPosition, 1.0);
     fragColor = vec3(1,1,1);
     fragTexCoord = inTexCoord;
+    fragTextureIndex = draws[gl_InstanceIndex].textureIndex;
 }
\ No newline at end of file
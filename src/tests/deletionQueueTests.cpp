@@ -0,0 +1,82 @@
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "deletionQueue.hpp"
+
+namespace{
+
+//appends its id to the log when destroyed, moved-from instances log nothing
+struct LoggedResource{
+    std::vector<int>* log;
+    int id;
+
+    LoggedResource(std::vector<int>* log, int id)
+    : log(log), id(id){}
+
+    LoggedResource(LoggedResource&& other) noexcept
+    : log(other.log), id(other.id){
+        other.log = nullptr;
+    }
+
+    LoggedResource(const LoggedResource&) = delete;
+
+    ~LoggedResource(){
+        if (log) {
+            log->push_back(id);
+        }
+    }
+};
+
+}
+
+TEST(DeletionQueue, DestroysInPushOrder) {
+    std::vector<int> log;
+    rendr::DeletionQueue queue;
+    for (int i = 0; i < 4; i++) {
+        queue.push(static_cast<uint64_t>(i), rendr::UploadTicket{}, LoggedResource(&log, i));
+    }
+    EXPECT_TRUE(log.empty());
+
+    queue.collect([](uint64_t, rendr::UploadTicket){
+        return true;
+    });
+    EXPECT_EQ(log, (std::vector<int>{0, 1, 2, 3}));
+    EXPECT_EQ(queue.size(), 0u);
+}
+
+TEST(DeletionQueue, StopsAtFirstIncompleteEntry) {
+    std::vector<int> log;
+    rendr::DeletionQueue queue;
+    queue.push(1, rendr::UploadTicket{}, LoggedResource(&log, 1));
+    queue.push(2, rendr::UploadTicket{5}, LoggedResource(&log, 2));
+    queue.push(3, rendr::UploadTicket{}, LoggedResource(&log, 3));
+
+    //frame 3 would be complete, but the entry before it waits on an upload
+    uint64_t completedTicket = 4;
+    auto isComplete = [&completedTicket](uint64_t frameNumber, rendr::UploadTicket ticket){
+        return frameNumber <= 3 && ticket.value <= completedTicket;
+    };
+    queue.collect(isComplete);
+    EXPECT_EQ(log, (std::vector<int>{1}));
+    EXPECT_EQ(queue.size(), 2u);
+
+    completedTicket = 5;
+    queue.collect(isComplete);
+    EXPECT_EQ(log, (std::vector<int>{1, 2, 3}));
+}
+
+TEST(DeletionQueue, FlushesOnDestruction) {
+    std::vector<int> log;
+    {
+        rendr::DeletionQueue queue;
+        queue.push(7, rendr::UploadTicket{}, LoggedResource(&log, 7));
+        queue.push(8, rendr::UploadTicket{}, std::make_unique<LoggedResource>(&log, 8));
+        queue.collect([](uint64_t, rendr::UploadTicket){
+            return false;
+        });
+        EXPECT_TRUE(log.empty());
+    }
+    EXPECT_EQ(log, (std::vector<int>{7, 8}));
+}
@@ -0,0 +1,127 @@
+#include <optional>
+
+#include <gtest/gtest.h>
+
+#include "descriptorAllocator.hpp"
+#include "descriptorPoolLists.hpp"
+
+TEST(DescriptorAllocator, PoolsGrowHalfAgainAsLarge) {
+    EXPECT_EQ(rendr::DescriptorAllocator::getGrownPoolSize(64), 96u);
+    EXPECT_EQ(rendr::DescriptorAllocator::getGrownPoolSize(96), 144u);
+    EXPECT_EQ(rendr::DescriptorAllocator::getGrownPoolSize(1000), 1500u);
+}
+
+TEST(DescriptorAllocator, PoolsOfOneSetGrow) {
+    EXPECT_EQ(rendr::DescriptorAllocator::getGrownPoolSize(1), 2u);
+    EXPECT_EQ(rendr::DescriptorAllocator::getGrownPoolSize(2), 3u);
+    EXPECT_EQ(rendr::DescriptorAllocator::getGrownPoolSize(3), 4u);
+}
+
+TEST(DescriptorAllocator, PoolGrowthStopsAtTheCap) {
+    EXPECT_EQ(rendr::DescriptorAllocator::getGrownPoolSize(3000), rendr::maxDescriptorSetsPerPool);
+    EXPECT_EQ(rendr::DescriptorAllocator::getGrownPoolSize(rendr::maxDescriptorSetsPerPool), rendr::maxDescriptorSetsPerPool);
+    //pools created larger than the cap are not shrunk
+    EXPECT_EQ(rendr::DescriptorAllocator::getGrownPoolSize(10000), 10000u);
+}
+
+TEST(DescriptorAllocator, PoolGrowthReachesTheCapInFewSteps) {
+    //every growth is one more pool, geometric growth keeps the pool count logarithmic in the sets needed
+    uint32_t setsPerPool = 1;
+    uint32_t growths = 0;
+    while (setsPerPool < rendr::maxDescriptorSetsPerPool) {
+        uint32_t grown = rendr::DescriptorAllocator::getGrownPoolSize(setsPerPool);
+        EXPECT_GT(grown, setsPerPool);
+        setsPerPool = grown;
+        growths++;
+    }
+    EXPECT_EQ(setsPerPool, rendr::maxDescriptorSetsPerPool);
+    EXPECT_LE(growths, 24u);
+}
+
+TEST(DescriptorAllocator, StatsStartEmpty) {
+    rendr::DescriptorAllocator allocator;
+    rendr::DescriptorAllocatorStats stats = allocator.getStats();
+    EXPECT_EQ(stats.persistentSets, 0u);
+    EXPECT_EQ(stats.transientSets, 0u);
+    EXPECT_EQ(stats.pools, 0u);
+    EXPECT_EQ(stats.poolGrowths, 0u);
+}
+
+TEST(DescriptorPoolLists, RetriesFullPersistentPoolsAfterAFree) {
+    rendr::DescriptorPoolLists lists;
+    lists.reset(4, 1);
+    uint32_t list = rendr::DescriptorPoolLists::persistentList;
+    uint32_t first = lists.addPool(list);
+    lists.markFull(list);
+
+    //a set of the full pool was freed through its handle, the pool is tried again before growing
+    std::optional<uint32_t> pool = lists.getPool(list);
+    ASSERT_TRUE(pool.has_value());
+    EXPECT_EQ(*pool, first);
+    lists.markAllocated(list);
+    EXPECT_EQ(lists.getPoolCount(list), 1u);
+    EXPECT_EQ(lists.getStats().poolGrowths, 0u);
+    EXPECT_EQ(lists.getStats().persistentSets, 1u);
+}
+
+TEST(DescriptorPoolLists, GrowsOnlyAfterEveryPoolFailed) {
+    rendr::DescriptorPoolLists lists;
+    lists.reset(4, 1);
+    uint32_t list = rendr::DescriptorPoolLists::persistentList;
+    lists.addPool(list);
+    EXPECT_EQ(lists.getStats().poolGrowths, 0u);
+    lists.markFull(list);
+    ASSERT_TRUE(lists.getPool(list).has_value());
+    lists.markFull(list);
+    //the retried pools failed too, now the list has to grow
+    EXPECT_FALSE(lists.getPool(list).has_value());
+    lists.addPool(list);
+    lists.markFull(list);
+    ASSERT_TRUE(lists.getPool(list).has_value());
+    lists.markFull(list);
+    lists.markFull(list);
+    EXPECT_FALSE(lists.getPool(list).has_value());
+    lists.addPool(list);
+
+    EXPECT_EQ(lists.getPoolCount(list), 3u);
+    EXPECT_EQ(lists.getStats().poolGrowths, 2u);
+    EXPECT_EQ(lists.getSetsPerPool(list), rendr::DescriptorPoolLists::getGrownPoolSize(rendr::DescriptorPoolLists::getGrownPoolSize(4)));
+}
+
+TEST(DescriptorPoolLists, TransientPoolsAreNotRetriedBeforeAReset) {
+    rendr::DescriptorPoolLists lists;
+    lists.reset(4, 2);
+    uint32_t list = rendr::DescriptorPoolLists::getFrameList(0);
+    lists.addPool(list);
+    lists.markFull(list);
+    //transient sets are never freed one by one, a full pool stays full until its frame is reset
+    EXPECT_FALSE(lists.getPool(list).has_value());
+}
+
+TEST(DescriptorPoolLists, ResetFrameRecyclesOnlyThatFramesPools) {
+    rendr::DescriptorPoolLists lists;
+    lists.reset(4, 2);
+    uint32_t frame0 = rendr::DescriptorPoolLists::getFrameList(0);
+    uint32_t frame1 = rendr::DescriptorPoolLists::getFrameList(1);
+    uint32_t persistent = rendr::DescriptorPoolLists::persistentList;
+    for (uint32_t list : {persistent, frame0, frame1}) {
+        lists.addPool(list);
+        lists.markAllocated(list);
+        lists.markFull(list);
+    }
+    lists.getPool(persistent);
+    lists.markFull(persistent);
+
+    lists.resetFrame(0);
+    std::optional<uint32_t> pool = lists.getPool(frame0);
+    ASSERT_TRUE(pool.has_value());
+    EXPECT_EQ(*pool, 0u);
+    EXPECT_FALSE(lists.getPool(frame1).has_value());
+    EXPECT_FALSE(lists.getPool(persistent).has_value());
+
+    rendr::DescriptorAllocatorStats stats = lists.getStats();
+    EXPECT_EQ(stats.transientSets, 1u);
+    EXPECT_EQ(stats.persistentSets, 1u);
+    EXPECT_EQ(stats.pools, 3u);
+    EXPECT_EQ(stats.poolGrowths, 0u);
+}
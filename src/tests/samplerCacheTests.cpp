@@ -0,0 +1,59 @@
+#include <stdexcept>
+#include <unordered_map>
+
+#include <gtest/gtest.h>
+
+#include "samplerCache.hpp"
+
+namespace{
+
+using SamplerKeys = std::unordered_map<vk::SamplerCreateInfo, int, rendr::SamplerCache::InfoHash>;
+
+vk::SamplerCreateInfo makeTrilinearInfo(){
+    return vk::SamplerCreateInfo()
+        .setMagFilter(vk::Filter::eLinear)
+        .setMinFilter(vk::Filter::eLinear)
+        .setMipmapMode(vk::SamplerMipmapMode::eLinear)
+        .setAddressModeU(vk::SamplerAddressMode::eRepeat)
+        .setAddressModeV(vk::SamplerAddressMode::eRepeat)
+        .setAddressModeW(vk::SamplerAddressMode::eRepeat)
+        .setAnisotropyEnable(VK_TRUE)
+        .setMaxAnisotropy(16.0f)
+        .setMaxLod(VK_LOD_CLAMP_NONE);
+}
+
+}
+
+TEST(SamplerCache, KeysEqualInfosTogether) {
+    rendr::SamplerCache::InfoHash hash;
+    vk::SamplerCreateInfo first = makeTrilinearInfo();
+    vk::SamplerCreateInfo second = makeTrilinearInfo();
+    EXPECT_EQ(hash(first), hash(second));
+
+    SamplerKeys keys;
+    keys[first]++;
+    keys[second]++;
+    EXPECT_EQ(keys.size(), 1u);
+    EXPECT_EQ(keys[first], 2);
+}
+
+TEST(SamplerCache, KeysDifferingInfosApart) {
+    SamplerKeys keys;
+    keys[makeTrilinearInfo()]++;
+    keys[makeTrilinearInfo().setMaxAnisotropy(1.0f)]++;
+    keys[makeTrilinearInfo().setAddressModeU(vk::SamplerAddressMode::eClampToEdge)]++;
+    keys[makeTrilinearInfo().setMaxLod(4.0f)]++;
+    keys[makeTrilinearInfo().setMagFilter(vk::Filter::eNearest)]++;
+    keys[makeTrilinearInfo().setCompareEnable(VK_TRUE).setCompareOp(vk::CompareOp::eLess)]++;
+    EXPECT_EQ(keys.size(), 6u);
+}
+
+TEST(SamplerCache, RefusesInfosWithPNext) {
+    //thrown before the device is touched, so an uncreated cache is enough
+    rendr::SamplerCache cache;
+    vk::SamplerReductionModeCreateInfo reduction(vk::SamplerReductionMode::eMin);
+    vk::SamplerCreateInfo info = makeTrilinearInfo().setPNext(&reduction);
+    EXPECT_THROW(cache.get(info), std::runtime_error);
+    EXPECT_EQ(cache.getSamplerCount(), 0u);
+    EXPECT_EQ(cache.getRequestCount(), 0u);
+}
@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "slotAllocator.hpp"
+
+TEST(SlotAllocator, HandsOutIndicesInOrder) {
+    rendr::SlotAllocator slots;
+    slots.reset(3);
+    EXPECT_EQ(slots.allocate(), 0u);
+    EXPECT_EQ(slots.allocate(), 1u);
+    EXPECT_EQ(slots.allocate(), 2u);
+    EXPECT_EQ(slots.size(), 3u);
+}
+
+TEST(SlotAllocator, ReusesFreedIndicesFirst) {
+    rendr::SlotAllocator slots;
+    slots.reset(8);
+    for (int i = 0; i < 4; i++) {
+        slots.allocate();
+    }
+    slots.free(1, slots.getEpoch());
+    slots.free(3, slots.getEpoch());
+    EXPECT_EQ(slots.size(), 2u);
+
+    //most recently freed first, never used indices only after that
+    EXPECT_EQ(slots.allocate(), 3u);
+    EXPECT_EQ(slots.allocate(), 1u);
+    EXPECT_EQ(slots.allocate(), 4u);
+    EXPECT_EQ(slots.size(), 5u);
+}
+
+TEST(SlotAllocator, ThrowsWhenFull) {
+    rendr::SlotAllocator slots;
+    slots.reset(2);
+    slots.allocate();
+    slots.allocate();
+    EXPECT_THROW(slots.allocate(), std::runtime_error);
+
+    //a freed index makes room again
+    slots.free(0, slots.getEpoch());
+    EXPECT_EQ(slots.allocate(), 0u);
+}
+
+TEST(SlotAllocator, IgnoresIndicesFromBeforeReset) {
+    rendr::SlotAllocator slots;
+    slots.reset(4);
+    slots.allocate();
+    slots.allocate();
+    uint32_t staleEpoch = slots.getEpoch();
+    slots.reset(4);
+    slots.free(1, staleEpoch);
+    EXPECT_EQ(slots.size(), 0u);
+    EXPECT_EQ(slots.allocate(), 0u);
+
+    //index 1 is in use again, a late free of the old handle must not put it back on the free list
+    EXPECT_EQ(slots.allocate(), 1u);
+    slots.free(1, staleEpoch);
+    EXPECT_EQ(slots.size(), 2u);
+    EXPECT_EQ(slots.allocate(), 2u);
+}
+
+TEST(SlotAllocator, NeverHandsOutAnIndexTwice) {
+    rendr::SlotAllocator slots;
+    slots.reset(64);
+    std::vector<uint32_t> live;
+    for (uint32_t round = 0; round < 200; round++) {
+        if (live.size() < 64 && (round % 3 != 2 || live.empty())) {
+            uint32_t index = slots.allocate();
+            EXPECT_TRUE(std::find(live.begin(), live.end(), index) == live.end());
+            live.push_back(index);
+        } else {
+            uint32_t index = live[round % live.size()];
+            live.erase(live.begin() + round % live.size());
+            slots.free(index, slots.getEpoch());
+        }
+        EXPECT_EQ(slots.size(), live.size());
+    }
+}
@@ -0,0 +1,318 @@
+#include "bcEncoder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace rendr{
+
+namespace{
+
+struct BitWriter{
+    uint8_t* out;
+    uint32_t bitPos = 0;
+
+    void write(uint32_t value, uint32_t bitCount){
+        for (uint32_t i = 0; i < bitCount; i++) {
+            if (value & (1u << i)) {
+                out[bitPos >> 3] |= uint8_t(1u << (bitPos & 7));
+            }
+            bitPos++;
+        }
+    }
+};
+
+uint16_t packRGB565(int r, int g, int b){
+    return uint16_t(((r * 31 + 127) / 255) << 11 | ((g * 63 + 127) / 255) << 5 | ((b * 31 + 127) / 255));
+}
+
+void unpackRGB565(uint16_t c, int rgb[3]){
+    int r = (c >> 11) & 31;
+    int g = (c >> 5) & 63;
+    int b = c & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+int colorDistance(const int* a, const uint8_t* b, int channels){
+    int dist = 0;
+    for (int c = 0; c < channels; c++) {
+        int d = a[c] - b[c];
+        dist += d * d;
+    }
+    return dist;
+}
+
+//endpoints along the principal axis of the block colors, the bounding box diagonal misses anti-correlated channels
+void findEndpoints(const uint8_t block[64], int channels, int low[4], int high[4]){
+    float mean[4] = {0, 0, 0, 0};
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < channels; c++) {
+            mean[c] += block[i * 4 + c] / 16.0f;
+        }
+    }
+
+    float covariance[4][4] = {};
+    for (int i = 0; i < 16; i++) {
+        for (int a = 0; a < channels; a++) {
+            for (int b = 0; b < channels; b++) {
+                covariance[a][b] += (block[i * 4 + a] - mean[a]) * (block[i * 4 + b] - mean[b]);
+            }
+        }
+    }
+
+    float axis[4] = {1, 1, 1, 1};
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float next[4] = {0, 0, 0, 0};
+        float length = 0;
+        for (int a = 0; a < channels; a++) {
+            for (int b = 0; b < channels; b++) {
+                next[a] += covariance[a][b] * axis[b];
+            }
+            length = std::max(length, std::abs(next[a]));
+        }
+        if (length == 0) {
+            break;
+        }
+        for (int c = 0; c < channels; c++) {
+            axis[c] = next[c] / length;
+        }
+    }
+
+    float axisLengthSq = 0;
+    for (int c = 0; c < channels; c++) {
+        axisLengthSq += axis[c] * axis[c];
+    }
+
+    float minT = 0;
+    float maxT = 0;
+    for (int i = 0; i < 16; i++) {
+        float t = 0;
+        for (int c = 0; c < channels; c++) {
+            t += (block[i * 4 + c] - mean[c]) * axis[c];
+        }
+        t /= axisLengthSq;
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+
+    for (int c = 0; c < channels; c++) {
+        low[c] = std::clamp(static_cast<int>(mean[c] + axis[c] * minT + 0.5f), 0, 255);
+        high[c] = std::clamp(static_cast<int>(mean[c] + axis[c] * maxT + 0.5f), 0, 255);
+    }
+}
+
+//one channel of a BC4 block, 8 value mode (first endpoint greater than the second)
+void encodeBC4Channel(const uint8_t block[64], int channel, uint8_t out[8]){
+    int minV = 255;
+    int maxV = 0;
+    for (int i = 0; i < 16; i++) {
+        minV = std::min<int>(minV, block[i * 4 + channel]);
+        maxV = std::max<int>(maxV, block[i * 4 + channel]);
+    }
+
+    memset(out, 0, 8);
+    out[0] = uint8_t(maxV);
+    out[1] = uint8_t(minV);
+    if (maxV == minV) {
+        return;
+    }
+
+    int palette[8];
+    palette[0] = maxV;
+    palette[1] = minV;
+    for (int i = 1; i < 7; i++) {
+        palette[i + 1] = ((7 - i) * maxV + i * minV + 3) / 7;
+    }
+
+    BitWriter writer{out + 2};
+    for (int i = 0; i < 16; i++) {
+        int v = block[i * 4 + channel];
+        int best = 0;
+        int bestDist = 256;
+        for (int p = 0; p < 8; p++) {
+            int dist = std::abs(palette[p] - v);
+            if (dist < bestDist) {
+                bestDist = dist;
+                best = p;
+            }
+        }
+        writer.write(uint32_t(best), 3);
+    }
+}
+
+//7 bit endpoint plus shared p-bit closest to the 8 bit color
+void quantizeBC7Endpoint(const int color[4], int quantized[4], int& pBit){
+    int bestError = -1;
+    for (int p = 0; p < 2; p++) {
+        int candidate[4];
+        int error = 0;
+        for (int c = 0; c < 4; c++) {
+            candidate[c] = std::clamp((color[c] - p + 1) >> 1, 0, 127);
+            int d = ((candidate[c] << 1) | p) - color[c];
+            error += d * d;
+        }
+        if (bestError < 0 || error < bestError) {
+            bestError = error;
+            pBit = p;
+            memcpy(quantized, candidate, sizeof(candidate));
+        }
+    }
+}
+
+}
+
+void encodeBC1Block(const uint8_t block[64], uint8_t out[8]){
+    int minC[4];
+    int maxC[4];
+    findEndpoints(block, 3, minC, maxC);
+    //inset the line a bit, extremes are rarely worth a whole palette entry
+    for (int c = 0; c < 3; c++) {
+        int inset = (maxC[c] - minC[c]) / 16;
+        minC[c] += inset;
+        maxC[c] -= inset;
+    }
+
+    uint16_t c0 = packRGB565(maxC[0], maxC[1], maxC[2]);
+    uint16_t c1 = packRGB565(minC[0], minC[1], minC[2]);
+    if (c0 < c1) {
+        std::swap(c0, c1);
+    }
+
+    memset(out, 0, 8);
+    out[0] = uint8_t(c0);
+    out[1] = uint8_t(c0 >> 8);
+    out[2] = uint8_t(c1);
+    out[3] = uint8_t(c1 >> 8);
+    if (c0 == c1) {
+        return;
+    }
+
+    int palette[4][3];
+    unpackRGB565(c0, palette[0]);
+    unpackRGB565(c1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+    }
+
+    BitWriter writer{out + 4};
+    for (int i = 0; i < 16; i++) {
+        int best = 0;
+        int bestDist = colorDistance(palette[0], block + i * 4, 3);
+        for (int p = 1; p < 4; p++) {
+            int dist = colorDistance(palette[p], block + i * 4, 3);
+            if (dist < bestDist) {
+                bestDist = dist;
+                best = p;
+            }
+        }
+        writer.write(uint32_t(best), 2);
+    }
+}
+
+void encodeBC5Block(const uint8_t block[64], uint8_t out[16]){
+    encodeBC4Channel(block, 0, out);
+    encodeBC4Channel(block, 1, out + 8);
+}
+
+void encodeBC7Block(const uint8_t block[64], uint8_t out[16]){
+    static const int weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    int endpoints[2][4];
+    findEndpoints(block, 4, endpoints[0], endpoints[1]);
+
+    int quantized[2][4];
+    int pBits[2];
+    quantizeBC7Endpoint(endpoints[0], quantized[0], pBits[0]);
+    quantizeBC7Endpoint(endpoints[1], quantized[1], pBits[1]);
+
+    int decoded[2][4];
+    for (int e = 0; e < 2; e++) {
+        for (int c = 0; c < 4; c++) {
+            decoded[e][c] = (quantized[e][c] << 1) | pBits[e];
+        }
+    }
+
+    int palette[16][4];
+    for (int w = 0; w < 16; w++) {
+        for (int c = 0; c < 4; c++) {
+            palette[w][c] = ((64 - weights[w]) * decoded[0][c] + weights[w] * decoded[1][c] + 32) >> 6;
+        }
+    }
+
+    int indices[16];
+    for (int i = 0; i < 16; i++) {
+        int best = 0;
+        int bestDist = colorDistance(palette[0], block + i * 4, 4);
+        for (int w = 1; w < 16; w++) {
+            int dist = colorDistance(palette[w], block + i * 4, 4);
+            if (dist < bestDist) {
+                bestDist = dist;
+                best = w;
+            }
+        }
+        indices[i] = best;
+    }
+
+    //the anchor index is stored without its top bit, swap endpoints to keep it clear
+    if (indices[0] & 8) {
+        std::swap(quantized[0], quantized[1]);
+        std::swap(pBits[0], pBits[1]);
+        for (int& index : indices) {
+            index = 15 - index;
+        }
+    }
+
+    memset(out, 0, 16);
+    BitWriter writer{out};
+    writer.write(1u << 6, 7);
+    for (int c = 0; c < 4; c++) {
+        writer.write(uint32_t(quantized[0][c]), 7);
+        writer.write(uint32_t(quantized[1][c]), 7);
+    }
+    writer.write(uint32_t(pBits[0]), 1);
+    writer.write(uint32_t(pBits[1]), 1);
+    writer.write(uint32_t(indices[0]), 3);
+    for (int i = 1; i < 16; i++) {
+        writer.write(uint32_t(indices[i]), 4);
+    }
+}
+
+std::vector<uint8_t> encodeLevel(CookedTextureFormat format, const uint8_t* pixels, uint32_t width, uint32_t height){
+    std::vector<uint8_t> encoded(calcCookedLevelSize(format, width, height));
+    if (format == CookedTextureFormat::RGBA8) {
+        memcpy(encoded.data(), pixels, encoded.size());
+        return encoded;
+    }
+
+    uint32_t blockSize = getCookedFormatBlockSize(format);
+    uint32_t blocksX = (width + 3) / 4;
+    uint32_t blocksY = (height + 3) / 4;
+    uint8_t block[64];
+
+    for (uint32_t by = 0; by < blocksY; by++) {
+        for (uint32_t bx = 0; bx < blocksX; bx++) {
+            for (uint32_t y = 0; y < 4; y++) {
+                uint32_t srcY = std::min(by * 4 + y, height - 1);
+                for (uint32_t x = 0; x < 4; x++) {
+                    uint32_t srcX = std::min(bx * 4 + x, width - 1);
+                    memcpy(block + (y * 4 + x) * 4, pixels + (size_t(srcY) * width + srcX) * 4, 4);
+                }
+            }
+
+            uint8_t* out = encoded.data() + (size_t(by) * blocksX + bx) * blockSize;
+            switch (format) {
+            case CookedTextureFormat::BC1: encodeBC1Block(block, out); break;
+            case CookedTextureFormat::BC5: encodeBC5Block(block, out); break;
+            case CookedTextureFormat::BC7: encodeBC7Block(block, out); break;
+            default: throw std::invalid_argument("unsupported block format!");
+            }
+        }
+    }
+    return encoded;
+}
+
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "cookedTexture.hpp"
+
+namespace rendr{
+
+//block is 4x4 RGBA8 pixels, row major
+void encodeBC1Block(const uint8_t block[64], uint8_t out[8]);
+//red and green channels as two BC4 blocks, meant for normal maps
+void encodeBC5Block(const uint8_t block[64], uint8_t out[16]);
+//mode 6 only: one subset, RGBA endpoints with p-bits, 4 bit indices
+void encodeBC7Block(const uint8_t block[64], uint8_t out[16]);
+
+//encodes a whole RGBA8 level, partial blocks at the edges repeat the last row/column
+std::vector<uint8_t> encodeLevel(CookedTextureFormat format, const uint8_t* pixels, uint32_t width, uint32_t height);
+
+}
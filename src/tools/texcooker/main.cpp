@@ -0,0 +1,88 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "bcEncoder.hpp"
+#include "cookedTexture.hpp"
+#include "mipChain.hpp"
+
+//Offline texture cooker: decodes PNG/JPG, builds the mip chain and block compresses every level
+//usage: texcooker <input image> <output .rtex> [bc7|bc1|bc5|rgba8] [--linear]
+
+static rendr::CookedTextureFormat parseFormat(const std::string& name){
+    if (name == "bc7") return rendr::CookedTextureFormat::BC7;
+    if (name == "bc1") return rendr::CookedTextureFormat::BC1;
+    if (name == "bc5") return rendr::CookedTextureFormat::BC5;
+    if (name == "rgba8") return rendr::CookedTextureFormat::RGBA8;
+    throw std::invalid_argument("unknown format " + name);
+}
+
+static void printUsage(){
+    std::cerr << "usage: texcooker <input image> <output .rtex> [bc7|bc1|bc5|rgba8] [--linear]" << std::endl;
+}
+
+int main(int argc, char** argv){
+    if (argc < 3) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    try {
+        std::string inputPath = argv[1];
+        std::string outputPath = argv[2];
+        rendr::CookedTextureFormat format = rendr::CookedTextureFormat::BC7;
+        bool srgb = true;
+        for (int i = 3; i < argc; i++) {
+            if (strcmp(argv[i], "--linear") == 0) {
+                srgb = false;
+            } else {
+                format = parseFormat(argv[i]);
+            }
+        }
+        //two channel data is never color
+        if (format == rendr::CookedTextureFormat::BC5) {
+            srgb = false;
+        }
+
+        auto startTime = std::chrono::steady_clock::now();
+
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        stbi_uc* pixels = stbi_load(inputPath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+        if (!pixels) {
+            throw std::runtime_error("failed to load " + inputPath);
+        }
+
+        std::vector<rendr::MipLevel> mips;
+        std::vector<uint8_t> chain = rendr::buildMipChainRGBA8(pixels, uint32_t(width), uint32_t(height), srgb, mips);
+        stbi_image_free(pixels);
+
+        rendr::CookedTexture texture;
+        texture.format = format;
+        texture.srgb = srgb;
+        texture.width = uint32_t(width);
+        texture.height = uint32_t(height);
+        for (const rendr::MipLevel& mip : mips) {
+            std::vector<uint8_t> encoded = rendr::encodeLevel(format, chain.data() + mip.offset, mip.width, mip.height);
+            texture.levels.push_back(rendr::CookedMip{mip.width, mip.height, texture.data.size(), encoded.size()});
+            texture.data.insert(texture.data.end(), encoded.begin(), encoded.end());
+        }
+        rendr::saveCookedTexture(outputPath, texture);
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        std::cout << outputPath << ": " << width << "x" << height << ", " << texture.levels.size() << " mips, "
+            << chain.size() / 1024 << " KB -> " << texture.data.size() / 1024 << " KB in " << seconds << " s" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}